@@ -0,0 +1,230 @@
+/*	Alloaudio --
+    Audio facilities for large multichannel systems
+
+    Copyright (C) 2014. AlloSphere Research Group, Media Arts & Technology, UCSB.
+    Copyright (C) 2014. The Regents of the University of California.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+        Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+        Neither the name of the University of California nor the names of its
+        contributors may be used to endorse or promote products derived from
+        this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+
+
+    File description:
+    Banks of cascaded biquad filters processing several channels per SIMD
+    register.
+*/
+
+
+#ifndef INC_AL_FILTERBANK_HPP
+#define INC_AL_FILTERBANK_HPP
+
+#include <cmath>
+#include <string.h>
+#include <vector>
+
+namespace al {
+
+/** Bank of cascaded biquad filters, one cascade per channel.
+ *
+ * Channels are grouped L at a time and the coefficients and state of each
+ * group are stored interleaved by lane, so that a filter section is computed
+ * for all channels of a group with the same arithmetic on L values. The
+ * loops over lanes have a constant trip count and are mapped by the compiler
+ * onto SIMD registers, so L should be a multiple of the number of values per
+ * register (e.g. 4 doubles use two SSE2 or one AVX register). Each channel
+ * can have its own coefficients. The arithmetic is the same as filtering
+ * each channel on its own.
+ *
+ * Samples are processed in tiles of frames interleaved by lane, where lane k
+ * of frame n is at tile[n * L + k]. gather() and scatter() convert between
+ * channel buffers and tiles, so that a chain of banks can be run on a group
+ * with a single pass over the channel buffers.
+ */
+template <class T = double, int L = 4>
+class BiquadBank
+{
+public:
+    enum { LANES = L };
+
+    BiquadBank(int numChnls = 0, int numSections = 1) { resize(numChnls, numSections); }
+
+    /** Set the number of channels and of sections per channel. Resets all
+     * filters to pass-through with zero state.
+     */
+    void resize(int numChnls, int numSections) {
+        m_numChnls = numChnls;
+        m_numSections = numSections;
+        int n = getNumGroups() * numSections * L;
+        m_coefs.assign(n * 5, T(0));
+        m_state.assign(n * 4, T(0));
+        for (int c = 0; c < getNumGroups() * L; c++) {
+            for (int s = 0; s < numSections; s++) {
+                setCoefs(c, s, 1, 0, 0, 0, 0);
+            }
+        }
+    }
+
+    int getNumChnls() const { return m_numChnls; }
+    int getNumSections() const { return m_numSections; }
+
+    /** Get the number of groups of L channels */
+    int getNumGroups() const { return (m_numChnls + L - 1) / L; }
+
+    /** Set the coefficients of a section of a channel's cascade. The
+     * section computes y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2.
+     */
+    void setCoefs(int chan, int section, T b0, T b1, T b2, T a1, T a2) {
+        T *c = coefs(chan / L, section);
+        int k = chan % L;
+        c[0*L + k] = b0;
+        c[1*L + k] = b1;
+        c[2*L + k] = b2;
+        c[3*L + k] = a1;
+        c[4*L + k] = a2;
+    }
+
+    /** Set a section of a channel's cascade to a second order Butterworth
+     * low pass or high pass filter.
+     */
+    void setButterworth(int chan, int section, double fc, double sampleRate, bool lowpass) {
+        double w = fc * (M_PI/sampleRate);
+        double lambda = lowpass ? 1.0/tan(w) : tan(w);
+        double lambda_2 = lambda * lambda;
+        double a0 = 1.0/(1.0 + (sqrt(2.0)*lambda) + lambda_2);
+        double a2 = a0 * (1.0 - (sqrt(2.0)*lambda) + lambda_2);
+        if (lowpass) {
+            setCoefs(chan, section, a0, 2.0 * a0, a0, 2.0 * a0 * (1.0 - lambda_2), a2);
+        } else {
+            setCoefs(chan, section, a0, -2.0 * a0, a0, 2.0 * a0 * (lambda_2 - 1.0), a2);
+        }
+    }
+
+    /** Zero the state of all filters */
+    void clear() {
+        std::fill(m_state.begin(), m_state.end(), T(0));
+    }
+
+    /** Filter a tile of nframes frames of a group in place through all
+     * sections.
+     */
+    void process(int group, T *tile, int nframes) {
+        for (int s = 0; s < m_numSections; s++) {
+            const T *c = coefs(group, s);
+            T *st = state(group, s);
+            T b0[L], b1[L], b2[L], a1[L], a2[L];
+            T x1[L], x2[L], y1[L], y2[L];
+            for (int k = 0; k < L; k++) {
+                b0[k] = c[0*L + k]; b1[k] = c[1*L + k]; b2[k] = c[2*L + k];
+                a1[k] = c[3*L + k]; a2[k] = c[4*L + k];
+                x1[k] = st[0*L + k]; x2[k] = st[1*L + k];
+                y1[k] = st[2*L + k]; y2[k] = st[3*L + k];
+            }
+            /* Two frames per iteration, alternating which arrays hold the
+             * newest state rather than shifting it, so the lane loops are
+             * free of copies and vectorize. */
+            int i = 0;
+            for (; i + 1 < nframes; i += 2) {
+                T *v = tile + i * L;
+                for (int k = 0; k < L; k++) {
+                    T x = v[k];
+                    T y = b0[k] * x + b1[k] * x1[k] + b2[k] * x2[k]
+                            - a1[k] * y1[k] - a2[k] * y2[k];
+                    x2[k] = x; y2[k] = y;
+                    v[k] = y;
+                }
+                v += L;
+                for (int k = 0; k < L; k++) {
+                    T x = v[k];
+                    T y = b0[k] * x + b1[k] * x2[k] + b2[k] * x1[k]
+                            - a1[k] * y2[k] - a2[k] * y1[k];
+                    x1[k] = x; y1[k] = y;
+                    v[k] = y;
+                }
+            }
+            if (i < nframes) {
+                T *v = tile + i * L;
+                for (int k = 0; k < L; k++) {
+                    T x = v[k];
+                    T y = b0[k] * x + b1[k] * x1[k] + b2[k] * x2[k]
+                            - a1[k] * y1[k] - a2[k] * y2[k];
+                    x2[k] = x1[k]; x1[k] = x;
+                    y2[k] = y1[k]; y1[k] = y;
+                    v[k] = y;
+                }
+            }
+            for (int k = 0; k < L; k++) {
+                st[0*L + k] = x1[k]; st[1*L + k] = x2[k];
+                st[2*L + k] = y1[k]; st[3*L + k] = y2[k];
+            }
+        }
+    }
+
+    /** Interleave nlanes channel buffers into a tile. Lanes past nlanes are
+     * zeroed.
+     */
+    template <class S>
+    static void gather(T *tile, const S * const *chans, int nlanes, int nframes) {
+        if (nlanes == L) {
+            for (int i = 0; i < nframes; i++) {
+                for (int k = 0; k < L; k++) {
+                    tile[i * L + k] = chans[k][i];
+                }
+            }
+            return;
+        }
+        memset(tile, 0, nframes * L * sizeof(T));
+        for (int k = 0; k < nlanes; k++) {
+            const S *in = chans[k];
+            for (int i = 0; i < nframes; i++) {
+                tile[i * L + k] = in[i];
+            }
+        }
+    }
+
+    /** De-interleave the first nlanes lanes of a tile into channel buffers */
+    template <class S>
+    static void scatter(S * const *chans, const T *tile, int nlanes, int nframes) {
+        for (int k = 0; k < nlanes; k++) {
+            S *out = chans[k];
+            for (int i = 0; i < nframes; i++) {
+                out[i] = tile[i * L + k];
+            }
+        }
+    }
+
+private:
+    int m_numChnls;
+    int m_numSections;
+    std::vector<T> m_coefs; /* [group][section][coef][lane] */
+    std::vector<T> m_state; /* [group][section][x1, x2, y1, y2][lane] */
+
+    T *coefs(int group, int section) { return &m_coefs[(group * m_numSections + section) * 5 * L]; }
+    T *state(int group, int section) { return &m_state[(group * m_numSections + section) * 4 * L]; }
+};
+
+} // al::
+
+#endif
@@ -0,0 +1,182 @@
+/*	Alloaudio --
+    Audio facilities for large multichannel systems
+
+    Copyright (C) 2014. AlloSphere Research Group, Media Arts & Technology, UCSB.
+    Copyright (C) 2014. The Regents of the University of California.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+        Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+        Neither the name of the University of California nor the names of its
+        contributors may be used to endorse or promote products derived from
+        this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+
+
+    File description:
+    Per-channel peak, RMS, true-peak and loudness meters accumulated in the
+    audio thread and aggregated in a consumer thread.
+*/
+
+
+#ifndef INC_AL_METER_HPP
+#define INC_AL_METER_HPP
+
+#include <vector>
+
+#include "allocore/types/al_SingleRWRingBuffer.hpp"
+#include "alloaudio/al_FilterBank.hpp"
+
+namespace al {
+
+/** Level and loudness meters for many channels.
+ *
+ * The audio thread calls process() with every block. It only accumulates,
+ * for each channel, the sample peak, the sum of squares and the 4x
+ * oversampled true peak over a metering period, and the mean square of the
+ * K-weighted signal over 100 ms loudness blocks. At the end of each period
+ * or block these are written to lock-free ring buffers. A consumer thread
+ * calls update() to read them and compute the levels, and the EBU R128 (ITU-R
+ * BS.1770) momentary (400 ms), short-term (3 s) and gated integrated
+ * loudness.
+ *
+ * As in BiquadBank, channels are processed 4 at a time on tiles interleaved
+ * by channel, so that the filters and accumulators of the 4 channels are
+ * computed together in SIMD registers. The filters run in single precision;
+ * the sums over a period are kept in double precision.
+ */
+class MeterBank
+{
+public:
+    enum { TRUE_PEAK_TAPS = 12 }; /* taps per phase of the oversampling filter */
+
+    /**
+     * @param numChnls number of channels metered
+     * @param sampleRate the audio sampling rate
+     * @param periodSamples number of samples in a metering period
+     */
+    MeterBank(int numChnls, double sampleRate, int periodSamples = 4410);
+    ~MeterBank();
+
+    int getNumChnls() const { return m_numChnls; }
+
+    /* Audio thread */
+
+    /** Set the number of samples of a metering period. A period in progress
+     * is shortened if it is longer than the new period.
+     */
+    void setPeriod(int samples);
+
+    /** Meter nframes samples of each channel buffer.
+     *
+     * @return the number of metering periods completed
+     */
+    int process(const float * const *chans, int nframes);
+
+    /* Consumer thread */
+
+    /** Read the values written by the audio thread.
+     *
+     * @return the number of metering periods read
+     */
+    int update();
+
+    /** Get the sample peak of a channel in the last metering period read */
+    float peak(int chan) const { return m_levels[chan]; }
+
+    /** Get the RMS level of a channel in the last metering period read */
+    float rms(int chan) const;
+
+    /** Get the true peak of a channel in the last metering period read. This
+     * is the peak of the signal oversampled 4 times with the interpolation
+     * filter of ITU-R BS.1770, and is never less than the sample peak.
+     */
+    float truePeak(int chan) const { return m_levels[2 * m_numChnls + chan]; }
+
+    /** Get the momentary loudness of a channel in LUFS */
+    float momentary(int chan) const;
+
+    /** Get the momentary loudness of all channels in LUFS */
+    float momentary() const;
+
+    /** Get the short-term loudness of all channels in LUFS */
+    float shortTerm() const;
+
+    /** Get the integrated loudness of all channels in LUFS since the
+     * loudness was reset, gated as specified by EBU R128.
+     */
+    float integrated() const;
+
+    /** Set the weight of a channel in the loudness of all channels. This is
+     * 1 by default. ITU-R BS.1770 uses 1.41 for surround channels and 0 for
+     * LFE channels.
+     */
+    void setChannelWeight(int chan, float weight);
+
+    /** Restart the measurement of integrated loudness */
+    void resetLoudness();
+
+    /** Get the number of periods and blocks dropped because the consumer did
+     * not read them in time.
+     */
+    int getDropped() const { return m_dropped; }
+
+private:
+    typedef BiquadBank<float> Bank;
+    enum { L = Bank::LANES, HIST_BINS = 1000 };
+
+    const int m_numChnls;
+    const int m_numGroups;
+
+    /* audio thread state */
+    int m_periodSamples, m_periodRemaining, m_periodFrames;
+    int m_blockSamples, m_blockRemaining;
+    std::vector<double> m_acc;      /* [group][peak, sum of squares, true peak, K-weighted sum of squares][lane] */
+    std::vector<float> m_history;   /* [group][TRUE_PEAK_TAPS - 1][lane] last input samples */
+    float m_tpSum[2][TRUE_PEAK_TAPS / 2], m_tpDiff[2][TRUE_PEAK_TAPS / 2];
+    Bank m_kweighting;
+    std::vector<float> m_record;
+    SingleRWRingBuffer *m_levelBuffer;
+    SingleRWRingBuffer *m_blockBuffer;
+    int m_dropped;
+
+    /* consumer thread state */
+    std::vector<float> m_levels;    /* [peak, mean square, true peak][channel] */
+    std::vector<float> m_blocks;    /* [block][channel] mean squares of the last 30 blocks */
+    int m_blockIndex, m_numBlocks;
+    std::vector<float> m_weights;
+    std::vector<int> m_histogram;   /* gating block counts from -70 to +30 LUFS in steps of 0.1 LU */
+
+    void accumulate(int group, float *ext, int nframes);
+    void writeLevels();
+    void writeBlock();
+    double blockEnergy(int chan, int numBlocks) const;
+    double energy(int numBlocks) const;
+
+    // not copyable
+    MeterBank(const MeterBank&);
+    MeterBank& operator=(const MeterBank&);
+};
+
+} // al::
+
+#endif
@@ -50,12 +50,11 @@
 
 #include "allocore/io/al_AudioIO.hpp"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
-#include "allocore/types/al_MsgQueue.hpp"
 #include "allocore/protocol/al_OSC.hpp"
 #include "allocore/system/al_Thread.hpp"
-
-
-typedef struct BUTTER_ BUTTER;
+#include "alloaudio/al_FilterBank.hpp"
+#include "alloaudio/al_Meter.hpp"
+#include "alloaudio/al_ParameterStore.hpp"
 
 namespace al {
 
@@ -87,6 +86,16 @@ typedef enum {
  * audio callback, after any synthesis and spatialization.
  *
  * It can be controlled by OSC over UDP.
+ *
+ * The setter functions can be called from a control thread (the OSC listener
+ * calls them from its own thread) while processBlock() runs in the audio
+ * thread. They store their values in a lock-free ParameterStore that
+ * processBlock() reads once per block. Gains, muting and the bass management
+ * frequency ramp to new values over the time set with setRampTime(), so
+ * changes, including bursts of OSC messages, do not cause clicks. Values set
+ * before the first call to processBlock() apply without a ramp. Room
+ * compensation coefficients are passed separately as whole sets (see
+ * setRoomCompensation()).
  */
 class OutputMaster : public osc::Recv
 {
@@ -123,6 +132,13 @@ class OutputMaster : public osc::Recv
      */
     void setMuteAll(bool muteAll);
 
+    /** Set the time in seconds over which gain, mute and bass management frequency
+     * changes are ramped. Gains ramp linearly per sample and the bass management
+     * frequency exponentially, recomputing the cross-over filters every block. A time
+     * of 0 applies changes at the start of the next block. The default is 10 ms.
+     */
+    void setRampTime(double seconds);
+
     /** If clipperOn is true, the output signal for a channel is clipped if it is greater
      * than the global gain set with setGlobalGain(). If false, there is no clipping.
      * It is recommended that for systems with large numbers of channels you set this to
@@ -130,10 +146,12 @@ class OutputMaster : public osc::Recv
      */
     void setClipperOn(bool clipperOn);
 
-    /** Set the frequency at which peak meter data is updated. During the update period,
-     * a single value (maximum sample peak) is stored, and will only be avialable once
-     * the period is completed, as this is passed to the non-audio context through a
-     * lock-free ring buffer.
+    /** Set the frequency at which meter data is updated. During the update period the
+     * audio thread only accumulates the sample peak, mean square and true peak of each
+     * channel, which will only be avialable once the period is completed, as they are
+     * passed to the non-audio context through a lock-free ring buffer. The meter
+     * thread publishes them over OSC at this rate. Loudness is measured on 100 ms
+     * blocks independently of this frequency.
      */
     void setMeterUpdateFreq(double freq);
 
@@ -150,58 +168,91 @@ class OutputMaster : public osc::Recv
      */
     void setSwIndeces(int i1, int i2, int i3, int i4);
 
-    /** Enable peak metering. If set to false, no meter values will be sent out via OSC,
-     * and no values will be provided by getMeterValues()
+    /** Set a section of the room compensation filter of a channel. Each channel has a
+     * cascade of 4 biquad sections computing y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2,
+     * which are pass-through until set. The filters are applied to the signal sent to
+     * the channel (after bass management high pass filtering) when enabled with
+     * setFiltersActive().
+     *
+     * The coefficients of all channels are published together and swapped in at the
+     * start of the next block processed, so a section never runs with a mix of old and
+     * new coefficients.
+     */
+    void setRoomCompensation(int channelIndex, int section,
+                             double b0, double b1, double b2, double a1, double a2);
+
+    /** Enable room compensation filtering. */
+    void setFiltersActive(bool active);
+
+    /** Enable metering. If set to false, no meter values will be sent out via OSC,
+     * and no values will be provided by getMeterValues() and getLevels().
+     *
+     * When sending is enabled, the meter thread sends for each channel N (counting
+     * from 1) /Alloaudio/meterdb/N, /Alloaudio/rmsdb/N and /Alloaudio/truepeakdb/N
+     * with the sample peak, RMS and true peak in dBFS, and /Alloaudio/loudness with
+     * the momentary, short-term and integrated loudness in LUFS.
      */
     void setMeterOn(bool meterOn);
 
-    /** Fill the values array with the peak meter values. Note that because the values
-     * are stored in a ringbuffer, this function cannot be used together with OSC meters
-     * as the OSC thread will empty the values before they are read here.
+    /** Fill the values array with the peak meter values of the last completed update
+     * period. Values are only returned once for each period, so if the meter thread
+     * sending OSC has already read them, nothing is returned until the next period.
      *
      * @return returns the number of meter values read.
      */
     int getMeterValues(float *values);
 
+    /** Fill the arrays, of getNumChnls() values each, with the sample peak, RMS and
+     * 4x oversampled true peak of each channel over the last completed update period.
+     * Any of the pointers may be NULL.
+     */
+    void getLevels(float *peak, float *rms, float *truePeak);
+
+    /** Get the EBU R128 momentary, short-term and gated integrated loudness of the
+     * output in LUFS, or -HUGE_VAL where there is no signal. Loudness is integrated
+     * from the time metering was enabled or resetLoudness() was called.
+     */
+    void getLoudness(float &momentary, float &shortTerm, float &integrated);
+
+    /** Set the weight of a channel in the loudness sum. All channels have weight 1 by
+     * default; subwoofers should usually be given weight 0, and surround channels
+     * 1.41 (see ITU-R BS.1770).
+     */
+    void setLoudnessWeight(int channelIndex, float weight);
+
+    /** Restart the integrated loudness measurement. */
+    void resetLoudness();
+
     /** Get the number of channels processed by this OutputMaster object */
     int getNumChnls();
 
     /** Process a block of audio data. The io object should come from a previous process,
      * like an Ambisonics or VBAP panner, as processBlock() processes the output buffer in
      * the io object in place.
+     *
+     * Channels are processed in groups of 4, each in a single pass: the bass management,
+     * room compensation and gain stages of the whole group run on tiles interleaved by
+     * channel, computing the filters of the 4 channels together in SIMD registers.
      */
     void processBlock(AudioIOData &io);
 
-    void setGainTimestamped(al_sec until,
-                            int channelIndex, double gain);
-    void setMasterGainTimestamped(al_sec until, double gain);
-    void setClipperOnTimestamped(al_sec until, bool on);
-    void setMuteAllTimestamped(al_sec until, bool on);
-    void setMeterOnTimestamped(al_sec until, bool on);
-    void setMeterupdateFreqTimestamped(al_sec until, double freq);
-    void setBassManagementFreqTimestamped(al_sec until, double freq);
-    void setBassManagementModeTimestamped(al_sec until, int mode);
-
 private:
     const int m_numChnls;
 
-    /* parameters */
-    std::vector<double> m_gains;
-    bool m_muteAll; // 0=no 1=yes
-    double m_masterGain;
-    bool m_clipperOn;
-    bool m_meterOn;
-    int m_meterUpdateSamples; /* number of samples between level updates */
+    /* parameters, indexed by parameter_t, followed by the 4 subwoofer indeces
+     * (see swSlot()) and the channel gains (see gainSlot()) */
+    ParameterStore m_params;
+    int m_rampSamples;
 
+    /* audio thread copies of the parameters */
     bass_mgmt_mode_t m_BassManagementMode;
     int swIndex[4]; /* support for 4 SW max */
+    double m_crossoverFreq; /* frequency of the current bass management filters */
 
-    MsgQueue m_parameterQueue;
-
-    /* output data */
-    std::vector<float> m_meters;
-    SingleRWRingBuffer m_meterBuffer;
-    int m_meterCounter; /* count samples for level updates */
+    /* output data, accumulated in the audio thread and read by the meter thread
+     * under m_meterMutex */
+    MeterBank m_meter;
+    int m_meterPeriods; /* update periods not yet read by getMeterValues() */
     std::string m_sendAddress;
     int m_sendPort;
     int m_runMeterThread;
@@ -209,12 +260,29 @@ private:
     pthread_mutex_t m_meterMutex;
     pthread_cond_t m_meterCond;
 
-    /* bass management filters */
-    std::vector<BUTTER *> m_lopass1, m_lopass2, m_hipass1, m_hipass2;
+    /* bass management filters (two cascaded sections each) and room compensation */
+    BiquadBank<double> m_lopass, m_hipass, m_roomComp;
+
+    /* room compensation coefficients, [chan][section][b0, b1, b2, a1, a2], passed
+     * to the audio thread through a triple buffer. The control thread edits
+     * m_roomCompEdit and publishes a copy of it, and processBlock() swaps in the
+     * latest copy, so neither thread waits for the other. */
+    enum { ROOMCOMP_FRESH = 4 }; /* set in m_roomCompShared when it was published */
+    std::vector<double> m_roomCompEdit;
+    std::vector<double> m_roomCompBufs[3];
+    int m_roomCompWrite; /* buffer the control thread publishes next */
+    int m_roomCompRead; /* buffer last loaded by the audio thread */
+    Atomic<int> m_roomCompShared; /* the third buffer */
+    Atomic<int> m_roomCompLock; /* serializes control threads */
 
     double m_framesPerSec; // Sample rate
 
+    static int swSlot(int i) { return PARAMETER_COUNT + i; }
+    static int gainSlot(int chan) { return PARAMETER_COUNT + 4 + chan; }
+
     int chanIsSubwoofer(int index);
+    void setCrossover(double frequency);
+    void loadRoomCompensation();
     void initializeData();
     void allocateChannels(int numChnls);
     static void *meterThreadFunc(void *arg);
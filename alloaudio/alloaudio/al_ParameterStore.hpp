@@ -0,0 +1,280 @@
+/*	Alloaudio --
+    Audio facilities for large multichannel systems
+
+    Copyright (C) 2014. AlloSphere Research Group, Media Arts & Technology, UCSB.
+    Copyright (C) 2014. The Regents of the University of California.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+        Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+
+        Neither the name of the University of California nor the names of its
+        contributors may be used to endorse or promote products derived from
+        this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+
+
+    File description:
+    Lock-free store of control parameters, ramped in the audio thread.
+*/
+
+
+#ifndef INC_AL_PARAMETERSTORE_HPP
+#define INC_AL_PARAMETERSTORE_HPP
+
+#include <cmath>
+#include <vector>
+
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/types/al_Conversion.hpp"
+
+namespace al {
+
+typedef enum {
+    RAMP_LINEAR = 0,
+    RAMP_EXPONENTIAL = 1
+} ramp_shape_t;
+
+/** Ramp of a parameter value towards a target over a number of samples.
+ *
+ * A linear ramp adds a constant step per sample. An exponential ramp
+ * multiplies by a constant factor per sample, so that gains ramp linearly in
+ * dB and frequencies linearly in octaves. Exponential ramps to or from values
+ * closer to zero than 1e-5 (-100 dB) start or end at 1e-5 instead, and ramps
+ * between values of different sign are linear. The ramp reaches the target
+ * exactly on its last sample.
+ *
+ * The ramp can be advanced per sample with next() or per block with
+ * advance().
+ */
+class ParameterRamp
+{
+public:
+    ParameterRamp(double value = 0.0) :
+        m_value(value), m_target(value), m_step(0), m_remaining(0), m_shape(RAMP_LINEAR) {}
+
+    /** Set the value immediately, stopping any ramp */
+    void set(double value) {
+        m_value = m_target = value;
+        m_remaining = 0;
+    }
+
+    /** Ramp from the current value to target over nsamples samples */
+    void rampTo(double target, int nsamples, ramp_shape_t shape = RAMP_LINEAR) {
+        if (nsamples <= 0 || target == m_value) {
+            set(target);
+            return;
+        }
+        m_target = target;
+        m_remaining = nsamples;
+        m_shape = shape;
+        if (shape == RAMP_EXPONENTIAL && m_value * target >= 0.0) {
+            const double minMag = 1e-5;
+            double sign = (m_value + target) < 0.0 ? -1.0 : 1.0;
+            if (fabs(m_value) < minMag) m_value = sign * minMag;
+            double end = fabs(target) < minMag ? sign * minMag : target;
+            m_step = pow(end / m_value, 1.0 / nsamples);
+        } else {
+            m_shape = RAMP_LINEAR;
+            m_step = (target - m_value) / nsamples;
+        }
+    }
+
+    /** Advance the ramp by one sample and return the new value */
+    double next() {
+        if (m_remaining > 0) {
+            if (--m_remaining == 0) {
+                m_value = m_target;
+            } else if (m_shape == RAMP_LINEAR) {
+                m_value += m_step;
+            } else {
+                m_value *= m_step;
+            }
+        }
+        return m_value;
+    }
+
+    /** Advance the ramp by nsamples samples and return the new value */
+    double advance(int nsamples) {
+        if (m_remaining > 0) {
+            if (nsamples >= m_remaining) {
+                set(m_target);
+            } else {
+                m_remaining -= nsamples;
+                if (m_shape == RAMP_LINEAR) {
+                    m_value += m_step * nsamples;
+                } else {
+                    m_value *= pow(m_step, nsamples);
+                }
+            }
+        }
+        return m_value;
+    }
+
+    double value() const { return m_value; }
+    double target() const { return m_target; }
+    bool ramping() const { return m_remaining > 0; }
+
+    /** Get the number of samples left in the ramp */
+    int remaining() const { return m_remaining; }
+
+private:
+    double m_value;
+    double m_target;
+    double m_step; /* increment (linear) or factor (exponential) per sample */
+    int m_remaining;
+    ramp_shape_t m_shape;
+};
+
+
+/** Parameters set from a control thread and ramped in the audio thread,
+ * without locks or memory allocation.
+ *
+ * A writer thread, normally a control or OSC thread, sets targets with
+ * set(). A single reader thread, normally the audio callback, calls update()
+ * once per block and then reads the ramps with ramp() or value(). Calls to
+ * set() from several threads are serialized with a spin lock that only
+ * writers take. Each parameter holds only its latest
+ * target, so a burst of writes between two blocks results in a single ramp
+ * from the current value to the last target, and writes can never overflow
+ * a queue. Writes that arrive while a ramp is in progress restart it from
+ * the current value. Targets written before the first update() are applied
+ * without a ramp.
+ *
+ * Each parameter is guarded by a sequence counter which is odd while it is
+ * being written. update() skips parameters caught in the middle of a write
+ * and picks them up on the next block, so neither thread ever waits for the
+ * other.
+ */
+class ParameterStore
+{
+public:
+    ParameterStore(int numParams = 0) : m_slots(0), m_numParams(0),
+        m_writeCount(0), m_writeLock(0), m_readCount(0), m_started(false) {
+        resize(numParams);
+    }
+
+    ~ParameterStore() { delete[] m_slots; }
+
+    /** Set the number of parameters and set them all to value. This is not
+     * thread safe and must be done before the reader and writer are started.
+     */
+    void resize(int numParams, double value = 0.0) {
+        delete[] m_slots;
+        m_slots = new Slot[numParams];
+        m_numParams = numParams;
+        for (int i = 0; i < numParams; i++) {
+            m_slots[i].target.store(punFU(value));
+        }
+        m_seen.assign(numParams, 0);
+        m_ramps.assign(numParams, ParameterRamp(value));
+        m_writeCount.store(0);
+        m_readCount = 0;
+        m_started = false;
+    }
+
+    int size() const { return m_numParams; }
+
+    /** Set the target of a parameter and the ramp to reach it from the
+     * value it has when the reader picks it up. Call from the writer thread.
+     */
+    void set(int index, double target, int rampSamples = 0, ramp_shape_t shape = RAMP_LINEAR) {
+        if (index < 0 || index >= m_numParams) return;
+        int unlocked = 0;
+        while (!m_writeLock.compareExchange(unlocked, 1)) {
+            unlocked = 0;
+            cpuRelax();
+        }
+        Slot &s = m_slots[index];
+        int seq = s.seq.load();
+        s.seq.store(seq + 1);
+        s.target.store(punFU(target));
+        s.ramp.store(rampSamples > 0 ? (rampSamples << 1) | shape : 0);
+        s.seq.store(seq + 2);
+        m_writeCount.store(m_writeCount.load() + 1);
+        m_writeLock.store(0);
+    }
+
+    /** Get the last target set by the writer. Call from the writer thread. */
+    double get(int index) const {
+        return punUF(m_slots[index].target.load());
+    }
+
+    /** Start ramps to the targets set since the last call. Call from the
+     * reader thread once per block, before reading the ramps.
+     */
+    void update() {
+        int writes = m_writeCount.load();
+        if (writes == m_readCount) return;
+        bool complete = true;
+        for (int i = 0; i < m_numParams; i++) {
+            Slot &s = m_slots[i];
+            int seq = s.seq.load();
+            if (seq == m_seen[i]) continue;
+            double target = punUF(s.target.load());
+            int ramp = s.ramp.load();
+            if ((seq & 1) || s.seq.load() != seq) {
+                complete = false; /* being written, retry next block */
+                continue;
+            }
+            m_seen[i] = seq;
+            if (m_started) {
+                m_ramps[i].rampTo(target, ramp >> 1, (ramp_shape_t) (ramp & 1));
+            } else {
+                m_ramps[i].set(target);
+            }
+        }
+        if (complete) m_readCount = writes;
+        m_started = true;
+    }
+
+    /** Get the ramp of a parameter. Call from the reader thread. */
+    ParameterRamp &ramp(int index) { return m_ramps[index]; }
+
+    /** Get the current value of a parameter. Call from the reader thread. */
+    double value(int index) const { return m_ramps[index].value(); }
+
+private:
+    struct Slot {
+        Atomic<int> seq;          /* odd while being written */
+        Atomic<uint64_t> target;  /* bits of the target value */
+        Atomic<int> ramp;         /* ramp samples << 1 | shape */
+    };
+
+    Slot *m_slots;
+    int m_numParams;
+    Atomic<int> m_writeCount;
+    Atomic<int> m_writeLock;
+
+    /* reader state */
+    std::vector<int> m_seen; /* sequence of the last target read */
+    std::vector<ParameterRamp> m_ramps;
+    int m_readCount;
+    bool m_started;
+
+    // not copyable
+    ParameterStore(const ParameterStore&);
+    ParameterStore& operator=(const ParameterStore&);
+};
+
+} // al::
+
+#endif
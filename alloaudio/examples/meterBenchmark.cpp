@@ -0,0 +1,65 @@
+/*
+Alloaudio Example: Meter Benchmark
+
+Description:
+This times MeterBank::process(), which computes the sample peak, RMS, 4x
+oversampled true peak and EBU R128 loudness blocks of 64 channels at 48 kHz,
+and reports the time taken as a percentage of the duration of the audio.
+A consumer thread reads the levels with MeterBank::update() ten times a
+second of audio, as the OutputMaster meter thread does.
+
+No audio device is started.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "alloaudio/al_Meter.hpp"
+#include "allocore/system/al_Time.hpp"
+
+using namespace al;
+
+static const int numChnls = 64;
+static const int numFrames = 256;
+static const int numBlocks = 3750; /* 20 s */
+static const double sampleRate = 48000;
+
+int main()
+{
+	std::vector<float> buffers(numChnls * numFrames);
+	std::vector<const float *> chans(numChnls);
+	for (int c = 0; c < numChnls; c++) {
+		chans[c] = &buffers[c * numFrames];
+	}
+	MeterBank meter(numChnls, sampleRate, 4800);
+
+	Timer timer;
+	double sec = 0;
+	int periods = 0;
+	for (int b = 0; b < numBlocks; b++) {
+		for (int c = 0; c < numChnls; c++) {
+			float *out = &buffers[c * numFrames];
+			for (int i = 0; i < numFrames; i++) {
+				out[i] = 0.25 * sin(0.01 * (c + 1) * (i + b * numFrames));
+			}
+		}
+		timer.start();
+		if (meter.process(&chans[0], numFrames) > 0) {
+			periods += meter.update();
+		}
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+	double duration = numBlocks * numFrames / sampleRate;
+
+	printf("%d channels, %d frames/buffer, %.0f Hz\n", numChnls, numFrames, sampleRate);
+	printf("metering: %8.2f us/buffer, %.2f%% of real time\n",
+		   sec * 1e6 / numBlocks, 100.0 * sec / duration);
+	printf("%d periods read, %d dropped\n", periods, meter.getDropped());
+	printf("channel 1: peak %.2f dBFS, RMS %.2f dBFS, true peak %.2f dBTP\n",
+		   20 * log10(meter.peak(0)), 20 * log10(meter.rms(0)), 20 * log10(meter.truePeak(0)));
+	printf("loudness: momentary %.2f, short-term %.2f, integrated %.2f LUFS\n",
+		   meter.momentary(), meter.shortTerm(), meter.integrated());
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+Alloaudio Example: OutputMaster Benchmark
+
+Description:
+This times OutputMaster::processBlock() on 60 channels for each bass
+management mode and with room compensation filters enabled. The full bass
+management mode is also computed one channel at a time, converting each
+channel to doubles and running the four Butterworth sections over it in
+separate passes as OutputMaster used to do, and compared with
+processBlock(), which runs the sections of 4 channels at once.
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "alloaudio/al_OutputMaster.hpp"
+#include "allocore/system/al_Time.hpp"
+
+using namespace al;
+
+static const int numChnls = 60;
+static const int numFrames = 256;
+static const int numBlocks = 2000;
+static const double sampleRate = 44100;
+static const double crossover = 150;
+
+static void fill(AudioIOData& io, int block)
+{
+	for (int c = 0; c < numChnls; c++) {
+		float *out = io.outBuffer(c);
+		for (int i = 0; i < numFrames; i++) {
+			out[i] = 0.5 * sin(0.003 * (c + 1) * (i + block * numFrames));
+		}
+	}
+}
+
+/* A Butterworth section of one channel */
+struct Section {
+	double b0, b1, b2, a1, a2, x1, x2, y1, y2;
+
+	Section(bool lowpass) : x1(0), x2(0), y1(0), y2(0) {
+		double w = crossover * (M_PI / sampleRate);
+		double lambda = lowpass ? 1.0 / tan(w) : tan(w);
+		double lambda_2 = lambda * lambda;
+		b0 = b2 = 1.0 / (1.0 + sqrt(2.0) * lambda + lambda_2);
+		b1 = lowpass ? 2.0 * b0 : -2.0 * b0;
+		a1 = lowpass ? 2.0 * b0 * (1.0 - lambda_2) : 2.0 * b0 * (lambda_2 - 1.0);
+		a2 = b0 * (1.0 - sqrt(2.0) * lambda + lambda_2);
+	}
+
+	void next(const double *in, double *out, int n) {
+		for (int i = 0; i < n; i++) {
+			out[i] = b0 * in[i] + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+			x2 = x1; x1 = in[i];
+			y2 = y1; y1 = out[i];
+		}
+	}
+};
+
+/* Full bass management one channel at a time */
+static void processPerChannel(AudioIOData& io, std::vector<Section>& lo, std::vector<Section>& hi, double gain)
+{
+	double bass_buf[numFrames], in_buf[numFrames], temp[numFrames], low[numFrames], high[numFrames];
+	memset(bass_buf, 0, sizeof(bass_buf));
+	for (int c = 0; c < numChnls; c++) {
+		float *out = io.outBuffer(c);
+		for (int i = 0; i < numFrames; i++) in_buf[i] = out[i];
+		lo[2*c].next(in_buf, temp, numFrames);
+		lo[2*c+1].next(temp, low, numFrames);
+		hi[2*c].next(in_buf, temp, numFrames);
+		hi[2*c+1].next(temp, high, numFrames);
+		for (int i = 0; i < numFrames; i++) bass_buf[i] += low[i];
+		for (int i = 0; i < numFrames; i++) {
+			out[i] = high[i] * gain;
+			if (out[i] > gain) out[i] = gain;
+		}
+	}
+	float *sw = io.outBuffer(numChnls - 1);
+	for (int i = 0; i < numFrames; i++) sw[i] = bass_buf[i];
+}
+
+static double run(OutputMaster& om, AudioIO& io)
+{
+	Timer timer;
+	double sec = 0;
+	for (int b = 0; b < numBlocks; b++) {
+		fill(io, b);
+		timer.start();
+		om.processBlock(io);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+	return sec;
+}
+
+int main()
+{
+	AudioIO io(numFrames, sampleRate, 0, 0, numChnls, 0);
+	std::vector<float> outRef, outBank;
+
+	/* reference */
+	std::vector<Section> lo(2 * numChnls, Section(true)), hi(2 * numChnls, Section(false));
+	Timer timer;
+	double base = 0;
+	for (int b = 0; b < numBlocks; b++) {
+		fill(io, b);
+		timer.start();
+		processPerChannel(io, lo, hi, 0.9);
+		timer.stop();
+		base += timer.elapsedSec();
+	}
+	outRef.assign(io.outBuffer(), io.outBuffer() + numChnls * numFrames);
+
+	printf("%d channels, %d frames/buffer\n", numChnls, numFrames);
+	printf("per channel, full:      %8.2f us/buffer\n", base * 1e6 / numBlocks);
+
+	const char *names[] = {"none", "mix", "lowpass", "highpass", "full"};
+	for (int mode = BASSMODE_NONE; mode < BASSMODE_COUNT; mode++) {
+		OutputMaster om(numChnls, sampleRate, "", -1);
+		om.setMasterGain(0.9);
+		om.setBassManagementFreq(crossover);
+		om.setBassManagementMode((bass_mgmt_mode_t) mode);
+		double sec = run(om, io);
+		printf("processBlock, %-9s %8.2f us/buffer", names[mode], sec * 1e6 / numBlocks);
+		if (mode == BASSMODE_FULL) {
+			outBank.assign(io.outBuffer(), io.outBuffer() + numChnls * numFrames);
+			double maxDiff = 0;
+			for (unsigned i = 0; i < outRef.size(); i++) {
+				double d = fabs(outRef[i] - outBank[i]);
+				if (d > maxDiff) maxDiff = d;
+			}
+			printf(" (%.1fx), max diff %g", base / sec, maxDiff);
+		}
+		printf("\n");
+	}
+
+	/* full bass management with a 4 section room compensation filter on every channel */
+	OutputMaster om(numChnls, sampleRate, "", -1);
+	om.setMasterGain(0.9);
+	om.setBassManagementFreq(crossover);
+	om.setBassManagementMode(BASSMODE_FULL);
+	for (int c = 0; c < numChnls; c++) {
+		for (int s = 0; s < 4; s++) {
+			om.setRoomCompensation(c, s, 0.9, -1.6, 0.75, -1.7, 0.76);
+		}
+	}
+	om.setFiltersActive(true);
+	double sec = run(om, io);
+	printf("processBlock, full+room %8.2f us/buffer\n", sec * 1e6 / numBlocks);
+	return 0;
+}
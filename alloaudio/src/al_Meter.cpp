@@ -0,0 +1,359 @@
+
+#include <cmath>
+#include <string.h>
+
+#include "alloaudio/al_Meter.hpp"
+
+using namespace al;
+
+/* 4x oversampling interpolation filter of ITU-R BS.1770-4, Annex 2 */
+static const double truePeakCoefs[4][MeterBank::TRUE_PEAK_TAPS] = {
+	{ 0.0017089843750,  0.0109863281250, -0.0196533203125,  0.0332031250000,
+	 -0.0594482421875,  0.1373291015625,  0.9721679687500, -0.1022949218750,
+	  0.0476074218750, -0.0266113281250,  0.0148925781250, -0.0083007812500},
+	{-0.0291748046875,  0.0292968750000, -0.0517578125000,  0.0891113281250,
+	 -0.1665039062500,  0.4650878906250,  0.7797851562500, -0.2003173828125,
+	  0.1015625000000, -0.0582275390625,  0.0330810546875, -0.0189208984375},
+	{-0.0189208984375,  0.0330810546875, -0.0582275390625,  0.1015625000000,
+	 -0.2003173828125,  0.7797851562500,  0.4650878906250, -0.1665039062500,
+	  0.0891113281250, -0.0517578125000,  0.0292968750000, -0.0291748046875},
+	{-0.0083007812500,  0.0148925781250, -0.0266113281250,  0.0476074218750,
+	 -0.1022949218750,  0.9721679687500,  0.1373291015625, -0.0594482421875,
+	  0.0332031250000, -0.0196533203125,  0.0109863281250,  0.0017089843750}
+};
+
+static const int maxChunk = 256; /* frames metered at once */
+static const int shortTermBlocks = 30;
+static const int momentaryBlocks = 4;
+
+static double loudness(double energy)
+{
+	return energy > 0 ? -0.691 + 10.0 * log10(energy) : -HUGE_VAL;
+}
+
+MeterBank::MeterBank(int numChnls, double sampleRate, int periodSamples) :
+	m_numChnls(numChnls), m_numGroups((numChnls + L - 1) / L),
+	m_periodSamples(periodSamples > 0 ? periodSamples : 1),
+	m_periodFrames(0),
+	m_blockSamples((int)(sampleRate / 10 + 0.5)),
+	m_acc(m_numGroups * 4 * L, 0.0),
+	m_history(m_numGroups * (TRUE_PEAK_TAPS - 1) * L, 0.0),
+	m_kweighting(numChnls, 2),
+	m_record(3 * numChnls),
+	m_dropped(0),
+	m_levels(3 * numChnls, 0.0f),
+	m_blocks(shortTermBlocks * numChnls, 0.0f),
+	m_weights(numChnls, 1.0f),
+	m_histogram(HIST_BINS, 0)
+{
+	m_periodRemaining = m_periodSamples;
+	m_blockRemaining = m_blockSamples;
+	m_levelBuffer = new SingleRWRingBuffer(64 * 3 * numChnls * sizeof(float));
+	m_blockBuffer = new SingleRWRingBuffer(64 * numChnls * sizeof(float));
+	resetLoudness();
+
+	const int H = TRUE_PEAK_TAPS - 1;
+	for (int p = 0; p < 2; p++) {
+		for (int j = 0; j < TRUE_PEAK_TAPS / 2; j++) {
+			m_tpSum[p][j] = truePeakCoefs[p][j] + truePeakCoefs[p][H - j];
+			m_tpDiff[p][j] = truePeakCoefs[p][j] - truePeakCoefs[p][H - j];
+		}
+	}
+
+	/* K-weighting filter of ITU-R BS.1770: a high shelf modelling the head
+	 * followed by a high pass, designed for any sample rate */
+	double K = tan(M_PI * 1681.974450955533 / sampleRate);
+	double Q = 0.7071752369554196;
+	double Vh = pow(10.0, 3.999843853973347 / 20.0);
+	double Vb = pow(Vh, 0.4996667741545416);
+	double a0 = 1.0 + K / Q + K * K;
+	double shelf[5] = {(Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0,
+					   (Vh - Vb * K / Q + K * K) / a0,
+					   2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0};
+	K = tan(M_PI * 38.13547087602444 / sampleRate);
+	Q = 0.5003270373238773;
+	a0 = 1.0 + K / Q + K * K;
+	for (int c = 0; c < numChnls; c++) {
+		m_kweighting.setCoefs(c, 0, shelf[0], shelf[1], shelf[2], shelf[3], shelf[4]);
+		m_kweighting.setCoefs(c, 1, 1.0, -2.0, 1.0,
+							  2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0);
+	}
+}
+
+MeterBank::~MeterBank()
+{
+	delete m_levelBuffer;
+	delete m_blockBuffer;
+}
+
+void MeterBank::setPeriod(int samples)
+{
+	if (samples < 1) samples = 1;
+	m_periodSamples = samples;
+	if (m_periodRemaining > samples) {
+		m_periodRemaining = samples;
+	}
+}
+
+int MeterBank::process(const float * const *chans, int nframes)
+{
+	const int H = TRUE_PEAK_TAPS - 1;
+	int written = 0;
+	int pos = 0;
+	float ext[(H + maxChunk) * L];
+	while (pos < nframes) {
+		/* split the block at the ends of periods and loudness blocks */
+		int n = nframes - pos;
+		if (n > maxChunk) n = maxChunk;
+		if (n > m_periodRemaining) n = m_periodRemaining;
+		if (n > m_blockRemaining) n = m_blockRemaining;
+		for (int group = 0; group < m_numGroups; group++) {
+			int chan0 = group * L;
+			int nlanes = m_numChnls - chan0 < L ? m_numChnls - chan0 : L;
+			const float *bufs[L];
+			for (int k = 0; k < nlanes; k++) {
+				bufs[k] = chans[chan0 + k] + pos;
+			}
+			BiquadBank<float, L>::gather(ext + H * L, bufs, nlanes, n);
+			accumulate(group, ext, n);
+		}
+		pos += n;
+		m_periodFrames += n;
+		m_periodRemaining -= n;
+		m_blockRemaining -= n;
+		if (m_periodRemaining == 0) {
+			writeLevels();
+			m_periodRemaining = m_periodSamples;
+			written++;
+		}
+		if (m_blockRemaining == 0) {
+			writeBlock();
+			m_blockRemaining = m_blockSamples;
+		}
+	}
+	return written;
+}
+
+void MeterBank::accumulate(int group, float *ext, int nframes)
+{
+	const int H = TRUE_PEAK_TAPS - 1;
+	const int half = TRUE_PEAK_TAPS / 2;
+	double *acc = &m_acc[group * 4 * L];
+	float *hist = &m_history[group * H * L];
+	float *in = ext + H * L;
+	float peak[L], sumsq[L], tpeak[L];
+	double ksumsq[L];
+	int i, j, k;
+	for (k = 0; k < L; k++) {
+		peak[k] = acc[0*L + k];
+		sumsq[k] = 0;
+		tpeak[k] = 0;
+		ksumsq[k] = 0;
+	}
+
+	for (i = 0; i < nframes; i++) {
+		const float *v = in + i * L;
+		for (k = 0; k < L; k++) {
+			float a = fabsf(v[k]);
+			peak[k] = a > peak[k] ? a : peak[k];
+			sumsq[k] += v[k] * v[k];
+		}
+	}
+
+	/* True peak, from the last TRUE_PEAK_TAPS input samples. Phases 3 and 2
+	 * of the interpolation filter are phases 0 and 1 reversed, so with
+	 * u = x[n - j] and w = x[n - H + j] the sum and difference of the
+	 * outputs of phases 0 and 3 (and of 1 and 2) are sums over j < TAPS/2
+	 * of (h[j] + h[H - j]) (u + w) and of (h[j] - h[H - j]) (u - w). The
+	 * larger magnitude of the two outputs is half the sum of the magnitudes
+	 * of their sum and difference. The sums are accumulated one tap at a
+	 * time over the whole tile, as contiguous loops that vectorize with or
+	 * without unrolling of the lane loops. */
+	memcpy(ext, hist, H * L * sizeof(float));
+	int n = nframes * L;
+	float s0[n], d0[n], s1[n], d1[n];
+	for (i = 0; i < n; i++) {
+		s0[i] = d0[i] = s1[i] = d1[i] = 0;
+	}
+	for (j = 0; j < half; j++) {
+		const float *u = ext + (H - j) * L, *w = ext + j * L;
+		float cs0 = m_tpSum[0][j], cd0 = m_tpDiff[0][j];
+		float cs1 = m_tpSum[1][j], cd1 = m_tpDiff[1][j];
+		for (i = 0; i < n; i++) {
+			float sum = u[i] + w[i], diff = u[i] - w[i];
+			s0[i] += cs0 * sum;
+			d0[i] += cd0 * diff;
+			s1[i] += cs1 * sum;
+			d1[i] += cd1 * diff;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		float a = fabsf(s0[i]) + fabsf(d0[i]);
+		float b = fabsf(s1[i]) + fabsf(d1[i]);
+		s0[i] = a > b ? a : b;
+	}
+	for (i = 0; i < nframes; i++) {
+		for (k = 0; k < L; k++) {
+			tpeak[k] = s0[i * L + k] > tpeak[k] ? s0[i * L + k] : tpeak[k];
+		}
+	}
+	memcpy(hist, ext + nframes * L, H * L * sizeof(float));
+
+	/* K-weighted signal for loudness */
+	m_kweighting.process(group, in, nframes);
+	for (i = 0; i < nframes; i++) {
+		const float *v = in + i * L;
+		for (k = 0; k < L; k++) {
+			ksumsq[k] += v[k] * v[k];
+		}
+	}
+
+	for (k = 0; k < L; k++) {
+		acc[0*L + k] = peak[k];
+		acc[1*L + k] += sumsq[k];
+		acc[2*L + k] = 0.5 * tpeak[k] > acc[2*L + k] ? 0.5 * tpeak[k] : acc[2*L + k];
+		acc[3*L + k] += ksumsq[k];
+	}
+}
+
+void MeterBank::writeLevels()
+{
+	float *peak = &m_record[0];
+	float *meansq = peak + m_numChnls;
+	float *tpeak = meansq + m_numChnls;
+	for (int c = 0; c < m_numChnls; c++) {
+		double *acc = &m_acc[(c / L) * 4 * L + c % L];
+		peak[c] = acc[0*L];
+		meansq[c] = acc[1*L] / m_periodFrames;
+		tpeak[c] = acc[2*L] > acc[0*L] ? acc[2*L] : acc[0*L];
+		acc[0*L] = acc[1*L] = acc[2*L] = 0;
+	}
+	m_periodFrames = 0;
+	size_t bytes = 3 * m_numChnls * sizeof(float);
+	if (m_levelBuffer->writeSpace() >= bytes) {
+		m_levelBuffer->write((const char *) peak, bytes);
+	} else {
+		m_dropped++;
+	}
+}
+
+void MeterBank::writeBlock()
+{
+	float *meansq = &m_record[0];
+	for (int c = 0; c < m_numChnls; c++) {
+		double *acc = &m_acc[(c / L) * 4 * L + c % L];
+		meansq[c] = acc[3*L] / m_blockSamples;
+		acc[3*L] = 0;
+	}
+	size_t bytes = m_numChnls * sizeof(float);
+	if (m_blockBuffer->writeSpace() >= bytes) {
+		m_blockBuffer->write((const char *) meansq, bytes);
+	} else {
+		m_dropped++;
+	}
+}
+
+int MeterBank::update()
+{
+	int periods = 0;
+	size_t bytes = 3 * m_numChnls * sizeof(float);
+	while (m_levelBuffer->readSpace() >= bytes) {
+		m_levelBuffer->read((char *) &m_levels[0], bytes);
+		periods++;
+	}
+	bytes = m_numChnls * sizeof(float);
+	while (m_blockBuffer->readSpace() >= bytes) {
+		m_blockBuffer->read((char *) &m_blocks[m_blockIndex * m_numChnls], bytes);
+		m_blockIndex = (m_blockIndex + 1) % shortTermBlocks;
+		m_numBlocks++;
+		/* gating blocks of 400 ms overlapping by 75%, with an absolute
+		 * threshold of -70 LUFS */
+		if (m_numBlocks >= momentaryBlocks) {
+			int bin = (int) floor((loudness(energy(momentaryBlocks)) + 70.0) * 10.0);
+			if (bin >= 0) {
+				m_histogram[bin < HIST_BINS ? bin : HIST_BINS - 1]++;
+			}
+		}
+	}
+	return periods;
+}
+
+float MeterBank::rms(int chan) const
+{
+	return sqrt(m_levels[m_numChnls + chan]);
+}
+
+double MeterBank::blockEnergy(int chan, int numBlocks) const
+{
+	if (numBlocks > m_numBlocks) numBlocks = m_numBlocks;
+	if (numBlocks == 0) return 0;
+	double sum = 0;
+	for (int b = 1; b <= numBlocks; b++) {
+		int index = (m_blockIndex - b + shortTermBlocks) % shortTermBlocks;
+		sum += m_blocks[index * m_numChnls + chan];
+	}
+	return sum / numBlocks;
+}
+
+double MeterBank::energy(int numBlocks) const
+{
+	double sum = 0;
+	for (int c = 0; c < m_numChnls; c++) {
+		if (m_weights[c] != 0) {
+			sum += m_weights[c] * blockEnergy(c, numBlocks);
+		}
+	}
+	return sum;
+}
+
+float MeterBank::momentary(int chan) const
+{
+	return loudness(blockEnergy(chan, momentaryBlocks));
+}
+
+float MeterBank::momentary() const
+{
+	return loudness(energy(momentaryBlocks));
+}
+
+float MeterBank::shortTerm() const
+{
+	return loudness(energy(shortTermBlocks));
+}
+
+float MeterBank::integrated() const
+{
+	/* mean energy of the blocks above the absolute threshold, then of those
+	 * above a relative threshold 10 LU below their loudness */
+	int start = 0;
+	double mean = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		double sum = 0;
+		int count = 0;
+		for (int b = start; b < HIST_BINS; b++) {
+			if (m_histogram[b]) {
+				sum += m_histogram[b] * pow(10.0, ((b + 0.5) * 0.1 - 70.0 + 0.691) / 10.0);
+				count += m_histogram[b];
+			}
+		}
+		if (count == 0) return -HUGE_VAL;
+		mean = sum / count;
+		start = (int) floor((loudness(mean) - 10.0 + 70.0) * 10.0);
+		if (start < 0) start = 0;
+	}
+	return loudness(mean);
+}
+
+void MeterBank::setChannelWeight(int chan, float weight)
+{
+	if (chan >= 0 && chan < m_numChnls) {
+		m_weights[chan] = weight;
+	}
+}
+
+void MeterBank::resetLoudness()
+{
+	std::fill(m_histogram.begin(), m_histogram.end(), 0);
+	m_blockIndex = 0;
+	m_numBlocks = 0;
+}
@@ -5,8 +5,6 @@
 #include "alloaudio/al_OutputMaster.hpp"
 #include "allocore/system/al_Time.hpp"
 
-#include "src/butter.c"
-
 //#include "firfilter.h"
 
 using namespace al;
@@ -14,7 +12,7 @@ using namespace al;
 OutputMaster::OutputMaster(int num_chnls, double sampleRate, const char *address, int port,
 						   const char *sendAddress, int sendPort, al_sec msg_timeout):
 	m_numChnls(num_chnls),
-	m_meterBuffer(1024 * sizeof(float)), m_framesPerSec(sampleRate),
+	m_meter(num_chnls, sampleRate), m_meterPeriods(0), m_framesPerSec(sampleRate),
 	osc::Recv(port, address, msg_timeout),
 	m_sendAddress(sendAddress), m_sendPort(sendPort)
 {
@@ -44,12 +42,6 @@ OutputMaster::OutputMaster(int num_chnls, double sampleRate, const char *address
 
 OutputMaster::~OutputMaster()
 {
-	for (int i = 0; i < m_numChnls; i++) {
-		butter_free(m_lopass1[i]);
-		butter_free(m_lopass2[i]);
-		butter_free(m_hipass1[i]);
-		butter_free(m_hipass2[i]);
-	}
 	stop(); /* Stops OSC listener */
 	m_runMeterThread = 0;
 	pthread_cond_signal(&m_meterCond);
@@ -59,13 +51,13 @@ OutputMaster::~OutputMaster()
 
 void OutputMaster::setMasterGain(double gain)
 {
-	m_masterGain = gain;
+	m_params.set(MASTER_GAIN, gain, m_rampSamples);
 }
 
 void OutputMaster::setGain(int channelIndex, double gain)
 {
 	if (channelIndex >= 0 && channelIndex < m_numChnls) {
-		m_gains[channelIndex] = gain;
+		m_params.set(gainSlot(channelIndex), gain, m_rampSamples);
 	} else {
 		//        printf("Alloaudio error: set_gain() for invalid channel %i", channelIndex);
 	}
@@ -73,55 +65,129 @@ void OutputMaster::setGain(int channelIndex, double gain)
 
 void OutputMaster::setMuteAll(bool muteAll)
 {
-	m_muteAll = muteAll;
+	m_params.set(MUTE_ALL, muteAll ? 1.0 : 0.0, m_rampSamples);
+}
+
+void OutputMaster::setRampTime(double seconds)
+{
+	m_rampSamples = seconds > 0 ? (int)(seconds * m_framesPerSec + 0.5) : 0;
 }
 
 void OutputMaster::setClipperOn(bool clipperOn)
 {
-	m_clipperOn = clipperOn;
+	m_params.set(CLIPPER, clipperOn ? 1.0 : 0.0);
 }
 
 void OutputMaster::setMeterUpdateFreq(double freq)
 {
-	m_meterUpdateSamples = (int)(m_framesPerSec/freq);
+	m_params.set(METER_UPDATE_SAMPLES, (int)(m_framesPerSec/freq));
 }
 
 void OutputMaster::setBassManagementFreq(double frequency)
 {
-	int i;
 	if (frequency > 0) {
-		for (i = 0; i < m_numChnls; i++) {
-			butter_set_fc(m_lopass1[i], frequency);
-			butter_set_fc(m_lopass2[i], frequency);
-			butter_set_fc(m_hipass1[i], frequency);
-			butter_set_fc(m_hipass2[i], frequency);
-		}
+		m_params.set(BASS_MNGMT_FREQ, frequency, m_rampSamples, RAMP_EXPONENTIAL);
 	}
 }
 
 void OutputMaster::setBassManagementMode(bass_mgmt_mode_t mode)
 {
 	if (mode >= 0 && mode < BASSMODE_COUNT) {
-		m_BassManagementMode = mode;
+		m_params.set(BASS_MNGMT_MODE, mode);
 	}
 }
 
 void OutputMaster::setSwIndeces(int i1, int i2, int i3, int i4)
 {
-	swIndex[0] = i1;
-	swIndex[1] = i1;
-	swIndex[2] = i1;
-	swIndex[3] = i1;
+	m_params.set(swSlot(0), i1);
+	m_params.set(swSlot(1), i2);
+	m_params.set(swSlot(2), i3);
+	m_params.set(swSlot(3), i4);
+}
+
+void OutputMaster::setRoomCompensation(int channelIndex, int section,
+									   double b0, double b1, double b2, double a1, double a2)
+{
+	if (channelIndex >= 0 && channelIndex < m_numChnls
+			&& section >= 0 && section < m_roomComp.getNumSections()) {
+		int unlocked = 0;
+		while (!m_roomCompLock.compareExchange(unlocked, 1)) {
+			unlocked = 0;
+			cpuRelax();
+		}
+		double *c = &m_roomCompEdit[(channelIndex * m_roomComp.getNumSections() + section) * 5];
+		c[0] = b0;
+		c[1] = b1;
+		c[2] = b2;
+		c[3] = a1;
+		c[4] = a2;
+		m_roomCompBufs[m_roomCompWrite] = m_roomCompEdit;
+		m_roomCompWrite = m_roomCompShared.exchange(m_roomCompWrite | ROOMCOMP_FRESH) & ~ROOMCOMP_FRESH;
+		m_roomCompLock.store(0);
+	}
+}
+
+void OutputMaster::setFiltersActive(bool active)
+{
+	m_params.set(FILTERS_ACTIVE, active ? 1.0 : 0.0);
 }
 
 void OutputMaster::setMeterOn(bool meterOn)
 {
-	m_meterOn = meterOn;
+	m_params.set(METER_ON, meterOn ? 1.0 : 0.0);
 }
 
 int OutputMaster::getMeterValues(float *values)
 {
-	return m_meterBuffer.read((char *) values, m_numChnls * sizeof(float));
+	int count = 0;
+	pthread_mutex_lock(&m_meterMutex);
+	m_meterPeriods += m_meter.update();
+	if (m_meterPeriods > 0) {
+		for (int i = 0; i < m_numChnls; i++) {
+			values[i] = m_meter.peak(i);
+		}
+		m_meterPeriods = 0;
+		count = m_numChnls;
+	}
+	pthread_mutex_unlock(&m_meterMutex);
+	return count;
+}
+
+void OutputMaster::getLevels(float *peak, float *rms, float *truePeak)
+{
+	pthread_mutex_lock(&m_meterMutex);
+	m_meterPeriods += m_meter.update();
+	for (int i = 0; i < m_numChnls; i++) {
+		if (peak) peak[i] = m_meter.peak(i);
+		if (rms) rms[i] = m_meter.rms(i);
+		if (truePeak) truePeak[i] = m_meter.truePeak(i);
+	}
+	pthread_mutex_unlock(&m_meterMutex);
+}
+
+void OutputMaster::getLoudness(float &momentary, float &shortTerm, float &integrated)
+{
+	pthread_mutex_lock(&m_meterMutex);
+	m_meterPeriods += m_meter.update();
+	momentary = m_meter.momentary();
+	shortTerm = m_meter.shortTerm();
+	integrated = m_meter.integrated();
+	pthread_mutex_unlock(&m_meterMutex);
+}
+
+void OutputMaster::setLoudnessWeight(int channelIndex, float weight)
+{
+	pthread_mutex_lock(&m_meterMutex);
+	m_meter.setChannelWeight(channelIndex, weight);
+	pthread_mutex_unlock(&m_meterMutex);
+}
+
+void OutputMaster::resetLoudness()
+{
+	pthread_mutex_lock(&m_meterMutex);
+	m_meter.update();
+	m_meter.resetLoudness();
+	pthread_mutex_unlock(&m_meterMutex);
 }
 
 int OutputMaster::getNumChnls()
@@ -131,70 +197,91 @@ int OutputMaster::getNumChnls()
 
 void OutputMaster::processBlock(AudioIOData &io)
 {
-	int i, chan = 0;
+	typedef BiquadBank<double> Bank;
+	const int L = Bank::LANES;
+	int i, k, group, chan;
 	int nframes = io.framesPerBuffer();
 	double bass_buf[nframes];
-	double filt_out[nframes];
-	double filt_low[nframes];
-	double in_buf[nframes];
-	double master_gain;
+	double tile[nframes * L];
+	double low[nframes * L];
+	double master_gain[nframes];
+
+	m_params.update();
+	m_BassManagementMode = (bass_mgmt_mode_t) (int) m_params.value(BASS_MNGMT_MODE);
+	for (k = 0; k < 4; k++) {
+		swIndex[k] = (int) m_params.value(swSlot(k));
+	}
+	if (m_roomCompShared.load() & ROOMCOMP_FRESH) {
+		m_roomCompRead = m_roomCompShared.exchange(m_roomCompRead) & ~ROOMCOMP_FRESH;
+		loadRoomCompensation();
+	}
+	double crossover = m_params.ramp(BASS_MNGMT_FREQ).advance(nframes);
+	if (crossover != m_crossoverFreq) {
+		setCrossover(crossover);
+	}
 
-	m_parameterQueue.update(0);
-	master_gain = m_masterGain * (m_muteAll ? 0.0 : 1.0);
+	/* per sample master gain, including muting */
+	ParameterRamp &master = m_params.ramp(MASTER_GAIN);
+	ParameterRamp &mute = m_params.ramp(MUTE_ALL);
+	for (i = 0; i < nframes; i++) {
+		master_gain[i] = master.next() * (1.0 - mute.next());
+	}
 	memset(bass_buf, 0, nframes * sizeof(double));
-	for (chan = 0; chan < m_numChnls; chan++) {
-		double gain = master_gain * m_gains[chan];
-		const float *in = io.outBuffer(chan);  // Yes, the input here is the output from previous runs for the io object
-		float *out = io.outBuffer(chan);
-		double filt_temp[nframes];
-		double *buf = bass_buf;
-
-		for (i = 0; i < nframes; i++) {
-			in_buf[i] = *in++;
+
+	bool clip = m_params.value(CLIPPER) != 0;
+	bool filters = m_params.value(FILTERS_ACTIVE) != 0;
+	bool bass = m_BassManagementMode != BASSMODE_NONE;
+	bool lowpass = m_BassManagementMode == BASSMODE_LOWPASS || m_BassManagementMode == BASSMODE_FULL;
+	bool highpass = m_BassManagementMode == BASSMODE_HIGHPASS || m_BassManagementMode == BASSMODE_FULL;
+
+	for (group = 0; group < m_lopass.getNumGroups(); group++) {
+		int chan0 = group * L;
+		int nlanes = m_numChnls - chan0 < L ? m_numChnls - chan0 : L;
+		float *bufs[L];
+		for (k = 0; k < nlanes; k++) {
+			bufs[k] = io.outBuffer(chan0 + k); // Yes, the input here is the output from previous runs for the io object
 		}
-		switch (m_BassManagementMode) {
-		case BASSMODE_NONE:
-			break;
-		case BASSMODE_MIX:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
-			}
-			break;
-		case BASSMODE_LOWPASS:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			break;
-		case BASSMODE_HIGHPASS:
-			for (i = 0; i < nframes; i++) {
-				filt_low[i] = in_buf[i];
-			}
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i];
+
+		Bank::gather(tile, bufs, nlanes, nframes);
+		if (bass) {
+			memcpy(low, tile, nframes * L * sizeof(double));
+			if (lowpass) {
+				m_lopass.process(group, low, nframes);
 			}
-			break;
-		case BASSMODE_FULL:
-			butter_next(m_lopass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_lopass2[chan], filt_temp, filt_low, nframes);
-			butter_next(m_hipass1[chan], in_buf, filt_temp, nframes);
-			butter_next(m_hipass2[chan], filt_temp, filt_out, nframes);
-			for (i = 0; i < nframes; i++) {
-				in_buf[i] = filt_out[i]; /* a bit inefficient to copy here, but makes code simpler below */
+			for (i = 0; i < nframes; i++) { /* accumulate SW signal */
+				for (k = 0; k < nlanes; k++) {
+					bass_buf[i] += low[i * L + k];
+				}
 			}
-			break;
-		default:
-			break;
 		}
-		for (i = 0; i < nframes; i++) { /* accumulate SW signal */
-			*buf++ += filt_low[i];
+		if (highpass) {
+			m_hipass.process(group, tile, nframes);
 		}
-		for (i = 0; i < nframes; i++) {
-			*out = in_buf[i] * gain;
-			if (m_clipperOn && *out > master_gain) {
-				*out = master_gain;
+		if (filters) {
+			m_roomComp.process(group, tile, nframes);
+		}
+
+		for (k = 0; k < nlanes; k++) {
+			float *out = bufs[k];
+			ParameterRamp &gain = m_params.ramp(gainSlot(chan0 + k));
+			if (gain.ramping()) {
+				for (i = 0; i < nframes; i++) {
+					float v = tile[i * L + k] * (gain.next() * master_gain[i]);
+					if (clip && v > master_gain[i]) {
+						v = master_gain[i];
+					}
+					out[i] = v;
+				}
+			} else {
+				double g = gain.value();
+				for (i = 0; i < nframes; i++) {
+					float v = tile[i * L + k] * (g * master_gain[i]);
+					if (clip && v > master_gain[i]) {
+						v = master_gain[i];
+					}
+					out[i] = v;
+				}
 			}
-			out++;
 		}
 	}
 	if (m_BassManagementMode != BASSMODE_NONE) {
@@ -208,83 +295,57 @@ void OutputMaster::processBlock(AudioIOData &io)
 			}
 		}
 	}
-	if (m_meterOn) {
+	if (m_params.value(METER_ON) != 0) {
+		const float *outs[m_numChnls];
 		for (chan = 0; chan < m_numChnls; chan++) {
-			float *out = io.outBuffer(chan);
-			for (i = 0; i < nframes; i++) {
-				if (m_meters[chan] < *out) {
-					m_meters[chan] = *out;
-				}
-				out++;
-			}
+			outs[chan] = io.outBuffer(chan);
 		}
-		m_meterCounter += nframes;
-		if (m_meterCounter >= m_meterUpdateSamples) {
-			m_meterBuffer.write( (char *) m_meters.data(), sizeof(float) * m_numChnls);
-			memset(m_meters.data(), 0, sizeof(float) * m_numChnls);
-			m_meterCounter = 0; // A little jitter but efficient
+		m_meter.setPeriod((int) m_params.value(METER_UPDATE_SAMPLES));
+		if (m_meter.process(outs, nframes) > 0) {
 			pthread_cond_signal(&m_meterCond);
 		}
 	}
 }
 
-void OutputMaster::setGainTimestamped(al_sec until, int channelIndex, double gain)
-{
-	setGain(channelIndex, gain);
-}
-
-void OutputMaster::setMasterGainTimestamped(al_sec until, double gain)
-{
-	setMasterGain(gain);
-}
-
-void OutputMaster::setClipperOnTimestamped(al_sec until, bool on)
-{
-	setClipperOn(on);
-}
-
-void OutputMaster::setMuteAllTimestamped(al_sec until, bool on)
-{
-	setMuteAll(on);
-}
-
-void OutputMaster::setMeterOnTimestamped(al_sec until, bool on)
-{
-	setMeterOn(on);
-}
-
-void OutputMaster::setMeterupdateFreqTimestamped(al_sec until, double freq)
-{
-	setMeterUpdateFreq(freq);
-}
-
-void OutputMaster::setBassManagementFreqTimestamped(al_sec until, double freq)
+int OutputMaster::chanIsSubwoofer(int index)
 {
-	setBassManagementFreq(freq);
+	int i;
+	for (i = 0; i < 4; i++) {
+		if (swIndex[i] == index && m_BassManagementMode != BASSMODE_NONE) return 1;
+	}
+	return 0;
 }
 
-void OutputMaster::setBassManagementModeTimestamped(al_sec until, int mode)
+void OutputMaster::setCrossover(double frequency)
 {
-	setBassManagementMode((bass_mgmt_mode_t) mode);
+	for (int i = 0; i < m_numChnls; i++) {
+		for (int section = 0; section < 2; section++) {
+			m_lopass.setButterworth(i, section, frequency, m_framesPerSec, true);
+			m_hipass.setButterworth(i, section, frequency, m_framesPerSec, false);
+		}
+	}
+	m_crossoverFreq = frequency;
 }
 
-int OutputMaster::chanIsSubwoofer(int index)
+void OutputMaster::loadRoomCompensation()
 {
-	int i;
-	for (i = 0; i < 4; i++) {
-		if (swIndex[i] == index && m_BassManagementMode != BASSMODE_NONE) return 1;
+	const double *c = &m_roomCompBufs[m_roomCompRead][0];
+	for (int i = 0; i < m_numChnls; i++) {
+		for (int section = 0; section < m_roomComp.getNumSections(); section++, c += 5) {
+			m_roomComp.setCoefs(i, section, c[0], c[1], c[2], c[3], c[4]);
+		}
 	}
-	return 0;
 }
 
 void OutputMaster::initializeData()
 {
-	m_masterGain = 0.0;
-	m_muteAll = false;
-	m_clipperOn = true;
+	setRampTime(0.01);
+	setMasterGain(0.0);
+	setMuteAll(false);
+	setClipperOn(true);
+	setFiltersActive(false);
 
-	m_meterCounter = 0;
-	m_meterOn = false;
+	setMeterOn(false);
 
 	setBassManagementMode(BASSMODE_NONE);
 	setBassManagementFreq(150);
@@ -293,53 +354,58 @@ void OutputMaster::initializeData()
 
 void OutputMaster::allocateChannels(int numChnls)
 {
-	m_gains.resize(numChnls);
-	m_meters.resize(numChnls);
-	m_lopass1.resize(numChnls);
-	m_lopass2.resize(numChnls);
-	m_hipass1.resize(numChnls);
-	m_hipass2.resize(numChnls);
-	swIndex[0] = numChnls - 1;
-	swIndex[1] =  swIndex[2] = swIndex[3] = -1;
+	m_params.resize(gainSlot(numChnls));
+	m_lopass.resize(numChnls, 2);
+	m_hipass.resize(numChnls, 2);
+	m_roomComp.resize(numChnls, 4);
+	m_roomCompEdit.resize(numChnls * 4 * 5);
+	for (int i = 0; i < numChnls * 4; i++) {
+		m_roomCompEdit[i * 5] = 1.0; /* pass-through */
+	}
+	for (int i = 0; i < 3; i++) {
+		m_roomCompBufs[i] = m_roomCompEdit;
+	}
+	m_roomCompWrite = 0;
+	m_roomCompRead = 1;
+	m_roomCompShared.store(2);
+	m_roomCompLock.store(0);
+	m_crossoverFreq = 0;
+	setSwIndeces(numChnls - 1, -1, -1, -1);
 
 	for (int i = 0; i < numChnls; i++) {
-		m_gains[i] = 1.0;
-		m_meters[i] = 0;
-		m_lopass1[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_lopass2[i] = butter_create(m_framesPerSec, BUTTER_LP);
-		m_hipass1[i] = butter_create(m_framesPerSec, BUTTER_HP);
-		m_hipass2[i] = butter_create(m_framesPerSec, BUTTER_HP);
+		m_params.set(gainSlot(i), 1.0);
 	}
 }
 
 void *OutputMaster::meterThreadFunc(void *arg) {
-	int chanindex = 0;
 	OutputMaster *om = static_cast<OutputMaster *>(arg);
-	float meter_levels[om->m_numChnls];
+	MeterBank &meter = om->m_meter;
+	int dropped = 0;
 
 	al::osc::Send s(om->m_sendPort, om->m_sendAddress.c_str());
 	while(om->m_runMeterThread) {
 		pthread_mutex_lock(&om->m_meterMutex);
 		pthread_cond_wait(&om->m_meterCond, &om->m_meterMutex);
-		int bytes_read = om->m_meterBuffer.read((char *) meter_levels, om->m_numChnls * sizeof(float));
-		if (bytes_read) {
-			if (bytes_read !=  om->m_numChnls * sizeof(float)) {
-				std::cerr << "Alloaudio: Warning. Meter values underrun." << std::endl;
+		om->m_meterPeriods += meter.update();
+		if (om->m_meterPeriods > 0) {
+			if (meter.getDropped() != dropped) {
+				dropped = meter.getDropped();
+				std::cerr << "Alloaudio: Warning. Meter values overrun." << std::endl;
 			}
-			for (int i = 0; i < bytes_read/sizeof(float); i++) {
-			  std::stringstream addr;
-			  addr << "/Alloaudio/meterdb/" <<  chanindex + 1;
-				//            lo_send(t, "/Alloaudio/meter", "if", i, meter_levels[i]);
-				//            lo_send(t, "/Alloaudio/meterdb", "if", i, 20.0 * log10(meter_levels[i]));
-				//            lo_send(t, addr, "f", 20.0 * log10(meter_levels[i]));
-				//            lo_send(t, addr, "f", meter_levels[i]);
-			  s.send(addr.str(),
-				 (float) (20.0 * log10(meter_levels[i])));
-			  chanindex++;
-				if (chanindex == om->m_numChnls) {
-					chanindex = 0;
-				}
+			for (int i = 0; i < om->m_numChnls; i++) {
+				std::stringstream addr;
+				addr << "/Alloaudio/meterdb/" << i + 1;
+				s.send(addr.str(), (float) (20.0 * log10(meter.peak(i))));
+				addr.str("");
+				addr << "/Alloaudio/rmsdb/" << i + 1;
+				s.send(addr.str(), (float) (20.0 * log10(meter.rms(i))));
+				addr.str("");
+				addr << "/Alloaudio/truepeakdb/" << i + 1;
+				s.send(addr.str(), (float) (20.0 * log10(meter.truePeak(i))));
 			}
+			s.send("/Alloaudio/loudness", meter.momentary(), meter.shortTerm(),
+				   meter.integrated());
+			om->m_meterPeriods = 0;
 		}
 		pthread_mutex_unlock(&om->m_meterMutex);
 	}
@@ -353,10 +419,7 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 			int chan;
 			float gain;
 			m >> chan >> gain;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster,
-												&OutputMaster::setGainTimestamped,
-												chan, (double) gain);
+			outputmaster->setGain(chan, (double) gain);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/gain message: "
 					  << m.typeTags() << std::endl;
@@ -365,10 +428,7 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "f") {
 			float gain;
 			m >> gain;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster,
-												&OutputMaster::setMasterGainTimestamped,
-												(double) gain);
+			outputmaster->setMasterGain((double) gain);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/global_gain message: "
 					  << m.typeTags() << std::endl;
@@ -377,17 +437,11 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "i") {
 			int clipper_on;
 			m >> clipper_on;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster,
-												&OutputMaster::setClipperOnTimestamped,
-												(bool) clipper_on != 0);
+			outputmaster->setClipperOn((bool) clipper_on != 0);
 		} else if (m.typeTags() == "f") {
 			float clipper_on;
 			m >> clipper_on;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster,
-												&OutputMaster::setClipperOnTimestamped,
-												(bool) clipper_on != 0);
+			outputmaster->setClipperOn((bool) clipper_on != 0);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/clipper_on: "
 					  << m.typeTags() << std::endl;
@@ -396,15 +450,11 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "i") {
 			int mute_all;
 			m >> mute_all;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setMuteAllTimestamped,
-												(bool) mute_all != 0);
+			outputmaster->setMuteAll((bool) mute_all != 0);
 		} else if (m.typeTags() == "f") {
 			float mute_all;
 			m >> mute_all;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setMuteAllTimestamped,
-												(bool) mute_all != 0);
+			outputmaster->setMuteAll((bool) mute_all != 0);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/mute_all: "
 					  << m.typeTags() << std::endl;
@@ -413,15 +463,11 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "i") {
 			int on;
 			m >> on;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setMeterOnTimestamped,
-												(bool) on != 0);
+			outputmaster->setMeterOn((bool) on != 0);
 		} else if (m.typeTags() == "f") {
 			float on;
 			m >> on;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setMeterOnTimestamped,
-												(bool) on != 0);
+			outputmaster->setMeterOn((bool) on != 0);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/meter_update_freq: "
 					 << m.typeTags() << std::endl;
@@ -430,9 +476,7 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "f") {
 			float freq;
 			m >> freq;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setMeterupdateFreqTimestamped,
-												(double) freq);
+			outputmaster->setMeterUpdateFreq((double) freq);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/meter_update_freq: "
 					 << m.typeTags() << std::endl;
@@ -441,15 +485,11 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "i") {
 			int mode;
 			m >> mode;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setBassManagementModeTimestamped,
-												(int) mode);
+			outputmaster->setBassManagementMode((bass_mgmt_mode_t) mode);
 		} else if (m.typeTags() == "f") {
 			float mode;
 			m >> mode;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setBassManagementModeTimestamped,
-												(int) mode);
+			outputmaster->setBassManagementMode((bass_mgmt_mode_t) (int) mode);
 		} else{
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/bass_management_mode: "
 					 << m.typeTags() << std::endl;
@@ -458,13 +498,20 @@ void OutputMaster::OSCHandler::onMessage(osc::Message &m)
 		if (m.typeTags() == "f") {
 			float freq;
 			m >> freq;
-			outputmaster->m_parameterQueue.send(outputmaster->m_parameterQueue.now(),
-												outputmaster, &OutputMaster::setBassManagementFreqTimestamped,
-												(double) freq);
+			outputmaster->setBassManagementFreq((double) freq);
 		} else {
 			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/bass_management_freq: "
 					 << m.typeTags() << std::endl;
 		}
+	} else if (m.addressPattern() == "/Alloaudio/ramp_time") {
+		if (m.typeTags() == "f") {
+			float seconds;
+			m >> seconds;
+			outputmaster->setRampTime((double) seconds);
+		} else {
+			std::cerr << "Alloaudio: Wrong type tags for /Alloaudio/ramp_time: "
+					 << m.typeTags() << std::endl;
+		}
 	} else {
 		std::cout << "Alloaudio: Unrecognized address pattern: " << m.addressPattern() << std::endl;
 	}
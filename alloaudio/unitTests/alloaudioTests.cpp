@@ -1,7 +1,10 @@
 
+#include <math.h>
 #include <stdio.h>
+#include <vector>
 //#include <iostream>
 
+#include "alloaudio/al_Meter.hpp"
 #include "alloaudio/al_OutputMaster.hpp"
 #include "allocore/system/al_Time.hpp"
 
@@ -32,6 +35,7 @@ void test_gains(void)
 {
 	al::OutputMaster outmaster(2, 44100);
 	outmaster.setClipperOn(false);
+	outmaster.setRampTime(0);
 //    AudioIO(int framesPerBuf=64, double framesPerSec=44100.0,
 //		void (* callback)(AudioIOData &) = 0, void * userData = 0,
 //		int outChans = 2, int inChans = 0 )
@@ -89,6 +93,39 @@ void test_meter_values(void)
     CU_ASSERT_DOUBLE_EQUAL(meterValues[1], 0.75, 0.000001);
 }
 
+void test_meter_levels(void)
+{
+	const int n = 48000;
+	al::MeterBank meter(2, 48000, n);
+	std::vector<float> in_0(n), in_1(n);
+	for (int i = 0; i < n; i++) {
+		in_0[i] = sin(2 * M_PI * 997 * i / 48000.0);
+		// A sine at a quarter of the sample rate sampled 45 degrees off its peaks
+		in_1[i] = 0.5 * sin(M_PI * (i + 0.5) / 2);
+	}
+	const float *chans[2] = {&in_0[0], &in_1[0]};
+	meter.setChannelWeight(1, 0);
+	CU_ASSERT(meter.process(chans, 1000) == 0);
+	CU_ASSERT(meter.process(chans + 0, 0) == 0);
+	const float *rest[2] = {&in_0[1000], &in_1[1000]};
+	CU_ASSERT(meter.process(rest, n - 1000) == 1);
+	CU_ASSERT(meter.update() == 1);
+
+	CU_ASSERT_DOUBLE_EQUAL(meter.peak(0), 1.0, 0.001);
+	CU_ASSERT_DOUBLE_EQUAL(meter.rms(0), sqrt(0.5), 0.001);
+	CU_ASSERT_DOUBLE_EQUAL(meter.peak(1), 0.5 * sqrt(0.5), 0.000001);
+	CU_ASSERT_DOUBLE_EQUAL(meter.rms(1), 0.5 * sqrt(0.5), 0.000001);
+	CU_ASSERT(meter.truePeak(1) > 0.49 && meter.truePeak(1) < 0.51);
+
+	// A full scale 997 Hz sine reads -3.01 LUFS (ITU-R BS.1770)
+	CU_ASSERT_DOUBLE_EQUAL(meter.momentary(0), -3.01, 0.02);
+	CU_ASSERT_DOUBLE_EQUAL(meter.momentary(), -3.01, 0.02);
+	CU_ASSERT_DOUBLE_EQUAL(meter.shortTerm(), -3.01, 0.02);
+	CU_ASSERT_DOUBLE_EQUAL(meter.integrated(), -3.01, 0.05);
+	meter.resetLoudness();
+	CU_ASSERT(meter.integrated() < -1000);
+}
+
 void test_clipper(void)
 {
 	al::OutputMaster outmaster(2, 44100, "localhost", 9001);
@@ -117,10 +154,80 @@ void test_clipper(void)
 	}
 }
 
+void test_room_compensation(void)
+{
+	al::OutputMaster outmaster(5, 44100, "", -1);
+	outmaster.setClipperOn(false);
+	outmaster.setMasterGain(1.0);
+	for (int c = 0; c < 5; c++) {
+		outmaster.setGain(c, 1.0);
+	}
+	outmaster.setRoomCompensation(0, 0, 0.5, 0.0, 0.0, 0.0, 0.0); // gain
+	outmaster.setRoomCompensation(4, 3, 0.0, 1.0, 0.0, 0.0, 0.0); // one sample delay
+
+	al::AudioIO io(4, 44100.0, NULL, NULL, 5, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		outmaster.setFiltersActive(pass == 1);
+		for (int c = 0; c < 5; c++) {
+			for (int i = 0; i < 4; i++) {
+				io.outBuffer(c)[i] = 0.1 * (i + 1);
+			}
+		}
+		outmaster.processBlock(io);
+		for (int i = 0; i < 4; i++) {
+			CU_ASSERT_DOUBLE_EQUAL(io.outBuffer(0)[i], (pass ? 0.05 : 0.1) * (i + 1), 0.000001);
+			CU_ASSERT_DOUBLE_EQUAL(io.outBuffer(1)[i], 0.1 * (i + 1), 0.000001);
+			CU_ASSERT_DOUBLE_EQUAL(io.outBuffer(4)[i], pass ? 0.1 * i : 0.1 * (i + 1), 0.000001);
+		}
+	}
+}
+
+void test_ramps(void)
+{
+	al::OutputMaster outmaster(2, 44100, "", -1);
+	outmaster.setClipperOn(false);
+	outmaster.setMasterGain(1.0);
+	outmaster.setRampTime(4/44100.0); // 4 samples
+	al::AudioIO io(4, 44100.0, NULL, NULL, 2, 0);
+	float *out_0 = io.outBuffer(0);
+	float *out_1 = io.outBuffer(1);
+
+	for (int i = 0; i < 4; i++) {
+		out_0[i] = out_1[i] = 1.0;
+	}
+	outmaster.processBlock(io); // Values set before the first block are not ramped
+	for (int i = 0; i < 4; i++) {
+		CU_ASSERT_DOUBLE_EQUAL(out_0[i], 1.0, 0.000001);
+		CU_ASSERT_DOUBLE_EQUAL(out_1[i], 1.0, 0.000001);
+	}
+
+	outmaster.setGain(0, 0.0);
+	outmaster.setGain(0, 0.5); // Only the last value is ramped to
+	for (int i = 0; i < 4; i++) {
+		out_0[i] = out_1[i] = 1.0;
+	}
+	outmaster.processBlock(io);
+	for (int i = 0; i < 4; i++) {
+		CU_ASSERT_DOUBLE_EQUAL(out_0[i], 1.0 - 0.125 * (i + 1), 0.000001);
+		CU_ASSERT_DOUBLE_EQUAL(out_1[i], 1.0, 0.000001);
+	}
+
+	outmaster.setMuteAll(true);
+	for (int i = 0; i < 4; i++) {
+		out_0[i] = out_1[i] = 1.0;
+	}
+	outmaster.processBlock(io);
+	for (int i = 0; i < 4; i++) {
+		CU_ASSERT_DOUBLE_EQUAL(out_0[i], 0.5 * 0.25 * (3 - i), 0.000001);
+		CU_ASSERT_DOUBLE_EQUAL(out_1[i], 0.25 * (3 - i), 0.000001);
+	}
+}
+
 void test_osc_gain(void)
 {
 	al::OutputMaster outmaster(2, 44100, "localhost", 9001);
 	outmaster.setClipperOn(false);
+	outmaster.setRampTime(0);
 	al::osc::Send s(9001, "localhost");
 	s.send("/Alloaudio/global_gain", 0.1f);
 	s.send("/Alloaudio/gain", 0, 0.9f);
@@ -248,7 +355,10 @@ int main()
     if ( (NULL == CU_add_test(pSuite, "Test Class", test_class))
          ||  (NULL == CU_add_test(pSuite, "Test Gains", test_gains))
          ||  (NULL == CU_add_test(pSuite, "Test Meter Values", test_meter_values))
+		 ||  (NULL == CU_add_test(pSuite, "Test Meter Levels", test_meter_levels))
 		 ||  (NULL == CU_add_test(pSuite, "Test Clipper", test_clipper))
+		 ||  (NULL == CU_add_test(pSuite, "Test Room Compensation", test_room_compensation))
+		 ||  (NULL == CU_add_test(pSuite, "Test Parameter Ramps", test_ramps))
 		 ||  (NULL == CU_add_test(pSuite, "Test OSC Gain control", test_osc_gain))
 		 ||  (NULL == CU_add_test(pSuite, "Test OSC Meters", test_osc_meters))
 		 ||  (NULL == CU_add_test(pSuite, "Test OSC Other messages", test_osc_other))
@@ -53,6 +53,7 @@
 #include "allocore/graphics/al_Texture.hpp"
 #include "allocore/io/al_App.hpp"
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/io/al_AudioRenderer.hpp"
 #include "allocore/io/al_ControlNav.hpp"
 #include "allocore/io/al_File.hpp"
 #include "allocore/io/al_Socket.hpp"
@@ -60,6 +61,7 @@
 #include "allocore/math/al_Analysis.hpp"
 #include "allocore/math/al_Complex.hpp"
 #include "allocore/math/al_Constants.hpp"
+#include "allocore/math/al_FFT.hpp"
 #include "allocore/math/al_Frustum.hpp"
 #include "allocore/math/al_Functions.hpp"
 #include "allocore/math/al_Interpolation.hpp"
@@ -74,6 +76,7 @@
 #include "allocore/protocol/al_OSC.hpp"
 #include "allocore/protocol/al_Serialize.hpp"
 #include "allocore/sound/al_Reverb.hpp"
+#include "allocore/sound/al_Convolver.hpp"
 #include "allocore/sound/al_Speaker.hpp"
 #include "allocore/sound/al_AudioScene.hpp"
 #include "allocore/sound/al_Ambisonics.hpp"
@@ -86,8 +89,10 @@
 #include "allocore/system/al_MainLoop.hpp"
 #include "allocore/system/al_Printing.hpp"
 #include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
 #include "allocore/system/al_Time.hpp"
 #include "allocore/types/al_Buffer.hpp"
 #include "allocore/types/al_Conversion.hpp"
 #include "allocore/types/al_Array.hpp"
+#include "allocore/types/al_ObjectQueue.hpp"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
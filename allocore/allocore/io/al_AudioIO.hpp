@@ -45,6 +45,7 @@
 
 #include <string>
 #include <vector>
+#include "allocore/io/al_AudioProfiler.hpp"
 
 namespace al{
 
@@ -176,11 +177,12 @@ public:
 	double framesPerSecond() const;		///< Get frames/second of audio I/O streams
 	double fps() const { return framesPerSecond(); }
 	double secondsPerBuffer() const;	///< Get seconds/buffer of audio I/O stream
-	double time() const;				///< Get current stream time in seconds
+	double time() const;				///< Get current stream time in seconds (frames processed / fps when no stream is running)
 	double time(int frame) const;		///< Get current stream time in seconds of frame
 
 	void user(void * v){ mUser=v; }		///< Set user data
 	void frame(int v){ mFrame=v-1; }	///< Set frame count for next iteration
+	void zeroIn();						///< Zeros all the input buffers
 	void zeroBus();						///< Zeros all the bus buffers
 	void zeroOut();						///< Zeros all the internal output buffers
 
@@ -223,7 +225,8 @@ public:
 	/// @param[in] outChans			Number of output channels to open
 	/// @param[in] inChans			Number of input channels to open
 	/// If the number of input or output channels is greater than the device
-	/// supports, virtual buffers will be created.
+	/// supports, virtual buffers will be created. If there is no device, all
+	/// channels are virtual, which allows offline rendering with AudioRenderer.
 	AudioIO(
 		int framesPerBuf=64, double framesPerSec=44100.0,
 		void (* callback)(AudioIOData &) = 0, void * userData = 0,
@@ -249,10 +252,32 @@ public:
 	int channels(bool forOutput) const;
 	bool clipOut() const { return mClipOut; }	///< Returns clipOut setting
 	double cpu() const;							///< Returns current CPU usage of audio thread
+	bool profiling() const { return mProfiling; }	///< Returns whether callbacks are being timed
+	bool nonInterleaved() const { return mNonInterleaved; }	///< Returns whether device buffers are non-interleaved
 	bool supportsFPS(double fps) const;			///< Return true if fps supported, otherwise false
 	bool zeroNANs() const;						///< Returns whether to zero NANs in output buffer going to DAC
 
 	void processAudio();						///< Call callback manually
+
+	/// Process one buffer as the device stream does
+
+	/// This zeros the output buffers if autoZeroOut() is set, calls
+	/// processAudio(), then applies the gain ramp, NaN zeroing and clipping
+	/// to the device output channels. Input buffers are left as they are.
+	void processBuffer();
+
+	/// Process one buffer of a device stream
+
+	/// This is called by the device stream for each buffer. The first
+	/// inChans input and outChans output channels are read from and written
+	/// to the device buffers, which are either interleaved sample arrays or,
+	/// if nonInterleavedBufs is true, arrays of pointers to the buffers of each
+	/// channel. When non-interleaved device buffers follow each other in
+	/// memory and there are no virtual channels, they are used in place of the
+	/// internal buffers, so callbacks read and write the device buffers
+	/// directly. Otherwise, channels are copied whole rather than sample by
+	/// sample.
+	void processDevice(const void * input, void * output, int inChans, int outChans, bool nonInterleavedBufs);
 	bool open();								///< Opens audio device.
 	bool close();								///< Closes audio device. Will stop active IO.
 	bool start();								///< Starts the audio IO.  Will open audio device if necessary.
@@ -278,6 +303,26 @@ public:
 	void framesPerBuffer(int n);				///< Set number of frames per processing buffer
 	void zeroNANs(bool v){ mZeroNANs=v; }		///< Set whether to zero NANs in output buffer going to DAC
 
+	/// Set whether to open the device with non-interleaved buffers
+
+	/// Non-interleaved device buffers save the conversion to and from the
+	/// internal buffers, which are non-interleaved. If the host API does not
+	/// support them, this is set back to false when the stream is opened.
+	/// Setting this on an open stream reopens it.
+	void nonInterleaved(bool v);
+
+	/// Set whether to time blocks and callbacks
+
+	/// When on, the processing time of each block and of each callback is
+	/// recorded in profiler(). Slot 0 of the profiler holds the callback
+	/// function and slot i+1 the ith appended AudioCallback. The cost is three
+	/// clock reads per block and one per callback.
+	void profiling(bool v){ mProfiling=v; }
+
+	/// Get timing statistics of blocks and callbacks (see profiling())
+	AudioProfiler& profiler(){ return mProfiler; }
+	const AudioProfiler& profiler() const { return mProfiler; }
+
 	void print();								///< Prints info about current i/o devices to stdout.
 
 	static const char * errorText(int errNum);		// Returns error string.
@@ -287,6 +332,9 @@ private:
 	bool mZeroNANs;			// whether to zero NANs
 	bool mClipOut;			// whether to clip output between -1 and 1
 	bool mAutoZeroOut;		// whether to automatically zero output buffers each block
+	bool mProfiling;		// whether to time blocks and callbacks
+	bool mNonInterleaved;	// whether device buffers are non-interleaved
+	AudioProfiler mProfiler;
 	std::vector<AudioCallback *> mAudioCallbacks;
 
 	void init();			//
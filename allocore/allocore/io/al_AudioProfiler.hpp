@@ -0,0 +1,170 @@
+#ifndef INCLUDE_AL_AUDIO_PROFILER_HPP
+#define INCLUDE_AL_AUDIO_PROFILER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Lock-free timing statistics of audio callbacks
+*/
+
+#include <stdio.h>
+#include "allocore/system/al_Atomic.hpp"
+
+namespace al{
+
+
+/// Timing statistics of the callbacks of an audio stream
+
+/// The audio thread times each block and each callback in it, and adds the
+/// times to histograms and counters held in atomic variables. Recording
+/// takes a read of a monotonic clock and a few stores per callback; it
+/// never blocks or allocates, so it can be left on in production. Any other
+/// thread can read the statistics at any time. Each value read is exact,
+/// but values read together may come from different blocks.
+///
+/// Callbacks are identified by slot number, from 0 to NUM_SLOTS-1. Times of
+/// callbacks in slots beyond the last are added to the last slot.
+///
+/// Histogram bins are spaced half an octave apart: bin i counts times in
+/// [binTime(i), binTime(i+1)), where binTime(i) = 2^(i/2) microseconds.
+/// Bin 0 also counts shorter times and the last bin longer times.
+class AudioProfiler{
+public:
+
+	enum{
+		NUM_SLOTS = 32,		///< Maximum number of callbacks timed separately
+		NUM_BINS = 32		///< Number of histogram bins
+	};
+
+	/// Statistics of a callback or of whole blocks
+	struct Stats{
+		int count;				///< Number of times recorded
+		double meanSec;			///< Mean time in seconds
+		double maxSec;			///< Worst-case time in seconds
+		int bins[NUM_BINS];		///< Histogram of times
+
+		/// Get an upper bound of the time below which a fraction of times fall
+		double percentileSec(double fraction) const;
+	};
+
+	AudioProfiler();
+
+
+	// Audio thread
+
+	/// Get the time of a monotonic clock in nanoseconds
+	static long long now();
+
+	/// Start timing a block that must be processed within deadlineSec seconds
+	void beginBlock(double deadlineSec);
+
+	/// Record the time taken by the callback in a slot
+	void record(int slot, long long nsec);
+
+	/// Finish timing a block
+	void endBlock();
+
+	/// Count a buffer underflow or overflow reported by the device
+	void xrun(){ mXruns.store(mXruns.load() + 1); }
+
+
+	// Reader threads
+
+	/// Get statistics of the callback in a slot
+	Stats stats(int slot) const;
+
+	/// Get statistics of the processing time of whole blocks
+	Stats blockStats() const;
+
+	/// Get number of slots used since the last reset
+	int numSlots() const { return mNumSlots.load(); }
+
+	/// Get number of blocks timed
+	int blocks() const { return mBlock.count.load(); }
+
+	/// Get number of blocks whose processing took longer than their deadline
+	int deadlineMisses() const { return mDeadlineMisses.load(); }
+
+	/// Get number of buffer underflows and overflows reported by the device
+	int xruns() const { return mXruns.load(); }
+
+	/// Get longest time between the start of two blocks in seconds
+
+	/// A time much longer than the buffer duration means the audio thread
+	/// was not woken up in time.
+	double maxIntervalSec() const { return mMaxInterval.load() * 1e-9; }
+
+	/// Get the largest ratio of the processing time of a block to its deadline
+	double maxLoad() const { return mMaxLoad.load() * 1e-6; }
+
+	/// Clear all statistics. This takes effect at the start of the next block.
+	void reset(){ mResetRequest.store(1); }
+
+	/// Print statistics of blocks and of each slot to a file
+	void print(FILE * fp = stdout) const;
+
+	/// Get the lower edge of a histogram bin in seconds
+	static double binTime(int bin);
+
+private:
+	struct Counters{
+		Atomic<int> count;
+		Atomic<int> maxNsec;
+		Atomic<long long> sumNsec;
+		Atomic<int> bins[NUM_BINS];
+	};
+
+	Counters mSlots[NUM_SLOTS];
+	Counters mBlock;
+	Atomic<int> mNumSlots;
+	Atomic<int> mDeadlineMisses;
+	Atomic<int> mXruns;
+	Atomic<int> mMaxInterval;		// nsec
+	Atomic<int> mMaxLoad;			// millionths
+	Atomic<int> mResetRequest;
+	long long mBlockStart, mPrevBlockStart;
+	long long mDeadline;			// nsec
+
+	static void add(Counters& c, long long nsec);
+	static Stats get(const Counters& c);
+	static void clear(Counters& c);
+
+	AudioProfiler(const AudioProfiler&);
+	AudioProfiler& operator=(const AudioProfiler&);
+};
+
+} // al::
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef INCLUDE_AL_AUDIO_RENDERER_HPP
+#define INCLUDE_AL_AUDIO_RENDERER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Offline, faster than real-time rendering of audio streams
+*/
+
+#include <string>
+#include <vector>
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Atomic.hpp"
+
+namespace al{
+
+
+/// Offline renderer of AudioIO streams
+
+/// An AudioRenderer runs the callbacks of AudioIO objects without an audio
+/// device, as fast as the CPU allows, and writes their output channels to
+/// memory or to 32-bit float WAV files. Each buffer is processed with
+/// AudioIO::processBuffer(), so gain, NaN zeroing and clipping are applied
+/// as for a device stream, and AudioIOData::time() advances with the
+/// rendered frames. Input channels read silence.
+///
+/// Each rendering is a job. The jobs of a renderer must use distinct AudioIO
+/// objects with independent callbacks, so that they can be spread over
+/// threads, e.g. to render several scenes or several sections of a show at
+/// once. The AudioIO objects need not be opened; a stream that is running
+/// should be stopped before rendering.
+///
+/// Example:
+/// @code
+///		AudioIO io(256, 48000, myCallback, &myData, 64, 0);
+///		AudioRenderer renderer;
+///		renderer.add(io, 60 * 48000, "show.wav");
+///		renderer.run();
+///		printf("%.1fx real time\n", renderer.realTimeFactor());
+/// @endcode
+class AudioRenderer{
+public:
+
+	/// @param[in] numThreads	number of threads to spread jobs over
+	AudioRenderer(int numThreads = 1);
+
+	~AudioRenderer();
+
+	/// Add a job rendering to memory
+
+	/// @param[in] io			stream to render
+	/// @param[in] numFrames	number of frames to render
+	/// @param[out] dst			non-interleaved output buffer of
+	///							io.channelsOut() channels of numFrames frames
+	AudioRenderer& add(AudioIO& io, int numFrames, float * dst);
+
+	/// Add a job rendering to a 32-bit float WAV file of io.channelsOut() channels
+	AudioRenderer& add(AudioIO& io, int numFrames, const std::string& path);
+
+	/// Remove all jobs
+	AudioRenderer& clear();
+
+	/// Set number of threads to spread jobs over
+	AudioRenderer& numThreads(int v){ mNumThreads = v<1 ? 1 : v; return *this; }
+
+	/// Render all jobs, returning whether all files were written
+	bool run();
+
+	int numJobs() const { return (int)mJobs.size(); }	///< Get number of jobs
+	int numThreads() const { return mNumThreads; }		///< Get number of threads
+
+	/// Get seconds of audio rendered by the last run(), summed over all jobs
+	double secondsRendered() const { return mSecondsRendered; }
+
+	/// Get wall clock seconds taken by the last run()
+	double secondsElapsed() const { return mSecondsElapsed; }
+
+	/// Get seconds of audio rendered per wall clock second by the last run()
+	double realTimeFactor() const;
+
+private:
+	struct Job{
+		AudioIO * io;
+		int numFrames;
+		float * dst;
+		std::string path;
+		bool ok;
+	};
+
+	std::vector<Job> mJobs;
+	int mNumThreads;
+	double mSecondsRendered, mSecondsElapsed;
+	Atomic<int> mNextJob;	// index of next job to render
+
+	static void * worker(void * user);
+	static bool render(Job& job);
+
+	AudioRenderer(const AudioRenderer&);
+	AudioRenderer& operator=(const AudioRenderer&);
+};
+
+} // al::
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef INCLUDE_AL_FFT_HPP
+#define INCLUDE_AL_FFT_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Fast Fourier transform of real-valued sequences
+*/
+
+#include <cmath>
+#include <vector>
+
+namespace al{
+
+/// Fast Fourier transform of real-valued sequences
+
+/// The transform size must be a power of two. A sequence of N real samples
+/// is transformed to and from its N/2+1 non-negative frequency bins, which
+/// are stored as separate arrays of real and imaginary parts so that
+/// operations on spectra (e.g., complex multiplication) are simple loops
+/// that the compiler can vectorize. Internally, the even and odd samples are
+/// transformed as the real and imaginary parts of a complex sequence of
+/// half the size.
+///
+/// The forward transform is not normalized and the inverse transform is
+/// scaled by the size, so a forward transform followed by an inverse
+/// transform multiplies the sequence by size().
+///
+/// The transform functions use internal buffers and are not reentrant.
+/// Apart from resize(), they do not allocate.
+template <class T = float>
+class RFFT{
+public:
+
+	/// @param[in] size		transform size; must be a power of two
+	RFFT(int size=0): mSize(0){ resize(size); }
+
+	/// Set transform size; must be a power of two
+	void resize(int size);
+
+	/// Get transform size
+	int size() const { return mSize; }
+
+	/// Get number of frequency bins, size()/2 + 1
+	int numBins() const { return mSize/2 + 1; }
+
+	/// Forward transform
+
+	/// @param[out] re		real parts of numBins() bins
+	/// @param[out] im		imaginary parts of numBins() bins
+	/// @param[ in] in		size() real input samples
+	void forward(T * re, T * im, const T * in);
+
+	/// Inverse transform, scaled by size()
+
+	/// @param[out] out		size() real output samples
+	/// @param[ in] re		real parts of numBins() bins
+	/// @param[ in] im		imaginary parts of numBins() bins
+	void inverse(T * out, const T * re, const T * im);
+
+protected:
+	int mSize;
+	std::vector<int> mBitRev;			// bit reversal permutation of half size
+	std::vector<T> mTwRe, mTwIm;		// twiddles of each stage, contiguous
+	std::vector<T> mPostRe, mPostIm;	// twiddles splitting even/odd spectra
+	std::vector<T> mZr, mZi;			// half size complex buffer
+
+	// In-place complex transform of half size; swap the real and imaginary
+	// arrays to get the (unnormalized) inverse
+	void complexFFT(T * re, T * im);
+};
+
+
+
+template <class T>
+void RFFT<T>::resize(int size){
+	if(size == mSize) return;
+	mSize = size;
+	const int M = size/2;
+	mBitRev.resize(M);
+	mTwRe.resize(M>0 ? M : 0); mTwIm.resize(mTwRe.size());
+	mPostRe.resize(M+1); mPostIm.resize(M+1);
+	mZr.resize(M); mZi.resize(M);
+	if(M < 1) return;
+
+	int bits = 0;
+	while((1<<bits) < M) ++bits;
+	for(int i=0; i<M; ++i){
+		int r = 0;
+		for(int b=0; b<bits; ++b) if(i & (1<<b)) r |= 1<<(bits-1-b);
+		mBitRev[i] = r;
+	}
+
+	// stage with half-length h uses twiddles [h-1, 2h-1)
+	for(int h=1; h<M; h*=2){
+		for(int j=0; j<h; ++j){
+			double phs = -M_PI * j / h;
+			mTwRe[h-1+j] = std::cos(phs);
+			mTwIm[h-1+j] = std::sin(phs);
+		}
+	}
+
+	for(int k=0; k<=M; ++k){
+		double phs = -2*M_PI * k / size;
+		mPostRe[k] = std::cos(phs);
+		mPostIm[k] = std::sin(phs);
+	}
+}
+
+template <class T>
+void RFFT<T>::complexFFT(T * re, T * im){
+	const int M = mSize/2;
+	for(int i=0; i<M; ++i){
+		int j = mBitRev[i];
+		if(j > i){
+			T t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	for(int h=1; h<M; h*=2){
+		const T * wr = &mTwRe[h-1];
+		const T * wi = &mTwIm[h-1];
+		for(int i=0; i<M; i+=2*h){
+			T * ar = re + i, * ai = im + i;
+			T * br = ar + h, * bi = ai + h;
+			for(int j=0; j<h; ++j){
+				T tr = br[j]*wr[j] - bi[j]*wi[j];
+				T ti = br[j]*wi[j] + bi[j]*wr[j];
+				br[j] = ar[j] - tr; bi[j] = ai[j] - ti;
+				ar[j] += tr; ai[j] += ti;
+			}
+		}
+	}
+}
+
+template <class T>
+void RFFT<T>::forward(T * re, T * im, const T * in){
+	const int M = mSize/2;
+	T * zr = &mZr[0], * zi = &mZi[0];
+	for(int i=0; i<M; ++i){ zr[i] = in[2*i]; zi[i] = in[2*i+1]; }
+	complexFFT(zr, zi);
+
+	// X[k] = E[k] + W^k O[k], where E and O are the spectra of the even and
+	// odd samples recovered from the conjugate symmetry of each
+	re[0] = zr[0] + zi[0]; im[0] = 0;
+	re[M] = zr[0] - zi[0]; im[M] = 0;
+	for(int k=1; k<M; ++k){
+		T ar = zr[k], ai = zi[k];
+		T br = zr[M-k], bi =-zi[M-k];
+		T er = T(0.5)*(ar + br), ei = T(0.5)*(ai + bi);
+		T or_= T(0.5)*(ai - bi), oi = T(0.5)*(br - ar);
+		re[k] = er + or_*mPostRe[k] - oi*mPostIm[k];
+		im[k] = ei + or_*mPostIm[k] + oi*mPostRe[k];
+	}
+}
+
+template <class T>
+void RFFT<T>::inverse(T * out, const T * re, const T * im){
+	const int M = mSize/2;
+	T * zr = &mZr[0], * zi = &mZi[0];
+	for(int k=0; k<M; ++k){
+		T ar = re[k], ai = im[k];
+		T br = re[M-k], bi =-im[M-k];
+		T er = ar + br, ei = ai + bi;
+		T dr = ar - br, di = ai - bi;
+		// O = (X[k] - conj(X[M-k])) W^-k; Z = E + iO
+		T or_= dr*mPostRe[k] + di*mPostIm[k];
+		T oi = di*mPostRe[k] - dr*mPostIm[k];
+		zr[k] = er - oi;
+		zi[k] = ei + or_;
+	}
+	complexFFT(zi, zr);
+	for(int i=0; i<M; ++i){ out[2*i] = zr[i]; out[2*i+1] = zi[i]; }
+}
+
+} // al::
+#endif
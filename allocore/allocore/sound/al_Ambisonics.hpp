@@ -62,6 +62,8 @@
 
 	Should be IIR, because it mostly affects LF.
 
+	This is applied per speaker and order by a frozen AmbiDecode; see AmbiDecode::nearFieldCompensation().
+
 	If we pass speaker distance, then we might also want to attenuate/delay speakers for irregular layouts.
 
 	@see "Near Field filters for Higher Order Ambisonics" Fons ADRIAENSEN
@@ -159,6 +161,32 @@ public:
 	/// @param[in ] numDecFrames	number of frames in time domain buffers
 	void decode(float * dec, const float * enc, int numDecFrames) const;
 
+	/// Freeze the decode weights into a matrix used for block decoding
+
+	/// When frozen, the weights of all speakers with a non-zero gain are
+	/// multiplied out into a padded matrix which is then applied to the
+	/// Ambisonic domain buffers in tiles of four speakers by frames. The
+	/// matrix is rebuilt whenever the speakers, flavor or order change.
+	/// Near-field compensation is only applied when frozen.
+	void freeze(bool v=true);
+
+	/// Returns whether the decode weights are frozen
+	bool frozen() const { return mFrozen; }
+
+	/// Set near-field compensation of a speaker
+
+	/// This compensates for the proximity effect of a speaker at a finite
+	/// distance d. The part of the speaker's signal decoded from the channels
+	/// of each order m > 0 is high-pass filtered by an m-th order filter
+	/// whose poles are the roots of the reverse Bessel polynomial of degree
+	/// m, scaled by c/d. For m = 1 this is a one-pole filter with its cutoff
+	/// at c / (2 pi d) Hz. The W channel is not filtered and orders above 3
+	/// are filtered as order 3.
+	/// @param[in] index		speaker index
+	/// @param[in] distance		distance of speaker, in meters; 0 disables
+	/// @param[in] sampleRate	sample rate of decoded signal
+	void nearFieldCompensation(int index, float distance, double sampleRate);
+
 	float decodeWeight(int speaker, int channel) const {
 		return mWeights[channel] * mDecodeMatrix[speaker * channels() + channel];
 	}
@@ -174,7 +202,7 @@ public:
 	void setSpeaker(int index, int deviceChannel, float azimuth, float elevation=0, float amp=1.f);
 	//void zero();					///< Zeroes out internal ambisonic frame.
 
-    void setSpeakers(Speakers *spkrs) { mSpeakers = spkrs; }
+    void setSpeakers(Speakers *spkrs) { mSpeakers = spkrs; if(mFrozen) freeze(); }
 
 //	float * azimuths();				///< Returns pointer to speaker azimuths.
 //	float * elevations();			///< Returns pointer to speaker elevations.
@@ -192,11 +220,31 @@ protected:
 	float mWOrder[5];			// weights for each order
 
     Speakers* mSpeakers;
+
+	std::vector<float> mFrozenMatrix;	// weights of active speakers, padded to kLanes rows
+	std::vector<int> mFrozenSpeakers;	// speaker index of each row
+	int mFrozenStride;					// channels per row, padded to kLanes
+	bool mFrozen;
+	std::vector<float> mNFCCutoffs;		// near-field filter cutoff of each speaker, in radians per sample; 0 if none
+	std::vector<int> mChannelOrders;	// order of each Ambisonic channel
+
+	// Biquad section of a near-field filter; first order sections have b2 = a2 = 0
+	struct NFCSection{ float b0, b1, b2, a1, a2; };
+	std::vector<NFCSection> mNFCSections;	// sections of the filters of orders 1 to order() of each row
+	int mNFCSectionsPerRow;
+	mutable std::vector<float> mNFCStates;	// two per section
+
+	static const int kLanes = 4;		// speakers decoded together
+	static const int kTile = 32;		// frames decoded together
+	static const int kMaxNFCOrder = 3;	// highest order with near-field compensation
+
     //float * mPositions;		// speakers' azimuths + elevations
 	//float * mFrame;			// an ambisonic channel frame used for decode(int)
 
 	void updateChanWeights();
 	void resizeArrays(int numChannels, int numSpeakers);
+	void decodeFrozen(float * dec, const float * enc, int numDecFrames) const;
+	void updateNFCSections(int row);
 
 	float decode(float * encFrame, int encNumChannels, int speakerNum);	// is this useful?
 
@@ -269,6 +317,61 @@ public:
 		}
 	}
 
+	/// Encode a block of time samples with weights ramped across the block
+
+	/// The weights are interpolated linearly from \p weightsBeg at the first
+	/// frame towards \p weightsEnd at the frame following the block. This
+	/// allows a moving source to be encoded with weights computed only once
+	/// per block.
+	/// @param[out] ambiChans	Ambisonic domain channels (non-interleaved)
+	/// @param[in ] input		time samples
+	/// @param[in ] numFrames	number of frames in time buffer
+	/// @param[in ] weightsBeg	channel weights at the start of the block
+	/// @param[in ] weightsEnd	channel weights at the end of the block
+	void encodeBlock(float * ambiChans, const float * input, int numFrames, const float * weightsBeg, const float * weightsEnd) const {
+		for(int c=0; c<channels(); ++c){
+			Spatializer::mixRamp(ambiChans + c*numFrames, input, weightsBeg[c], weightsEnd[c], numFrames);
+		}
+	}
+
+	/// Encode the time sample blocks of many sources
+
+	/// This accumulates the product of the (interpolated) weight matrix and
+	/// the source blocks into the Ambisonic domain channels. Each Ambisonic
+	/// channel is completed for all sources before moving to the next, so
+	/// that it stays in cache.
+	/// @param[out] ambiChans	Ambisonic domain channels (non-interleaved)
+	/// @param[in ] inputs		time samples of each source
+	/// @param[in ] numFrames	number of frames in time buffers
+	/// @param[in ] weightsBeg	weights at the start of the block, channels() per source
+	/// @param[in ] weightsEnd	weights at the end of the block, channels() per source
+	/// @param[in ] numSources	number of sources
+	void encodeBatch(float * ambiChans, const float * const * inputs, int numFrames, const float * weightsBeg, const float * weightsEnd, int numSources) const {
+		const int chans = channels();
+		for(int c=0; c<chans; ++c){
+			float * ambi = ambiChans + c*numFrames;
+			for(int s=0; s<numSources; ++s){
+				Spatializer::mixRamp(ambi, inputs[s], weightsBeg[s*chans + c], weightsEnd[s*chans + c], numFrames);
+			}
+		}
+	}
+
+	/// Encode the time sample blocks of many sources from their directions
+
+	/// (x,y,z unit vectors in the listener's coordinate frame at the start
+	/// and end of the block)
+	template <class XYZ>
+	void encodeBatch(float * ambiChans, const float * const * inputs, int numFrames, const XYZ * dirsBeg, const XYZ * dirsEnd, int numSources) const {
+		const int chans = channels();
+		float weightsBeg[numSources * chans];
+		float weightsEnd[numSources * chans];
+		for(int s=0; s<numSources; ++s){
+			encodeWeightsFuMa(weightsBeg + s*chans, mDim, mOrder, dirsBeg[s][0], dirsBeg[s][1], dirsBeg[s][2]);
+			encodeWeightsFuMa(weightsEnd + s*chans, mDim, mOrder, dirsEnd[s][0], dirsEnd[s][1], dirsEnd[s][2]);
+		}
+		encodeBatch(ambiChans, inputs, numFrames, weightsBeg, weightsEnd, numSources);
+	}
+
 	/// Set spherical direction of source to be encoded
 	void direction(float az, float el);
 
@@ -354,6 +457,9 @@ public:
 
     float * ambiChans(unsigned channel=0) { return &mAmbiDomainChannels[channel * mNumFrames]; }
 
+    /// Get decoder, e.g., to set near-field compensation of speakers
+    AmbiDecode& decoder(){ return mDecoder; }
+
     void compile(Listener& l){
         mListener = &l;
     }
@@ -386,6 +492,7 @@ public:
                                        mSpeakers[i].gain);
 		}
 
+		mDecoder.freeze();
 
     }
 
@@ -419,31 +526,43 @@ public:
     }
 
     /// Per buffer processing
+
+    /// The encoding weights are computed once per block from the listener's
+    /// orientation at the end of the block. They are then interpolated from
+    /// the weights used for the source in the previous block.
     void perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, float *samples){
 
-         // compute azimuth & elevation of relative position in current listener's coordinate frame:
-         Vec3d urel(relpos);
-         urel.normalize();	// unit vector in axis listener->source
-         // project into listener's coordinate frame:
-         //						Vec3d axis;
-         //						l.mQuatHistory[i].toVectorX(axis);
-         //						double rr = urel.dot(axis);
-         //						l.mQuatHistory[i].toVectorY(axis);
-         //						double ru = urel.dot(axis);
-         //						l.mQuatHistory[i].toVectorZ(axis);
-         //						double rf = urel.dot(axis);
-
-        for(int i = 0; i < numFrames; i++)
-        {
-            // cheaper:
-            Vec3d direction = mListener->mQuatHistory[i].rotateTransposed(urel);
-
-            //mEncoder.direction(azimuth, elevation);
-            //mEncoder.direction(-rf, -rr, ru);
-            mEncoder.direction(-direction[2], -direction[0], direction[1]);
-            mEncoder.encode(ambiChans(), numFrames, i, samples[i]);
+        // unit vector in axis listener->source, in listener's coordinate frame
+        Vec3d urel(relpos);
+        urel.normalize();
+        Vec3d direction = mListener->mQuatHistory[numFrames-1].rotateTransposed(urel);
+
+        float weights[16];
+        AmbiBase::encodeWeightsFuMa(weights, mEncoder.dim(), mEncoder.order(), -direction[2], -direction[0], direction[1]);
+
+        // a source that was never added has no weights to ramp from
+        SourceState unadded;
+        SourceState * found = mSourceStates.find(src);
+        SourceState& state = found ? *found : unadded;
+        if(!state.encoded){
+            memcpy(state.weights, weights, sizeof(weights));
+            state.encoded = true;
         }
 
+        mEncoder.encodeBlock(ambiChans(), samples, numFrames, state.weights, weights);
+        memcpy(state.weights, weights, sizeof(weights));
+    }
+
+    void addSource(SoundSource& src){
+        mSourceStates.add(src);
+    }
+
+    void removeSource(SoundSource& src){
+        mSourceStates.remove(src);
+    }
+
+    void resetSource(SoundSource& src){
+        mSourceStates.reset(src);
     }
 
 
@@ -459,9 +578,18 @@ public:
     }
 
 private:
+
+	// Encoding weights of a source at the end of the previous block
+	struct SourceState{
+		SourceState(): encoded(false){}
+		bool encoded;		// whether weights have been computed yet
+		float weights[16];	// weight of each Ambisonic channel
+	};
+
     AmbiDecode mDecoder;
     AmbiEncode mEncoder;
 	std::vector<float> mAmbiDomainChannels;
+	SourceStates<SourceState> mSourceStates;
     Listener* mListener;
     int mNumFrames;
 };
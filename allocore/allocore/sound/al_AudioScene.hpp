@@ -48,13 +48,18 @@
 #include <string.h>
 #include <vector>
 #include <list>
+#include <algorithm>
 #include "allocore/types/al_Buffer.hpp"
 #include "allocore/math/al_Interpolation.hpp"
 #include "allocore/math/al_Vec.hpp"
 #include "allocore/spatial/al_Pose.hpp"
+#include "allocore/spatial/al_DistAtten.hpp"
 #include "allocore/io/al_AudioIO.hpp"
+#include "allocore/sound/al_MixMatrix.hpp"
 #include "allocore/sound/al_Speaker.hpp"
 #include "allocore/sound/al_Reverb.hpp"
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
 
 namespace al{
 
@@ -98,11 +103,119 @@ namespace al{
 class Listener;
 class SoundSource;
 
+/// Per source state kept by a spatializer
+
+/// This is a hash table from sources to states. States are created with
+/// add(), usually from Spatializer::addSource(), and found with find() in
+/// constant time and without allocating, so from the audio thread. Sources
+/// are hashed by address, which must stay the same while they are added.
+template <class State>
+class SourceStates{
+public:
+
+	SourceStates(): mSize(0), mKeys(16, (const SoundSource *)0), mStates(16){}
+
+	/// Returns number of sources with a state
+	int size() const { return mSize; }
+
+	/// Create the state of a source, or reset it if already created
+	State& add(const SoundSource& src){
+		if(2*(mSize+1) > int(mKeys.size())) resize(mKeys.size() * 2);
+		unsigned i = slot(&src);
+		if(!mKeys[i]){
+			mKeys[i] = &src;
+			++mSize;
+		}
+		mStates[i] = State();
+		return mStates[i];
+	}
+
+	/// Remove the state of a source, if any
+	void remove(const SoundSource& src){
+		unsigned i = slot(&src);
+		if(!mKeys[i]) return;
+		mKeys[i] = 0;
+		--mSize;
+		// move back later entries of the probe sequence into the gap
+		const unsigned mask = mKeys.size()-1;
+		for(unsigned j = (i+1) & mask; mKeys[j]; j = (j+1) & mask){
+			unsigned home = hash(mKeys[j]) & mask;
+			if(((j - home) & mask) >= ((j - i) & mask)){
+				mKeys[i] = mKeys[j];
+				mStates[i] = mStates[j];
+				mKeys[j] = 0;
+				i = j;
+			}
+		}
+	}
+
+	/// Get the state of a source, or 0 if it has none
+	State * find(const SoundSource& src){
+		unsigned i = slot(&src);
+		return mKeys[i] ? &mStates[i] : 0;
+	}
+
+	/// Reset the state of a source, if it has one, without allocating
+	void reset(const SoundSource& src){
+		if(State * state = find(src)) *state = State();
+	}
+
+	/// Call a function object on the state of every source
+	template <class Func>
+	void forEach(Func& f){
+		for(unsigned i=0; i<mKeys.size(); ++i){
+			if(mKeys[i]) f(mStates[i]);
+		}
+	}
+
+	/// Remove all states
+	void clear(){
+		std::fill(mKeys.begin(), mKeys.end(), (const SoundSource *)0);
+		mSize = 0;
+	}
+
+private:
+	int mSize;
+	std::vector<const SoundSource *> mKeys;	// 0 where empty; size is a power of two
+	std::vector<State> mStates;
+
+	static unsigned hash(const SoundSource * src){
+		size_t h = size_t(src);
+		h ^= h >> 16;
+		h *= 0x45d9f3b;
+		h ^= h >> 16;
+		return unsigned(h);
+	}
+
+	// Index of the source, or of the empty slot where it would go
+	unsigned slot(const SoundSource * src) const {
+		const unsigned mask = mKeys.size()-1;
+		unsigned i = hash(src) & mask;
+		while(mKeys[i] && mKeys[i] != src) i = (i+1) & mask;
+		return i;
+	}
+
+	void resize(unsigned n){
+		std::vector<const SoundSource *> keys(n, (const SoundSource *)0);
+		std::vector<State> states(n);
+		keys.swap(mKeys);
+		states.swap(mStates);
+		for(unsigned i=0; i<keys.size(); ++i){
+			if(keys[i]){
+				unsigned j = slot(keys[i]);
+				mKeys[j] = keys[i];
+				mStates[j] = states[i];
+			}
+		}
+	}
+};
+
+
 /// Abstract class for all spatializers: Ambisonics, DBAP, VBAP, etc.
 class Dbap;
 class Spatializer {
 public:
-    Spatializer(SpeakerLayout& sl){
+    Spatializer(SpeakerLayout& sl): mMixer(0){
         unsigned numSpeakers = sl.mSpeakers.size();
 		for(unsigned i=0;i<numSpeakers;++i){
 			mSpeakers.push_back(sl.mSpeakers[i]);
@@ -137,10 +250,63 @@ public:
     /// called once per listener, after sources are rendered. ex. ambisonics decode
     virtual void finalize(AudioIOData& io){};
 
+    /// called when a source is added to a scene using this spatializer, ex. to create per source state
+    virtual void addSource(SoundSource& src){};
+
+    /// called when a source is removed from a scene using this spatializer
+    virtual void removeSource(SoundSource& src){};
+
+    /// called from the audio thread when an added source starts a new sound, ex. to reset per source state; must not allocate
+    virtual void resetSource(SoundSource& src){};
+
+    /// Returns whether per buffer perform() may be called concurrently for
+    /// different sources, each thread writing to its own io.
+    /// AudioScene renders sources in parallel only if this returns true.
+    virtual bool parallelSafe() const { return false; }
+
     int numSpeakers() const { return mSpeakers.size(); }
 
+	/// Accumulate a block of samples into an output buffer with a linear gain ramp
+
+	/// The loops are kept free of branches and aliasing-sensitive temporaries
+	/// so that the compiler can vectorize them.
+	static void mixRamp(float * out, const float * in, float gainBeg, float gainEnd, int numFrames){
+		if(gainBeg == gainEnd){
+			if(gainEnd == 0.f) return;
+			for(int i=0; i<numFrames; ++i) out[i] += in[i] * gainEnd;
+		}
+		else{
+			const float dgain = (gainEnd - gainBeg) / numFrames;
+			for(int i=0; i<numFrames; ++i) out[i] += in[i] * (gainBeg + dgain * float(i));
+		}
+	}
+
+    /// Set matrix that per buffer processing adds its gains to
+
+    /// When set, the spatializer adds the blocks it renders to the matrix
+    /// instead of mixing them into the output channels. The matrix must then
+    /// be mixed into the io after all sources have been rendered. Set to 0
+    /// to mix into the output channels directly.
+    void mixer(MixMatrix * m){ mMixer = m; }
+
+    /// Get matrix that per buffer processing adds its gains to, if any
+    MixMatrix * mixer() const { return mMixer; }
+
 protected:
     Speakers mSpeakers;
+    MixMatrix * mMixer;
+
+    // Begin mixing a block of samples into output channels; returns the
+    // mixer input of the block, or -1 if mixing directly
+    int mixBegin(const float * samples, int numFrames){
+        return mMixer ? mMixer->addInput(samples, numFrames) : -1;
+    }
+
+    // Mix a block of samples begun with mixBegin() into an output channel
+    void mix(AudioIOData& io, int input, int channel, const float * samples, float gainBeg, float gainEnd, int numFrames){
+        if(input >= 0)	mMixer->add(input, channel, gainBeg, gainEnd);
+        else			mixRamp(io.outBuffer(channel), samples, gainBeg, gainEnd, numFrames);
+    }
 
 };
 /////////////////////////////////////////////////////
@@ -160,20 +326,45 @@ public:
     void compile(){
 		isCompiled = true;
 		mSpatializer->compile(*(this));
+		if(mLodSpatializer) mLodSpatializer->compile(*(this));
 	}
 
+	/// Set a cheaper spatializer for distant sources (level of detail)
+
+	/// Sources further than the given distance from the listener are rendered
+	/// with this spatializer, such as a low order Ambisonics one, instead of
+	/// the listener's main spatializer. Sources crossing the distance are
+	/// crossfaded between both over one block. Pass 0 to disable.
+	/// Level of detail applies to the first 32 listeners of a scene and not
+	/// to sources rendered from a SoundSourceArray.
+	void lod(Spatializer * spatializer, double distance){
+		mLodSpatializer = spatializer;
+		mLodDistance = distance;
+		if(spatializer){
+			spatializer->numFrames(mQuatHistory.size());
+			if(isCompiled) spatializer->compile(*(this));
+		}
+	}
+
+	/// Get spatializer for distant sources (0 if none)
+	Spatializer * lodSpatializer() const { return mLodSpatializer; }
+
+	/// Get distance beyond which the level of detail spatializer is used
+	double lodDistance() const { return mLodDistance; }
+
 protected:
 	friend class AudioScene;
     friend class AmbisonicsSpatializer;
 
     Listener(int numFrames_, Spatializer *spatializer)
-	:	mSpatializer(spatializer), isCompiled(false){
+	:	mSpatializer(spatializer), isCompiled(false), mLodSpatializer(0), mLodDistance(0){
 		numFrames(numFrames_);
 	}
 
 	void numFrames(unsigned v){
 		if(mQuatHistory.size() != v) mQuatHistory.resize(v);
         mSpatializer->numFrames(v);
+		if(mLodSpatializer) mLodSpatializer->numFrames(v);
 	}
 
     Spatializer *mSpatializer;
@@ -184,6 +375,9 @@ protected:
 	ShiftBuffer<4, Vec3d> mPosHistory;		// position in previous blocks
 	Quatd mQuatPrev;						// orientation in previous block
 	Pose mPose;								// current position
+
+	Spatializer * mLodSpatializer;			// spatializer for distant sources
+	double mLodDistance;
 };
 
 
@@ -200,8 +394,17 @@ protected:
 */
 class SoundSource {
 public:
+
+	/// Delay-line interpolation types
+	enum Interpolation{
+		LINEAR,		/**< Linear interpolation between 2 samples */
+		CUBIC,		/**< Catmull-Rom cubic interpolation between 4 samples */
+		LAGRANGE3	/**< Third order Lagrange interpolation between 4 samples */
+	};
+
 	SoundSource(double rollOff=1.0, double near=1, double range=100, double ampFar=0.0, int bufSize=15000)
-	:	mSound(bufSize), mRollOff(rollOff), mNearClip(near), mClipRange(range), mAmpFar(ampFar), useAtten(true), useDoppler(true)
+	:	mSound(bufSize), mRollOff(rollOff), mNearClip(near), mClipRange(range), mAmpFar(ampFar), useAtten(true), useDoppler(true),
+		mInterp(LINEAR), mAttenTable(0), mAudible(true), mAudiblePrev(true), mLodMask(0), mLodMaskPrev(0)
     {
 		// initialize the position history to be VERY FAR AWAY so that we don't deafen ourselves...
 		mPosHistory(Vec3d(1000, 1000, 1000));
@@ -239,16 +442,45 @@ public:
         //TODO make enum for curves, make virtual
 
         if(!useAtten) return 1.0;
+		if(mAttenTable) return (*mAttenTable)(distance);
+		return attenuation(distance, mNearClip, mClipRange, mAmpFar);
+	}
+
+	/// Compute attentuation factors for a block of distances to listener
+	void attenuation(float * amps, const float * distances, int numDistances) const {
+		if(!useAtten){
+			for(int i=0; i<numDistances; ++i) amps[i] = 1.f;
+		}
+		else if(mAttenTable){
+			(*mAttenTable)(amps, distances, numDistances);
+		}
+		else{
+			for(int i=0; i<numDistances; ++i) amps[i] = attenuation(distances[i], mNearClip, mClipRange, mAmpFar);
+		}
+	}
+
+	/// Set a shared table of the attenuation law to use
 
-		if (distance < mNearClip) {
+	/// The table takes the place of the clipping and roll off parameters of
+	/// the source. Pass 0 to use the source's own attenuation curve again.
+	/// The table is not owned by the source and must outlive it.
+	void attenuationTable(const DistAttenTable<float> * v){ mAttenTable = v; }
+
+	/// Get shared attenuation table (0 if none)
+	const DistAttenTable<float> * attenuationTable() const { return mAttenTable; }
+
+	/// Returns attenuation factor for given distance and clipping parameters
+	static double attenuation(double distance, double nearClip, double clipRange, double ampFar){
+
+		if (distance < nearClip) {
 			return 1.0;
 		}
-        else if (distance > (mNearClip+mClipRange)) {
-			return mAmpFar;
+        else if (distance > (nearClip+clipRange)) {
+			return ampFar;
 		}
         else {
 			// normalized distance (0..1)
-			double dN = (distance-mNearClip) / (mClipRange);
+			double dN = (distance-nearClip) / (clipRange);
 
 			// different possible policies for amplitude attenuation
 			// amplitude curve (max/cosm):
@@ -259,7 +491,7 @@ public:
             // alternative methods using rollOff
 
 			double curve = 1-tanh(M_PI * dN*dN);
-			return mAmpFar + curve*(1.-mAmpFar);
+			return ampFar + curve*(1.-ampFar);
 		}
 
 	}
@@ -287,15 +519,120 @@ public:
 	/// Returns maximum index that can be used for reading samples
 	int maxIndex() const { return delaySize()-2; }
 
-	/// Read sample from delay-line using linear interpolation
+	/// Set delay-line interpolation type
+	void interpolation(Interpolation v){ mInterp = v; }
+
+	/// Get delay-line interpolation type
+	Interpolation interpolation() const { return mInterp; }
+
+	/// Read sample from delay-line using the interpolation type
 	/// The index specifies how many samples ago by which to read back from
-	/// the buffer. The index must be less than or equal to bufferSize()-2.
+	/// the buffer. The index must be less than or equal to bufferSize()-2,
+	/// or bufferSize()-3 for the four point interpolation types.
 	float readSample(double index) const {
 		int index0 = index;
-		float a = mSound.read(index0);
-		float b = mSound.read(index0+1);
 		float frac = index - index0;
-        return ipl::linear(frac, a, b);
+		float x = mSound.read(index0);
+		float y = mSound.read(index0+1);
+		switch(mInterp){
+		case CUBIC:
+			return ipl::cubic(frac, mSound.read(index0-1), x, y, mSound.read(index0+2));
+		case LAGRANGE3:{
+			float h[4];
+			ipl::lagrange3(h, 1.f + frac);
+			return h[0]*mSound.read(index0-1) + h[1]*x + h[2]*y + h[3]*mSound.read(index0+2);
+		}
+		default:
+			return ipl::linear(frac, x, y);
+		}
+	}
+
+	/// Read block of samples from delay-line with a linearly changing index
+
+	/// This is equivalent to calling readSample() with indices ramping from
+	/// indexBeg to indexEnd, but faster. Ramping the index, rather than holding
+	/// it over the block, gives a smooth Doppler shift for moving sources.
+	/// @param[out] out			output samples
+	/// @param[in] numFrames	number of samples to read
+	/// @param[in] indexBeg		index of first sample
+	/// @param[in] indexEnd		index the ramp reaches after numFrames samples
+	void readSamples(float * out, int numFrames, double indexBeg, double indexEnd) const {
+		readDelayLine(out, &mSound[0], mSound.size(), mSound.pos(),
+			indexBeg, (indexEnd-indexBeg)/numFrames, numFrames, mInterp);
+	}
+
+	/// Read block of samples from a delay-line with a linearly changing index
+
+	/// @param[out] out			output samples
+	/// @param[in] buf			delay-line buffer
+	/// @param[in] size			size of delay-line buffer
+	/// @param[in] newest		absolute index of newest sample in buffer
+	/// @param[in] index		read index, in samples ago, of first sample
+	/// @param[in] step			change of read index per sample
+	/// @param[in] numFrames	number of samples to read
+	/// @param[in] type			interpolation type
+	static void readDelayLine(
+		float * out, const float * buf, int size, int newest,
+		double index, double step, int numFrames, Interpolation type
+	){
+		if(numFrames <= 0) return;
+
+		// Range of indices read, including neighbors of four point kernels
+		double indexLast = index + step*(numFrames-1);
+		int lo = int(index < indexLast ? index : indexLast) - 1;
+		int hi = int(index < indexLast ? indexLast : index) + 2;
+
+		// If the range wraps around the end of the buffer, gather the four
+		// samples around each index and read them as a delay-line of their
+		// own, which does not wrap. This happens in few blocks.
+		if(newest - hi < 0 || newest - lo >= size){
+			for(int i=0; i<numFrames; ++i){
+				double idx = index + step*i;
+				int i0 = idx;
+				float s[4];		// samples i0+2 to i0-1 ago
+				for(int k=0; k<4; ++k){
+					int j = newest - (i0 + 2 - k);
+					if(j < 0) j += size;
+					else if(j >= size) j -= size;
+					s[k] = buf[j];
+				}
+				readDelayLine(out + i, s, 4, 3, idx - (i0 - 1), 0, 1, type);
+			}
+			return;
+		}
+
+		// Access samples as base[-i], i samples ago
+		const float * base = buf + newest;
+
+		switch(type){
+		case CUBIC:
+			for(int i=0; i<numFrames; ++i){
+				double idx = index + step*i;
+				int i0 = idx;
+				float f = idx - i0;
+				const float * p = base - i0;
+				out[i] = ipl::cubic(f, p[1], p[0], p[-1], p[-2]);
+			}
+			break;
+		case LAGRANGE3:
+			for(int i=0; i<numFrames; ++i){
+				double idx = index + step*i;
+				int i0 = idx;
+				float h[4];
+				ipl::lagrange3(h, 1.f + float(idx - i0));
+				const float * p = base - i0;
+				out[i] = h[0]*p[1] + h[1]*p[0] + h[2]*p[-1] + h[3]*p[-2];
+			}
+			break;
+		default:
+			for(int i=0; i<numFrames; ++i){
+				double idx = index + step*i;
+				int i0 = idx;
+				float f = idx - i0;
+				const float * p = base - i0;
+				out[i] = ipl::linear(f, p[0], p[-1]);
+			}
+		}
 	}
 
 	/// Set far clipping distance
@@ -325,6 +662,245 @@ protected:
 	double mNearClip, mClipRange, mAmpFar;
 
     bool useAtten, useDoppler;
+	Interpolation mInterp;
+	const DistAttenTable<float> * mAttenTable;
+
+	// culling and level of detail state of the current and previous block
+	bool mAudible, mAudiblePrev;
+	unsigned mLodMask, mLodMaskPrev;		// bit per listener using lod spatializer
+};
+
+
+
+/// Sound sources stored as a structure of arrays
+
+/// This is an alternative to adding individual SoundSource objects to an
+/// AudioScene, intended for scenes with many sources. The position,
+/// attenuation parameters and flags of all sources are stored in separate
+/// contiguous arrays, packed so that the active sources occupy the first
+/// size() elements, and the delay lines of all sources are stored in a
+/// single block of memory allocated on construction. Sources are referred to
+/// by handles which stay valid until the source is removed, regardless of
+/// other sources being added or removed.
+///
+/// Render the sources with AudioScene::render(io, sources). Only per buffer
+/// processing is supported.
+class SoundSourceArray {
+public:
+
+	/// Source handle
+	typedef unsigned Handle;
+
+	/// Handle returned when a source cannot be added
+	static Handle invalidHandle(){ return ~0u; }
+
+	/// @param[in] capacity		maximum number of sources (less than 2^20)
+	/// @param[in] delaySize	length of each source's delay line, in samples
+	SoundSourceArray(int capacity, int delaySize=15000)
+	:	mCapacity(capacity), mSize(0), mDelaySize(delaySize), mInterp(SoundSource::LINEAR),
+		mPos(capacity), mPosPrev(capacity), mNearClip(capacity), mClipRange(capacity), mAmpFar(capacity),
+		mFlags(capacity), mAttenTable(capacity), mWritePos(capacity), mSlot(capacity),
+		mDenseOfSlot(capacity, -1), mGeneration(capacity, 0),
+		mDelayLines(capacity * delaySize, 0.f),
+		mProxies(capacity, SoundSource(1, 1, 100, 0, 1))
+	{
+		// slots are handed out from the back of the free list, lowest first
+		for(int i=capacity-1; i>=0; --i) mFreeSlots.push_back(i);
+	}
+
+	/// Get maximum number of sources
+	int capacity() const { return mCapacity; }
+
+	/// Get number of sources
+	int size() const { return mSize; }
+
+	/// Get length of delay lines, in samples
+	int delaySize() const { return mDelaySize; }
+
+	/// Returns maximum index that can be used for reading samples
+	int maxIndex() const { return mDelaySize-2; }
+
+	/// Set delay-line interpolation type of all sources
+	void interpolation(SoundSource::Interpolation v){ mInterp = v; }
+
+	/// Get delay-line interpolation type of all sources
+	SoundSource::Interpolation interpolation() const { return mInterp; }
+
+	/// Add a source
+
+	/// \returns handle to the new source, or invalidHandle() if full
+	Handle add(double near=1, double range=100, double ampFar=0.0){
+		if(mFreeSlots.empty()) return invalidHandle();
+		int slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+
+		int i = mSize++;
+		mDenseOfSlot[slot] = i;
+		mSlot[i] = slot;
+		// initialize position to be VERY FAR AWAY so that we don't deafen ourselves...
+		mPos[i] = mPosPrev[i] = Vec3d(1000, 1000, 1000);
+		mNearClip[i] = near;
+		mClipRange[i] = range;
+		mAmpFar[i] = ampFar;
+		mFlags[i] = ATTENUATION | DOPPLER | FRESH | AUDIBLE;
+		mAttenTable[i] = 0;
+		mWritePos[i] = mDelaySize-1;
+		std::fill(delayLine(slot), delayLine(slot) + mDelaySize, 0.f);
+		return makeHandle(slot);
+	}
+
+	/// Remove a source
+
+	/// The last source is moved into the removed source's place, so this
+	/// takes constant time. The delay lines are not moved.
+	void remove(Handle h){
+		if(!valid(h)) return;
+		int slot = slotOf(h);
+		int i = mDenseOfSlot[slot];
+		int last = --mSize;
+		if(i != last){
+			mPos[i] = mPos[last];
+			mPosPrev[i] = mPosPrev[last];
+			mNearClip[i] = mNearClip[last];
+			mClipRange[i] = mClipRange[last];
+			mAmpFar[i] = mAmpFar[last];
+			mFlags[i] = mFlags[last];
+			mAttenTable[i] = mAttenTable[last];
+			mWritePos[i] = mWritePos[last];
+			mSlot[i] = mSlot[last];
+			mDenseOfSlot[mSlot[i]] = i;
+		}
+		mDenseOfSlot[slot] = -1;
+		mGeneration[slot] = (mGeneration[slot] + 1) & GENERATION_MASK;
+		mFreeSlots.push_back(slot);
+	}
+
+	/// Returns whether handle refers to a source in the array
+	bool valid(Handle h) const {
+		int slot = slotOf(h);
+		return h != invalidHandle() && slot < mCapacity
+			&& mDenseOfSlot[slot] >= 0 && mGeneration[slot] == generationOf(h);
+	}
+
+	/// Set position of source
+	void pos(Handle h, const Vec3d& v){ mPos[index(h)] = v; }
+
+	/// Get position of source
+	const Vec3d& pos(Handle h) const { return mPos[index(h)]; }
+
+	/// Set near clipping distance
+	void nearClip(Handle h, double v){ int i=index(h); mClipRange[i] += mNearClip[i]-v; mNearClip[i]=v; }
+
+	/// Set far clipping distance
+	void farClip(Handle h, double v){ int i=index(h); mClipRange[i] = v-mNearClip[i]; }
+
+	/// Set far clipping amplitude (minimum amplitude)
+	void ampFar(Handle h, double v){ mAmpFar[index(h)] = v; }
+
+	/// Enable/disable distance-based gain attenuation
+	void enableAttenuation(Handle h, bool v){ setFlag(index(h), ATTENUATION, v); }
+
+	/// Enable/disable Doppler shift
+	void enableDoppler(Handle h, bool v){ setFlag(index(h), DOPPLER, v); }
+
+	/// Set a shared table of the attenuation law to use (0 for none)
+
+	/// @see SoundSource::attenuationTable
+	void attenuationTable(Handle h, const DistAttenTable<float> * v){ mAttenTable[index(h)] = v; }
+
+	/// Returns attenuation factor based on distance to listener
+	double attenuation(Handle h, double distance) const {
+		return attenuationAt(index(h), distance);
+	}
+
+	/// Write sample to source's delay line
+	void writeSample(Handle h, float v){
+		int i = index(h);
+		int w = mWritePos[i] + 1;
+		if(w == mDelaySize) w = 0;
+		delayLine(mSlot[i])[w] = v;
+		mWritePos[i] = w;
+	}
+
+	/// Write block of samples to source's delay line
+	void writeSamples(Handle h, const float * v, int numSamples){
+		for(int k=0; k<numSamples; ++k) writeSample(h, v[k]);
+	}
+
+	/// Read sample from delay line using linear interpolation
+
+	/// The index specifies how many samples ago by which to read back from
+	/// the buffer. The index must be less than or equal to maxIndex().
+	float readSample(Handle h, double index) const {
+		return readSampleAt(this->index(h), index);
+	}
+
+protected:
+	friend class AudioScene;
+
+	enum{
+		ATTENUATION	= 1<<0,
+		DOPPLER		= 1<<1,
+		FRESH		= 1<<2,		// added since last render
+		AUDIBLE		= 1<<3,		// not culled in current block
+		AUDIBLE_PREV= 1<<4		// not culled in previous block
+	};
+
+	// Handles store the slot in the low bits and its generation in the rest.
+	// Generations wrap around to fit, so a stale handle is only mistaken for
+	// a new one after its slot has been reused 4096 times.
+	enum{ SLOT_BITS = 20, GENERATION_MASK = (1<<(32-SLOT_BITS))-1 };
+	Handle makeHandle(int slot) const { return (mGeneration[slot] << SLOT_BITS) | slot; }
+	static int slotOf(Handle h){ return h & ((1u<<SLOT_BITS)-1); }
+	static unsigned generationOf(Handle h){ return (h >> SLOT_BITS) & GENERATION_MASK; }
+	int index(Handle h) const { return mDenseOfSlot[slotOf(h)]; }
+
+	float * delayLine(int slot){ return &mDelayLines[slot * mDelaySize]; }
+	const float * delayLine(int slot) const { return &mDelayLines[slot * mDelaySize]; }
+
+	void setFlag(int i, unsigned char flag, bool v){
+		if(v)	mFlags[i] |= flag;
+		else	mFlags[i] &= ~flag;
+	}
+
+	double attenuationAt(int i, double distance) const {
+		if(!(mFlags[i] & ATTENUATION)) return 1.0;
+		if(mAttenTable[i]) return (*mAttenTable[i])(distance);
+		return SoundSource::attenuation(distance, mNearClip[i], mClipRange[i], mAmpFar[i]);
+	}
+
+	float readSampleAt(int i, double index) const {
+		float v;
+		readSamplesAt(i, &v, 1, index, index);
+		return v;
+	}
+
+	void readSamplesAt(int i, float * out, int numFrames, double indexBeg, double indexEnd) const {
+		SoundSource::readDelayLine(out, delayLine(mSlot[i]), mDelaySize, mWritePos[i],
+			indexBeg, (indexEnd-indexBeg)/numFrames, numFrames, mInterp);
+	}
+
+	// Placeholder passed to spatializers, which identify sources by reference
+	SoundSource& proxy(int i){ return mProxies[mSlot[i]]; }
+
+	int mCapacity, mSize, mDelaySize;
+	SoundSource::Interpolation mInterp;
+
+	// per source, indexed by position in packed arrays
+	std::vector<Vec3d> mPos;
+	std::vector<Vec3d> mPosPrev;			// position in previous block
+	std::vector<double> mNearClip, mClipRange, mAmpFar;
+	std::vector<unsigned char> mFlags;
+	std::vector<const DistAttenTable<float> *> mAttenTable;
+	std::vector<int> mWritePos;				// index of newest sample in delay line
+	std::vector<int> mSlot;					// slot of source
+
+	// per slot
+	std::vector<int> mDenseOfSlot;			// position in packed arrays, -1 if free
+	std::vector<unsigned> mGeneration;		// incremented when slot is freed, wrapping
+	std::vector<int> mFreeSlots;
+	std::vector<float> mDelayLines;			// delay line of each slot, back to back
+	std::vector<SoundSource> mProxies;		// empty sources identifying slots to spatializers
 };
 
 
@@ -333,11 +909,18 @@ public:
 
 	typedef std::vector<Listener *> Listeners;
 	typedef std::list<SoundSource *> Sources;
+	typedef std::vector<SoundSourceArray *> SourceArrays;
 
     AudioScene(int numFrames)
-	:   mNumFrames(numFrames), mSpeedOfSound(344), perSampleProcessing(false)
+	:   mNumFrames(numFrames), mSpeedOfSound(344), perSampleProcessing(false),
+		mCullThreshold(0), mNumActive(0), mNumCulled(0), mNumLod(0), mUseMixMatrix(false),
+		mJobListener(0), mJobListenerIndex(0), mJobDistanceToSample(0), mBlockCount(0), mPendingWorkers(0), mQuit(0)
 	{}
 
+	~AudioScene(){
+		stopWorkers();
+	}
+
 	Listeners& listeners(){ return mListeners; }
     const Listeners& listeners() const { return mListeners; }
 
@@ -359,16 +942,57 @@ public:
     Listener * createListener(Spatializer* spatializer) {
 		Listener * l = new Listener(mNumFrames, spatializer);
         l->compile();
+		for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it){
+			spatializer->addSource(**it);
+		}
+		for(unsigned ia=0; ia<mArrays.size(); ++ia){
+			addSlots(*spatializer, *mArrays[ia]);
+		}
+		// lod spatializers are set after creation, so are told of sources on first render
+		mLodSources.push_back(0);
 		mListeners.push_back(l);
 		return l;
 	}
 
 	void addSource(SoundSource& src) {
 		mSources.push_back(&src);
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			mListeners[il]->mSpatializer->addSource(src);
+			if(mListeners[il]->mLodSpatializer) mListeners[il]->mLodSpatializer->addSource(src);
+		}
 	}
 
 	void removeSource(SoundSource& src) {
 		mSources.remove(&src);
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			mListeners[il]->mSpatializer->removeSource(src);
+			if(mListeners[il]->mLodSpatializer) mListeners[il]->mLodSpatializer->removeSource(src);
+		}
+	}
+
+	/// Add an array of sources rendered with render(io, sources)
+
+	/// Every slot of the array is added to the spatializers of all listeners,
+	/// so that they create their per source state here rather than while
+	/// rendering. This allocates and must not be called from the audio
+	/// thread.
+	void addSourceArray(SoundSourceArray& sources){
+		mArrays.push_back(&sources);
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			addSlots(*mListeners[il]->mSpatializer, sources);
+		}
+	}
+
+	/// Remove an array of sources added with addSourceArray()
+	void removeSourceArray(SoundSourceArray& sources){
+		SourceArrays::iterator it = std::find(mArrays.begin(), mArrays.end(), &sources);
+		if(it == mArrays.end()) return;
+		mArrays.erase(it);
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			for(int i=0; i<sources.capacity(); ++i){
+				mListeners[il]->mSpatializer->removeSource(sources.mProxies[i]);
+			}
+		}
 	}
 
     /// Per sample processing is off by default.
@@ -378,6 +1002,79 @@ public:
         perSampleProcessing = shouldUsePerSampleProcessing;
     }
 
+	/// Render sources in parallel on a number of threads
+
+	/// Sources are split into contiguous, equally sized groups, one per
+	/// thread. The thread calling render() renders the first group directly
+	/// into the output buffers, while persistent worker threads render the
+	/// other groups into private buffers which are then summed in a fixed
+	/// order, so the output is the same from block to block. Apart from
+	/// resizing the private buffers when the io dimensions change, render()
+	/// does not allocate or lock. Only per buffer processing with spatializers
+	/// whose parallelSafe() returns true is run in parallel; everything else
+	/// is rendered on the calling thread.
+	///
+	/// Between blocks, the worker threads briefly busy-wait so that they are
+	/// woken without system calls when blocks follow closely, then sleep
+	/// until render() wakes them by posting to a semaphore, which does not
+	/// lock. Use no more threads than there are free cores.
+	///
+	/// @param[in] numThreads	total number of rendering threads, including
+	///							the one calling render(); 1 renders serially
+	/// @param[in] priority		priority of the worker threads in [0, 99]
+	void useParallelRendering(int numThreads, int priority=90){
+		stopWorkers();
+		if(numThreads < 2) return;
+		const unsigned numWorkers = numThreads-1;
+		mWorkers.resize(numWorkers);
+		for(unsigned i=0; i<numWorkers; ++i) mAccums.push_back(new Accumulator);
+		mQuit.store(0);
+		for(unsigned i=0; i<numWorkers; ++i){
+			RenderWorker& w = mWorkers.function(i);
+			w.scene = this;
+			w.index = i;
+			mWorkers.thread(i).priority(priority);
+		}
+		mWorkers.start(false);
+	}
+
+	/// Get total number of rendering threads
+	int renderThreads() const { return mWorkers.size() + 1; }
+
+	/// Set gain below which sources are culled
+
+	/// Before spatialization, the gain of each source is computed for the
+	/// nearest listener. Sources whose gain is below the threshold are faded
+	/// out over one block and then skipped until their gain rises above the
+	/// threshold again, at which point they are faded back in. The default
+	/// threshold of 0 disables culling.
+	void cullThreshold(float gain){ mCullThreshold = gain; }
+
+	/// Get gain below which sources are culled
+	float cullThreshold() const { return mCullThreshold; }
+
+	/// Set whether to mix sources through a sparse gain matrix
+
+	/// When enabled, spatializers that support it add the gains of each
+	/// source to a MixMatrix, which is then mixed into the output channels
+	/// in one pass per listener, instead of accumulating every source into
+	/// the output channels as it is rendered. This applies to per buffer
+	/// processing on the calling thread; parallel rendering still writes
+	/// each thread's sources to its own buffers directly.
+	void useMixMatrix(bool v){ mUseMixMatrix = v; }
+
+	/// Get whether sources are mixed through a sparse gain matrix
+	bool useMixMatrix() const { return mUseMixMatrix; }
+
+	/// Get number of sources rendered in the last block
+	int numActiveSources() const { return mNumActive; }
+
+	/// Get number of sources skipped in the last block
+	int numCulledSources() const { return mNumCulled; }
+
+	/// Get number of source/listener pairs rendered with a listener's level of detail spatializer in the last block
+	int numLodSources() const { return mNumLod; }
+
     void render(AudioIOData& io) {
 
         const int numFrames = io.framesPerBuffer();
@@ -390,12 +1087,20 @@ public:
 			src.mPosHistory(src.pose().pos());
 		}
 
+		// take snapshot of sources for partitioning among threads
+		mSourceArray.assign(mSources.begin(), mSources.end());
+
+		cull();
+		beginSourceBlocks(mSourceArray.size(), numFrames);
+
 		// iterate through all listeners adding contribution from all sources
 		for(unsigned il=0; il<mListeners.size(); ++il){
 			Listener& l = *mListeners[il];
 
 			Spatializer* spatializer = l.mSpatializer;
+			Spatializer* lodSpatializer = l.mLodSpatializer;
 			spatializer->prepare(io);
+			if(lodSpatializer) lodSpatializer->prepare(io);
 
 			// update listener history data:
 			Quatd qnew = l.pose().quat();
@@ -404,99 +1109,481 @@ public:
 			l.mPosHistory(l.pose().pos());
 
 			// iterate through all sound sources
-            //printf("audio scene has %d sound sources!!!\n", mSources.size());
-			for(Sources::iterator it = mSources.begin(); it != mSources.end(); ++it){
-				SoundSource& src = *(*it);
+			if(mWorkers.size() && !perSampleProcessing && spatializer->parallelSafe()
+				&& (!lodSpatializer || lodSpatializer->parallelSafe())
+			){
+				renderParallel(io, l, il, distanceToSample);
+			}
+			else if(mUseMixMatrix && !perSampleProcessing){
+				spatializer->mixer(&mMixMatrix);
+				if(lodSpatializer) lodSpatializer->mixer(&mMixMatrix);
+				renderSources(io, l, il, distanceToSample, 0, mSourceArray.size());
+				mMixMatrix.mix(io);
+				spatializer->mixer(0);
+				if(lodSpatializer) lodSpatializer->mixer(0);
+			}
+			else{
+				renderSources(io, l, il, distanceToSample, 0, mSourceArray.size());
+			}
 
-				// scalar factor to convert distances into delayline indices
-				// varies per source,
-				// since each source has its own buffersize and far clip
-				// (not physically accurate of course)
-                if(src.useDoppler)
-                    distanceToSample = distanceToSample;//(src.maxIndex()-numFrames)/src.farClip();
-                else
-                    distanceToSample = 0;
+            spatializer->finalize(io);
+			if(lodSpatializer) lodSpatializer->finalize(io);
 
-                if(perSampleProcessing) //Original, inefficient, per sample processing
-                {
-                    // iterate time samples
-                    for(int i=0; i<numFrames; ++i){
+		} // end for each listener
 
-                        // compute interpolated source position relative to listener
-                        // TODO: this tends to warble when moving fast
-                        double alpha = double(i)/numFrames;
+	} //end render
 
-                        // moving average:
-                        // cheaper & slightly less warbly than cubic,
-                        // less glitchy than linear
-                        Vec3d relpos = (
-                            (src.mPosHistory[3]-l.mPosHistory[3])*(1.-alpha) +
-                            (src.mPosHistory[2]-l.mPosHistory[2]) +
-                            (src.mPosHistory[1]-l.mPosHistory[1]) +
-                            (src.mPosHistory[0]-l.mPosHistory[0])*(alpha)
-                        )/3.0;
 
-                        double distance = relpos.mag();
+	/// Render sources stored in an array
 
-                        //printf("distance = %f\n", distance);
+	/// This works like render(io), but takes the sources from an array
+	/// instead of those added with addSource(). Sources are always rendered
+	/// per buffer and on the calling thread. The array should have been
+	/// added with addSourceArray(); otherwise, spatializers keep no state
+	/// for its sources, so e.g. their gains are not ramped between blocks.
+	void render(AudioIOData& io, SoundSourceArray& sources) {
 
-                        double idx = distance * distanceToSample;
-                        //if (i==0) printf("idx %g\n", idx);
+		const int numFrames = io.framesPerBuffer();
+		const double distanceToSample = io.framesPerSecond() / mSpeedOfSound;
+		const double maxDelay = std::max(sources.maxIndex() - 1 - numFrames, 0);
 
-                        int idx0 = idx;
+		// cull sources inaudible to all listeners
+		mNumActive = mNumCulled = mNumLod = 0;
+		for(int k=0; k<sources.size(); ++k){
+			unsigned char& flags = sources.mFlags[k];
+			double minDist = 1e300;
+			for(unsigned il=0; il<mListeners.size(); ++il){
+				double dist = (sources.mPos[k] - mListeners[il]->pose().pos()).mag();
+				if(dist < minDist) minDist = dist;
+			}
+			bool audible = mCullThreshold <= 0.f || sources.attenuationAt(k, minDist) >= mCullThreshold;
+			flags = (flags & ~SoundSourceArray::AUDIBLE_PREV)
+				| ((flags & SoundSourceArray::AUDIBLE) ? SoundSourceArray::AUDIBLE_PREV : 0);
+			flags = (flags & ~SoundSourceArray::AUDIBLE) | (audible ? SoundSourceArray::AUDIBLE : 0);
+			if(flags & (SoundSourceArray::AUDIBLE | SoundSourceArray::AUDIBLE_PREV))	++mNumActive;
+			else																		++mNumCulled;
+		}
 
-                        // are we within range?
-                        if(idx0 <= src.maxIndex()-numFrames){
-                        //if (distance < src.farClip()) {
+		beginSourceBlocks(sources.size(), numFrames);
 
-                            idx += (numFrames-i);
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			Listener& l = *mListeners[il];
 
-                            double gain = src.attenuation(distance);
+			Spatializer* spatializer = l.mSpatializer;
+			spatializer->prepare(io);
+			if(mUseMixMatrix) spatializer->mixer(&mMixMatrix);
 
-                            float s = src.readSample(idx) * gain;
+			Quatd qnew = l.pose().quat();
+			Quatd::slerpBuffer(l.mQuatPrev, qnew, &l.mQuatHistory[0], numFrames);
+			l.mQuatPrev = qnew;
+			l.mPosHistory(l.pose().pos());
+			const Vec3d listenerPos = l.mPosHistory[0];
+			const Vec3d listenerPosPrev = l.mPosHistory[1];
+
+			for(int k=0; k<sources.size(); ++k){
+				SoundSource& proxy = sources.proxy(k);
+
+				// reset any state the spatializer kept from a removed source
+				if(sources.mFlags[k] & SoundSourceArray::FRESH){
+					spatializer->resetSource(proxy);
+				}
+
+				// skip culled sources; fade those becoming audible or inaudible
+				const unsigned char flags = sources.mFlags[k];
+				if(!(flags & (SoundSourceArray::AUDIBLE | SoundSourceArray::AUDIBLE_PREV))) continue;
+				const float cullBeg = (flags & SoundSourceArray::AUDIBLE_PREV) ? 1.f : 0.f;
+				const float cullEnd = (flags & SoundSourceArray::AUDIBLE) ? 1.f : 0.f;
+
+				Vec3d relpos = sources.mPos[k] - listenerPos;
+				double distance = relpos.mag();
+				double gain = sources.attenuationAt(k, distance);
+
+				// ramp delay from its value in the previous block
+				double delayPrev = 0, delay = 0;
+				if(sources.mFlags[k] & SoundSourceArray::DOPPLER){
+					delayPrev = std::min((sources.mPosPrev[k] - listenerPosPrev).mag() * distanceToSample, maxDelay);
+					delay = std::min(distance * distanceToSample, maxDelay);
+				}
+
+				float * block = sourceBlock(k, numFrames);
+				if(!sourceBlockValid(k, delayPrev + numFrames, delay)){
+					sources.readSamplesAt(k, block, numFrames, delayPrev + numFrames, delay);
+					if(cullBeg != cullEnd) fade(block, numFrames, cullBeg, cullEnd);
+				}
+
+				float samples[numFrames];
+				for(int i = 0; i < numFrames; i++) samples[i] = block[i] * gain;
+				spatializer->perform(io, proxy, relpos, numFrames, samples);
+			}
 
-                            spatializer->perform(io,src,relpos, numFrames, i, s);
+			if(mUseMixMatrix){
+				mMixMatrix.mix(io);
+				spatializer->mixer(0);
+			}
+			spatializer->finalize(io);
+		}
 
-                        } // end if in range
+		for(int k=0; k<sources.size(); ++k){
+			sources.mFlags[k] &= ~SoundSourceArray::FRESH;
+			sources.mPosPrev[k] = sources.mPos[k];
+		}
+	}
 
-                    } //end for each frame
-                } //end per sample processing
-                //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-                else //more efficient, per buffer processing
-                {
-                    Vec3d relpos = src.pose().pos() - l.pose().pos();
-                    double distance = relpos.mag();
-                    double gain = src.attenuation(distance);
+protected:
 
-                    float samples[numFrames];
-                    for(int i = 0; i < numFrames; i++)
-                    {
-                        double readIndex = distance * distanceToSample;
-                        readIndex += (numFrames-i);
-                        samples[i] = gain*src.readSample(readIndex);
-                    }
-                    spatializer->perform(io, src, relpos, numFrames, samples);
-                }
+	// Private output buffers of a worker thread
+	class Accumulator : public AudioIOData {
+	public:
+		Accumulator(): AudioIOData(0){}
+
+		// Match dimensions of io; only allocates if they changed
+		void configure(const AudioIOData& io){
+			if(mFramesPerBuffer != io.framesPerBuffer() || mNumO != io.channelsOut()){
+				delete[] mBufO;
+				mFramesPerBuffer = io.framesPerBuffer();
+				mNumO = io.channelsOut();
+				mBufO = new float[mNumO * mFramesPerBuffer];
+			}
+			mFramesPerSecond = io.framesPerSecond();
+		}
+	};
 
+	// Worker thread rendering one group of sources per block
+	struct RenderWorker : public ThreadFunction {
+		RenderWorker(): scene(0), index(0), sleeping(0){}
+
+		void operator()(){
+			int block = 0;
+			while(true){
+				// wait for next block, spinning briefly before sleeping
+				int spins = 0;
+				while(scene->mBlockCount.load() == block){
+					if(++spins < 1000) cpuRelax();
+					else if(spins < 1100) Thread::yield();
+					else sleep(block);
+				}
+				++block;
+				if(scene->mQuit.load()) break;
+				scene->renderWorkerGroup(index);
+				scene->mPendingWorkers.fetchAdd(-1);
+			}
+		}
 
-			} //end for each source
+		// Sleep until the block count changes or the wake was claimed
+		void sleep(int block){
+			sleeping.store(1);
+			// wakeWorkers() checks the flag after counting the block, so one
+			// of them sees the other
+			memoryFence();
+			if(scene->mBlockCount.load() == block) wake.wait();
+			// too late to sleep; if the wake was claimed, take its post
+			else if(!sleeping.exchange(0)) wake.wait();
+		}
 
-            spatializer->finalize(io);
+		AudioScene * scene;
+		int index;
+		Atomic<int> sleeping;	// set while sleeping on wake, cleared by the waker
+		Semaphore wake;
+	};
 
-		} // end for each listener
+	// Wake sleeping workers after changing the block count, without locking
+	void wakeWorkers(){
+		memoryFence();
+		for(unsigned i=0; i<mAccums.size(); ++i){
+			RenderWorker& w = mWorkers.function(i);
+			if(w.sleeping.load() && w.sleeping.exchange(0)) w.wake.post();
+		}
+	}
 
-	} //end render
+	// Add every slot of a source array to a spatializer
+	static void addSlots(Spatializer& spatializer, SoundSourceArray& sources){
+		for(int i=0; i<sources.capacity(); ++i) spatializer.addSource(sources.mProxies[i]);
+	}
 
+	// Render sources [beg, end) of the source snapshot
+	void renderSources(AudioIOData& io, Listener& l, int il, double distanceToSample, int beg, int end){
+		for(int i=beg; i<end; ++i){
+			renderSource(io, l, il, i, *mSourceArray[i], distanceToSample);
+		}
+	}
 
-protected:
+	// First source of a thread's group of sources
+	int groupBegin(int thread) const {
+		return (long long)mSourceArray.size() * thread / renderThreads();
+	}
+
+	// Called from worker thread to render its group into its accumulator
+	void renderWorkerGroup(int worker){
+		Accumulator& acc = *mAccums[worker];
+		acc.zeroOut();
+		renderSources(acc, *mJobListener, mJobListenerIndex, mJobDistanceToSample, groupBegin(worker+1), groupBegin(worker+2));
+	}
+
+	void renderParallel(AudioIOData& io, Listener& l, int il, double distanceToSample){
+		for(unsigned i=0; i<mAccums.size(); ++i) mAccums[i]->configure(io);
+
+		// publish job and wake workers
+		mJobListener = &l;
+		mJobListenerIndex = il;
+		mJobDistanceToSample = distanceToSample;
+		mPendingWorkers.store(mWorkers.size());
+		mBlockCount.fetchAdd(1);
+		wakeWorkers();
+
+		renderSources(io, l, il, distanceToSample, 0, groupBegin(1));
+
+		int spins = 0;
+		while(mPendingWorkers.load() != 0){
+			if(++spins < 1000) cpuRelax();
+			else Thread::yield();
+		}
+
+		// sum worker outputs in fixed order
+		const int numSamples = io.channelsOut() * io.framesPerBuffer();
+		float * out = io.outBuffer();
+		for(unsigned i=0; i<mAccums.size(); ++i){
+			const float * acc = mAccums[i]->outBuffer();
+			for(int k=0; k<numSamples; ++k) out[k] += acc[k];
+		}
+	}
+
+	void stopWorkers(){
+		if(mWorkers.size()){
+			mQuit.store(1);
+			mBlockCount.fetchAdd(1);
+			wakeWorkers();
+			mWorkers.join();
+			mWorkers.resize(0);
+			for(unsigned i=0; i<mAccums.size(); ++i) delete mAccums[i];
+			mAccums.clear();
+			mBlockCount.store(0);
+		}
+	}
+
+	// Source position relative to listener at a fraction of the current block
+	static Vec3d relativePosition(const SoundSource& src, const Listener& l, double alpha){
+		// TODO: this tends to warble when moving fast
+
+		// moving average:
+		// cheaper & slightly less warbly than cubic,
+		// less glitchy than linear
+		return (
+			(src.mPosHistory[3]-l.mPosHistory[3])*(1.-alpha) +
+			(src.mPosHistory[2]-l.mPosHistory[2]) +
+			(src.mPosHistory[1]-l.mPosHistory[1]) +
+			(src.mPosHistory[0]-l.mPosHistory[0])*(alpha)
+		)/3.0;
+	}
+
+	// Decide which sources are audible and which listeners render them with
+	// their lod spatializer
+	void cull(){
+		// tell lod spatializers set since the last block about the sources
+		for(unsigned il=0; il<mListeners.size(); ++il){
+			Spatializer * lod = mListeners[il]->mLodSpatializer;
+			if(lod != mLodSources[il]){
+				if(lod) for(unsigned i=0; i<mSourceArray.size(); ++i) lod->addSource(*mSourceArray[i]);
+				mLodSources[il] = lod;
+			}
+		}
+
+		mNumActive = mNumCulled = mNumLod = 0;
+
+		for(unsigned i=0; i<mSourceArray.size(); ++i){
+			SoundSource& src = *mSourceArray[i];
+			const Vec3d& pos = src.pose().pos();
+
+			double minDist = 1e300;
+			unsigned lodMask = 0;
+			for(unsigned il=0; il<mListeners.size(); ++il){
+				const Listener& l = *mListeners[il];
+				double dist = (pos - l.pose().pos()).mag();
+				if(dist < minDist) minDist = dist;
+				if(il < 32 && l.mLodSpatializer && dist > l.mLodDistance){
+					lodMask |= 1u << il;
+				}
+			}
+
+			src.mAudiblePrev = src.mAudible;
+			src.mAudible = mCullThreshold <= 0.f || src.attenuation(minDist) >= mCullThreshold;
+			src.mLodMaskPrev = src.mLodMask;
+			src.mLodMask = lodMask;
+
+			if(src.mAudible || src.mAudiblePrev){
+				++mNumActive;
+				for(unsigned m = lodMask; m; m &= m-1) ++mNumLod;
+			}
+			else{
+				++mNumCulled;
+			}
+		}
+	}
+
+	// Fade a block of samples linearly between two gains
+	static void fade(float * samples, int numFrames, float beg, float end){
+		const float inc = (end - beg) / numFrames;
+		for(int i=0; i<numFrames; ++i) samples[i] *= beg + inc*i;
+	}
+
+	// Prepare the per source blocks shared by listeners for a new block
+	void beginSourceBlocks(int numSources, int numFrames){
+		if(mSourceBlocks.size() < unsigned(numSources * numFrames)) mSourceBlocks.resize(numSources * numFrames);
+		mSourceBlockDelays.assign(numSources * 2, -1.);
+	}
+
+	// Delayed (and cull faded) block of samples of a source
+	float * sourceBlock(int index, int numFrames){
+		return &mSourceBlocks[index * numFrames];
+	}
+
+	// Check whether a source's block was already read with the same delays
+	// for a previous listener. If not, the delays are recorded and the
+	// caller must read the block.
+	bool sourceBlockValid(int index, double delayBeg, double delayEnd){
+		double * delays = &mSourceBlockDelays[index * 2];
+		if(delays[0] == delayBeg && delays[1] == delayEnd) return true;
+		delays[0] = delayBeg;
+		delays[1] = delayEnd;
+		return false;
+	}
+
+	// Render one source for one listener
+	void renderSource(AudioIOData& io, Listener& l, int il, int index, SoundSource& src, double distanceToSample){
+		const int numFrames = io.framesPerBuffer();
+
+		// skip culled sources; fade those becoming audible or inaudible
+		if(!src.mAudible && !src.mAudiblePrev) return;
+		const float cullBeg = src.mAudiblePrev ? 1.f : 0.f;
+		const float cullEnd = src.mAudible ? 1.f : 0.f;
+
+		// choose spatializer, crossfading when switching level of detail
+		const unsigned bit = il < 32 ? 1u << il : 0;
+		Spatializer* spatializer = (src.mLodMask & bit) ? l.mLodSpatializer : l.mSpatializer;
+		Spatializer* spatializerPrev = (src.mLodMaskPrev & bit) ? l.mLodSpatializer : l.mSpatializer;
+		if(!spatializerPrev) spatializerPrev = spatializer;
+
+		// scalar factor to convert distances into delayline indices
+		// varies per source,
+		// since each source has its own buffersize and far clip
+		// (not physically accurate of course)
+		if(!src.useDoppler)
+			distanceToSample = 0;
+
+		if(perSampleProcessing) //Original, inefficient, per sample processing
+		{
+			// compute gains of the whole block at once
+			float distances[numFrames];
+			float gains[numFrames];
+			for(int i=0; i<numFrames; ++i){
+				distances[i] = relativePosition(src, l, double(i)/numFrames).mag();
+			}
+			src.attenuation(gains, distances, numFrames);
+
+			// iterate time samples
+			for(int i=0; i<numFrames; ++i){
+
+				Vec3d relpos = relativePosition(src, l, double(i)/numFrames);
+
+				double distance = relpos.mag();
+
+				double idx = distance * distanceToSample;
+
+				int idx0 = idx;
+
+				// are we within range?
+				if(idx0 <= src.maxIndex()-numFrames){
+
+					idx += (numFrames-i);
+
+					float alpha = float(i)/numFrames;
+					double gain = gains[i] * (cullBeg + (cullEnd-cullBeg)*alpha);
+
+					float s = src.readSample(idx) * gain;
+
+					if(spatializer == spatializerPrev){
+						spatializer->perform(io,src,relpos, numFrames, i, s);
+					}
+					else{
+						float s1 = s * alpha;
+						float s0 = s - s1;
+						spatializerPrev->perform(io,src,relpos, numFrames, i, s0);
+						spatializer->perform(io,src,relpos, numFrames, i, s1);
+					}
+
+				} // end if in range
+
+			} //end for each frame
+		} //end per sample processing
+		else //more efficient, per buffer processing
+		{
+			Vec3d relpos = src.pose().pos() - l.pose().pos();
+			double distance = relpos.mag();
+			double gain = src.attenuation(distance);
+
+			// ramp delay from its value in the previous block for a smooth
+			// doppler shift, keeping reads within the delay-line
+			double maxDelay = std::max(src.maxIndex() - 1 - numFrames, 0);
+			double delayPrev = (src.mPosHistory[1]-l.mPosHistory[1]).mag() * distanceToSample;
+			double delay = distance * distanceToSample;
+
+			// the delayed block only depends on the listener through the
+			// delays, so it is shared by listeners at the same distance
+			// and by all listeners when doppler is disabled
+			const double delayBeg = std::min(delayPrev, maxDelay) + numFrames;
+			const double delayEnd = std::min(delay, maxDelay);
+			float * block = sourceBlock(index, numFrames);
+			if(!sourceBlockValid(index, delayBeg, delayEnd)){
+				src.readSamples(block, numFrames, delayBeg, delayEnd);
+				if(cullBeg != cullEnd) fade(block, numFrames, cullBeg, cullEnd);
+			}
+
+			float samples[numFrames];
+			for(int i = 0; i < numFrames; i++) samples[i] = block[i] * gain;
+
+			if(spatializer == spatializerPrev){
+				spatializer->perform(io, src, relpos, numFrames, samples);
+			}
+			else{
+				float faded[numFrames];
+				for(int i = 0; i < numFrames; i++) faded[i] = samples[i];
+				fade(faded, numFrames, 1.f, 0.f);
+				spatializerPrev->perform(io, src, relpos, numFrames, faded);
+				fade(samples, numFrames, 0.f, 1.f);
+				spatializer->perform(io, src, relpos, numFrames, samples);
+			}
+		}
+	}
 
 	Listeners mListeners;
 	Sources mSources;
+	SourceArrays mArrays;		// source arrays whose slots spatializers were told of
 
     bool perSampleProcessing;
 
 	int mNumFrames;			// audio frames per block
 	double mSpeedOfSound;	// distance per second
+
+	// culling and level of detail
+	float mCullThreshold;
+	int mNumActive, mNumCulled, mNumLod;
+	std::vector<Spatializer *> mLodSources;		// lod spatializer told of sources, per listener
+
+	// source processing shared by listeners
+	std::vector<float> mSourceBlocks;			// delayed block of each source
+	std::vector<double> mSourceBlockDelays;		// delays block of each source was read with
+	MixMatrix mMixMatrix;						// gains of sources rendered on calling thread
+	bool mUseMixMatrix;
+
+	// parallel rendering
+	std::vector<SoundSource *> mSourceArray;	// snapshot of sources for current block
+	Threads<RenderWorker> mWorkers;
+	std::vector<Accumulator *> mAccums;			// output of each worker
+	Listener * mJobListener;					// listener being rendered
+	int mJobListenerIndex;
+	double mJobDistanceToSample;
+	Atomic<int> mBlockCount;					// incremented to wake workers
+	Atomic<int> mPendingWorkers;				// workers still rendering
+	Atomic<int> mQuit;
 };
 
 
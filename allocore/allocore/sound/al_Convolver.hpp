@@ -0,0 +1,522 @@
+#ifndef INCLUDE_AL_CONVOLVER_HPP
+#define INCLUDE_AL_CONVOLVER_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+
+	File description:
+	Low-latency multichannel convolution with partitioned impulse responses
+*/
+
+#include <string.h>
+#include <vector>
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/math/al_FFT.hpp"
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
+
+namespace al{
+
+/// Low-latency multichannel convolution with partitioned impulse responses
+
+/// Each output is the sum of the inputs convolved with the impulse responses
+/// set from them to the output, e.g., one input to the channels of a
+/// measured room or a matrix of responses for auralization. Long responses
+/// are split into partitions that grow in size along the response. The
+/// first partitions, of the block size, are convolved on the audio thread
+/// with a latency of one block. Each larger size is handled by a stage that
+/// starts late enough along the response to have a full period of its size
+/// to compute, so these run on worker threads in the background and only
+/// need to be finished when their output is due. With the maximum block size
+/// equal to the block size, the partitioning is uniform and everything is
+/// computed on the audio thread. Partitions of one size are convolved in the
+/// frequency domain against a delay line of input spectra, so the cost per
+/// block is one transform per input and output and a spectral
+/// multiply-accumulate per partition.
+///
+/// Input and output are buffered internally, so the block size is
+/// independent of the size of the buffers passed to process(). The latency
+/// is always blockSize() samples.
+///
+/// As an AudioCallback appended to an AudioIO, the convolver reads its
+/// inputs from the output channels (i.e., the mix rendered so far) or from
+/// the device input channels and mixes its outputs into the output
+/// channels. configure() and impulse() allocate and must not be called
+/// while audio is being processed. process() and onAudioCB() do not
+/// allocate or lock.
+///
+/// The worker threads briefly busy-wait between jobs, then sleep until the
+/// audio thread wakes them by posting to a semaphore, which does not lock.
+class Convolver : public AudioCallback{
+public:
+
+	/// @param[in] numInputs		number of inputs
+	/// @param[in] numOutputs		number of outputs
+	/// @param[in] blockSize		size of the first partitions and latency;
+	///								must be a power of two
+	/// @param[in] maxBlockSize		size of the largest partitions; the sizes
+	///								grow by 4 from blockSize up to this
+	/// @param[in] numThreads		number of worker threads computing the
+	///								larger partitions; 0 computes them on the
+	///								thread calling process()
+	Convolver(int numInputs=1, int numOutputs=2, int blockSize=64, int maxBlockSize=8192, int numThreads=1)
+	:	mNumInputs(0), mNumOutputs(0), mBlockSize(0), mMaxBlockSize(0),
+		mPos(0), mDry(1), mWet(1), mDeviceInput(false),
+		mJobCount(0), mQuit(0)
+	{
+		configure(numInputs, numOutputs, blockSize, maxBlockSize, numThreads);
+	}
+
+	virtual ~Convolver(){ clear(); }
+
+
+	/// Set dimensions and partitioning; removes all impulse responses
+	void configure(int numInputs, int numOutputs, int blockSize=64, int maxBlockSize=8192, int numThreads=1){
+		clear();
+		mPaths.clear();
+		mNumInputs = numInputs;
+		mNumOutputs = numOutputs;
+		mBlockSize = blockSize;
+		mMaxBlockSize = maxBlockSize < blockSize ? blockSize : maxBlockSize;
+		mNumThreads = numThreads;
+		build();
+	}
+
+	/// Set impulse response from an input to an output
+
+	/// The response is copied. Setting an empty response removes it.
+	///
+	void impulse(int input, int output, const float * ir, int length){
+		clear();
+		for(unsigned i=0; i<mPaths.size(); ++i){
+			if(mPaths[i].input == input && mPaths[i].output == output){
+				mPaths.erase(mPaths.begin() + i);
+				break;
+			}
+		}
+		if(length > 0){
+			mPaths.push_back(Path(input, output));
+			mPaths.back().ir.assign(ir, ir + length);
+		}
+		build();
+	}
+
+	/// Set gain of existing output channel contents in onAudioCB()
+	Convolver& dry(float v){ mDry=v; return *this; }
+
+	/// Set gain of convolved outputs in onAudioCB()
+	Convolver& wet(float v){ mWet=v; return *this; }
+
+	/// Set whether onAudioCB() reads the device input or output channels
+	Convolver& useDeviceInput(bool v){ mDeviceInput=v; return *this; }
+
+	float dry() const { return mDry; }
+	float wet() const { return mWet; }
+	bool useDeviceInput() const { return mDeviceInput; }
+
+	int numInputs() const { return mNumInputs; }
+	int numOutputs() const { return mNumOutputs; }
+
+	/// Get latency, in samples, which equals the size of the first partitions
+	int blockSize() const { return mBlockSize; }
+
+	int maxBlockSize() const { return mMaxBlockSize; }
+
+	/// Get number of partition sizes used for the current responses
+	int numStages() const { return mStages.size(); }
+
+	/// Get number of worker threads
+	int numThreads() const { return mWorkers.size(); }
+
+
+	/// Convolve blocks of samples
+
+	/// @param[ in] ins			numInputs() input buffers
+	/// @param[out] outs		numOutputs() output buffers; these may be
+	///							the same as the input buffers
+	/// @param[ in] numFrames	number of frames in each buffer
+	void process(const float * const * ins, float * const * outs, int numFrames){
+		run(ins, outs, numFrames, 0.f, 1.f);
+	}
+
+	/// Convolve audio io channels (see class description)
+
+	/// The io must have at least numInputs() input or output channels, as
+	/// read, and numOutputs() output channels.
+	virtual void onAudioCB(AudioIOData& io){
+		const int numFrames = io.framesPerBuffer();
+		const float * ins[mNumInputs > 0 ? mNumInputs : 1];
+		float * outs[mNumOutputs > 0 ? mNumOutputs : 1];
+		for(int i=0; i<mNumInputs; ++i){
+			ins[i] = mDeviceInput ? io.inBuffer(i) : io.outBuffer(i);
+		}
+		for(int i=0; i<mNumOutputs; ++i) outs[i] = io.outBuffer(i);
+		run(ins, outs, numFrames, mDry, mWet);
+	}
+
+	/// Zero all delay lines and buffered samples
+	void reset(){
+		waitForJobs();
+		mPos = 0;
+		std::fill(mInFifo.begin(), mInFifo.end(), 0.f);
+		std::fill(mOutFifo.begin(), mOutFifo.end(), 0.f);
+		for(unsigned i=0; i<mStages.size(); ++i) mStages[i]->reset();
+	}
+
+protected:
+
+	struct Path{
+		Path(int i, int o): input(i), output(o){}
+		int input, output;
+		std::vector<float> ir;
+	};
+
+	// Uniformly partitioned overlap-save convolution of one range of the
+	// responses with partitions of one size
+	struct Stage{
+		Stage(int size_, int offset_, int numParts_, int numInputs, int numOutputs, int numPaths)
+		:	size(size_), offset(offset_), numParts(numParts_), bins(size_+1),
+			fft(2*size_), pending(numInputs*size_), window(numInputs*2*size_),
+			fdlRe(numInputs*numParts_*bins), fdlIm(fdlRe.size()),
+			irRe(numPaths*numParts_*bins), irIm(irRe.size()),
+			accRe(bins), accIm(bins), time(2*size_),
+			fdlPos(0), fill(0), readBuf(0), readPos(0), state(0)
+		{
+			for(int i=0; i<2; ++i) out[i].resize(numOutputs*size_);
+		}
+
+		// Transform the part of a response covered by this stage
+		void setImpulse(int path, const float * ir, int length){
+			const float scale = 1.f / fft.size();
+			for(int p=0; p<numParts; ++p){
+				std::fill(time.begin(), time.end(), 0.f);
+				int beg = offset + p*size;
+				int n = length - beg;
+				if(n > size) n = size;
+				for(int i=0; i<n; ++i) time[i] = ir[beg+i] * scale;
+				int k = (path*numParts + p)*bins;
+				fft.forward(&irRe[k], &irIm[k], &time[0]);
+			}
+		}
+
+		// Convolve the current input windows into output buffer b
+		void process(const std::vector<Path>& paths, int numInputs, int numOutputs, int b){
+			for(int c=0; c<numInputs; ++c){
+				int k = (c*numParts + fdlPos)*bins;
+				fft.forward(&fdlRe[k], &fdlIm[k], &window[c*2*size]);
+			}
+
+			for(int o=0; o<numOutputs; ++o){
+				float * dst = &out[b][o*size];
+				bool any = false;
+				for(int j=0; j<bins; ++j){ accRe[j] = 0; accIm[j] = 0; }
+				for(unsigned pa=0; pa<paths.size(); ++pa){
+					if(paths[pa].output != o) continue;
+					any = true;
+					int c = paths[pa].input;
+					for(int p=0; p<numParts; ++p){
+						int slot = fdlPos - p;
+						if(slot < 0) slot += numParts;
+						const float * __restrict__ xr = &fdlRe[(c*numParts + slot)*bins];
+						const float * __restrict__ xi = &fdlIm[(c*numParts + slot)*bins];
+						const float * __restrict__ hr = &irRe[(pa*numParts + p)*bins];
+						const float * __restrict__ hi = &irIm[(pa*numParts + p)*bins];
+						float * __restrict__ ar = &accRe[0];
+						float * __restrict__ ai = &accIm[0];
+						for(int j=0; j<bins; ++j){
+							ar[j] += xr[j]*hr[j] - xi[j]*hi[j];
+							ai[j] += xr[j]*hi[j] + xi[j]*hr[j];
+						}
+					}
+				}
+				if(any){
+					fft.inverse(&time[0], &accRe[0], &accIm[0]);
+					memcpy(dst, &time[size], size*sizeof(float));
+				}
+				else{
+					memset(dst, 0, size*sizeof(float));
+				}
+			}
+
+			if(++fdlPos == numParts) fdlPos = 0;
+		}
+
+		// Slide the input windows along by the pending block
+		void shift(int numInputs){
+			for(int c=0; c<numInputs; ++c){
+				float * w = &window[c*2*size];
+				memcpy(w, w + size, size*sizeof(float));
+				memcpy(w + size, &pending[c*size], size*sizeof(float));
+			}
+		}
+
+		void reset(){
+			std::fill(pending.begin(), pending.end(), 0.f);
+			std::fill(window.begin(), window.end(), 0.f);
+			std::fill(fdlRe.begin(), fdlRe.end(), 0.f);
+			std::fill(fdlIm.begin(), fdlIm.end(), 0.f);
+			for(int i=0; i<2; ++i) std::fill(out[i].begin(), out[i].end(), 0.f);
+			fdlPos = fill = readBuf = readPos = 0;
+		}
+
+		int size;			// partition size
+		int offset;			// first response sample covered
+		int numParts;		// number of partitions
+		int bins;			// number of frequency bins
+		RFFT<float> fft;
+		std::vector<float> pending;			// input block being accumulated
+		std::vector<float> window;			// previous and current input block
+		std::vector<float> fdlRe, fdlIm;	// delay line of input spectra
+		std::vector<float> irRe, irIm;		// spectra of response partitions
+		std::vector<float> accRe, accIm;
+		std::vector<float> time;
+		std::vector<float> out[2];			// double-buffered output blocks
+		int fdlPos;
+		int fill;							// samples in pending block
+		int readBuf, readPos;				// output block being read
+		Atomic<int> state;					// 0: idle, 1: queued, 2: running
+	};
+
+	// Worker thread computing queued stages
+	struct Worker : public ThreadFunction{
+		Worker(): conv(0), sleeping(0){}
+
+		void operator()(){
+			int seen = 0;
+			while(true){
+				int spins = 0;
+				while(conv->mJobCount.load() == seen){
+					if(++spins < 1000) cpuRelax();
+					else if(spins < 2000) Thread::yield();
+					else sleep(seen);
+				}
+				seen = conv->mJobCount.load();
+				if(conv->mQuit.load()) break;
+				for(unsigned i=1; i<conv->mStages.size(); ++i){
+					Stage& s = *conv->mStages[i];
+					int expected = 1;
+					if(s.state.compareExchange(expected, 2)){
+						conv->runStage(s);
+						s.state.store(0);
+					}
+				}
+			}
+		}
+
+		// Sleep until the job count changes or the wake was claimed
+		void sleep(int seen){
+			sleeping.store(1);
+			// wakeWorkers() checks the flag after counting the job, so one
+			// of them sees the other
+			memoryFence();
+			if(conv->mJobCount.load() == seen) wake.wait();
+			// too late to sleep; if the wake was claimed, take its post
+			else if(!sleeping.exchange(0)) wake.wait();
+		}
+
+		Convolver * conv;
+		Atomic<int> sleeping;	// set while sleeping on wake, cleared by the waker
+		Semaphore wake;
+	};
+
+	int mNumInputs, mNumOutputs;
+	int mBlockSize, mMaxBlockSize, mNumThreads;
+	std::vector<Path> mPaths;
+	std::vector<Stage *> mStages;		// first stage runs on the audio thread
+	std::vector<float> mInFifo, mOutFifo;
+	int mPos;							// position in the fifos
+	float mDry, mWet;
+	bool mDeviceInput;
+	Threads<Worker> mWorkers;
+	Atomic<int> mJobCount;
+	Atomic<int> mQuit;
+
+	// Wake sleeping workers after changing the job count, without locking
+	void wakeWorkers(){
+		memoryFence();
+		for(int i=0; i<mWorkers.size(); ++i){
+			Worker& w = mWorkers.function(i);
+			if(w.sleeping.load() && w.sleeping.exchange(0)) w.wake.post();
+		}
+	}
+
+	void runStage(Stage& s){
+		s.process(mPaths, mNumInputs, mNumOutputs, s.readBuf ^ 1);
+	}
+
+	// Stop workers and delete stages
+	void clear(){
+		if(mWorkers.size()){
+			mQuit.store(1);
+			mJobCount.fetchAdd(1);
+			wakeWorkers();
+			mWorkers.join();
+			mWorkers.resize(0);
+			mQuit.store(0);
+			mJobCount.store(0);
+		}
+		for(unsigned i=0; i<mStages.size(); ++i) delete mStages[i];
+		mStages.clear();
+	}
+
+	// Partition the responses and start workers
+	void build(){
+		const int B = mBlockSize;
+		int length = 0;
+		for(unsigned i=0; i<mPaths.size(); ++i){
+			if(int(mPaths[i].ir.size()) > length) length = mPaths[i].ir.size();
+		}
+
+		// A stage of size s starts at 2s - B along the responses, so that
+		// the block it computes once s input samples are in is first due s
+		// samples later. The first stage covers up to the start of the next.
+		int size = B, beg = 0;
+		while(beg < length || mStages.empty()){
+			int next = size*4 <= mMaxBlockSize ? size*4 : size;
+			int end = next != size ? 2*next - B : length;
+			if(end > length) end = length;
+			int numParts = (end - beg + size - 1) / size;
+			if(numParts < 1) numParts = 1;
+			mStages.push_back(new Stage(size, beg, numParts, mNumInputs, mNumOutputs, mPaths.size()));
+			beg += numParts*size;
+			size = next;
+		}
+
+		for(unsigned i=0; i<mStages.size(); ++i){
+			for(unsigned p=0; p<mPaths.size(); ++p){
+				mStages[i]->setImpulse(p, &mPaths[p].ir[0], mPaths[p].ir.size());
+			}
+		}
+
+		mInFifo.assign(mNumInputs*B, 0.f);
+		mOutFifo.assign(mNumOutputs*B, 0.f);
+		mPos = 0;
+
+		if(mNumThreads > 0 && mStages.size() > 1){
+			mWorkers.resize(mNumThreads);
+			for(int i=0; i<mWorkers.size(); ++i) mWorkers.function(i).conv = this;
+			mWorkers.start(false);
+		}
+	}
+
+	void waitForJobs(){
+		for(unsigned i=1; i<mStages.size(); ++i){
+			int spins = 0;
+			while(mStages[i]->state.load() != 0){
+				if(++spins < 1000) cpuRelax();
+				else Thread::yield();
+			}
+		}
+	}
+
+	// Process one block of the first partition size
+	void processBlock(){
+		const int B = mBlockSize;
+		Stage& head = *mStages[0];
+		for(int c=0; c<mNumInputs; ++c){
+			memcpy(&head.pending[c*B], &mInFifo[c*B], B*sizeof(float));
+		}
+		head.shift(mNumInputs);
+		head.process(mPaths, mNumInputs, mNumOutputs, 0);
+		memcpy(&mOutFifo[0], &head.out[0][0], mNumOutputs*B*sizeof(float));
+
+		bool queued = false;
+		for(unsigned i=1; i<mStages.size(); ++i){
+			Stage& s = *mStages[i];
+			for(int c=0; c<mNumInputs; ++c){
+				memcpy(&s.pending[c*s.size + s.fill], &mInFifo[c*B], B*sizeof(float));
+			}
+			s.fill += B;
+
+			// The previous job's output is due now: wait for it, read it
+			// during the next period and queue the new block
+			if(s.fill == s.size){
+				int spins = 0;
+				while(s.state.load() != 0){
+					if(++spins < 1000) cpuRelax();
+					else Thread::yield();
+				}
+				s.readBuf ^= 1;
+				s.readPos = 0;
+				s.shift(mNumInputs);
+				s.fill = 0;
+				if(mWorkers.size()){
+					s.state.store(1);
+					queued = true;
+				}
+				else{
+					runStage(s);
+				}
+			}
+
+			for(int o=0; o<mNumOutputs; ++o){
+				const float * src = &s.out[s.readBuf][o*s.size + s.readPos];
+				float * dst = &mOutFifo[o*B];
+				for(int k=0; k<B; ++k) dst[k] += src[k];
+			}
+			s.readPos += B;
+		}
+		if(queued){
+			mJobCount.fetchAdd(1);
+			wakeWorkers();
+		}
+	}
+
+	void run(const float * const * ins, float * const * outs, int numFrames, float dry, float wet){
+		const int B = mBlockSize;
+		int i = 0;
+		while(i < numFrames){
+			int n = B - mPos;
+			if(n > numFrames - i) n = numFrames - i;
+			for(int c=0; c<mNumInputs; ++c){
+				memcpy(&mInFifo[c*B + mPos], ins[c] + i, n*sizeof(float));
+			}
+			for(int o=0; o<mNumOutputs; ++o){
+				const float * src = &mOutFifo[o*B + mPos];
+				float * dst = outs[o] + i;
+				if(dry == 0.f) for(int k=0; k<n; ++k) dst[k] = wet*src[k];
+				else for(int k=0; k<n; ++k) dst[k] = dry*dst[k] + wet*src[k];
+			}
+			mPos += n;
+			i += n;
+			if(mPos == B){
+				processBlock();
+				mPos = 0;
+			}
+		}
+	}
+};
+
+} // al::
+#endif
@@ -1,19 +1,21 @@
 #ifndef INCLUDE_AL_PANNING_DBAP
 #define INCLUDE_AL_PANNING_DBAP
 
+#include <vector>
 #include "allocore/sound/al_AudioScene.hpp"
 #include "allocore/math/al_Quat.hpp"
 //#include "allocore/spatial/al_CoordinateFrame.hpp"
 
 namespace al{
 
-#define DBAP_MAX_NUM_SPEAKERS 192
+#define DBAP_MAX_NUM_SPEAKERS 192	// no longer a limit; speakers are sized at compile()
 #define DBAP_MAX_DIST 100
 
 class Dbap : public Spatializer{
 public:
 
-    Dbap(SpeakerLayout &sl, float _spread = 5.f) : Spatializer(sl), numSpeakers(0), spread(_spread){}
+    Dbap(SpeakerLayout &sl, float _spread = 5.f)
+	: Spatializer(sl), mListener(0), numSpeakers(0), spread(_spread), mTolerance(1e-4f) {}
 
 	void dump() {
 		printf("Using DBAP Panning- need to add panner info for dump function\n");
@@ -24,6 +26,8 @@ public:
 		numSpeakers = mSpeakers.size();
 		printf("DBAP Compiled with %d speakers\n", numSpeakers);
 
+		speakerVecs.resize(numSpeakers);
+		deviceChannels.resize(numSpeakers);
 		for(int i = 0; i < numSpeakers; i++)
 		{
 			speakerVecs[i] = mSpeakers[i].vec();
@@ -31,52 +35,128 @@ public:
 			deviceChannels[i] = mSpeakers[i].deviceChannel;
 		}
 
+		// gains of all sources must be recomputed for the new speakers
+		SizeGains sizeGains = { numSpeakers };
+		mSourceStates.forEach(sizeGains);
 	}
 
     ///Per Sample Processing
     void perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, int& frameIndex, float& sample)
     {
-		for (unsigned i = 0; i < numSpeakers; ++i)
+		Vec3f dir = relpos.normalized();
+		for (int i = 0; i < numSpeakers; ++i)
         {
-            Vec3d vec = relpos.normalized();
-            vec -= speakerVecs[i];
-			float dist = vec.mag() / 2.f; // [0, 1]
-            dist = powf(dist, spread);
-            float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
-
-            io.out(deviceChannels[i],frameIndex) += gain*sample;
+            io.out(deviceChannels[i],frameIndex) += gain(dir, i)*sample;
 		}
 	}
 
     /// Per Buffer Processing
+
+	/// The gains of a source are cached and only recomputed when its
+	/// direction or the spread changes by more than the tolerance. New gains
+	/// are ramped to from those of the previous block.
 	void perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, float *samples)
     {
-		for (unsigned i = 0; i < numSpeakers; ++i)
-        {
-            Vec3d vec = relpos.normalized();
-            vec -= speakerVecs[i];
-            float dist = vec.mag() / 2.f; // [0, 1]
-            dist = powf(dist, spread);
-            float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
-
-            float *buf = io.outBuffer(deviceChannels[i]);
-			float *samps = samples;
-            for(int j = 0; j < numFrames; j++)
-				*buf++ += gain* *samps++;
+		Vec3f dir = relpos.normalized();
+		const int input = mixBegin(samples, numFrames);
+
+		// a source that was never added has no gains to cache or ramp from
+		SourceState * state = mSourceStates.find(src);
+		if(!state){
+			for (int i = 0; i < numSpeakers; ++i){
+				const float g = gain(dir, i);
+				mix(io, input, deviceChannels[i], samples, g, g, numFrames);
+			}
+			return;
+		}
+
+		// the previous gains are kept by swapping them out before recomputing
+		const std::vector<float> * gainsPrev = &state->gains;
+		if(!state->computed){
+			computeGains(*state, dir);
+		}
+		else if((dir - state->dir).magSqr() > mTolerance*mTolerance || spread != state->spread){
+			state->gains.swap(state->gainsPrev);
+			gainsPrev = &state->gainsPrev;
+			computeGains(*state, dir);
 		}
+
+		for (int i = 0; i < numSpeakers; ++i)
+			mix(io, input, deviceChannels[i], samples, (*gainsPrev)[i], state->gains[i], numFrames);
+	}
+
+	void addSource(SoundSource& src){
+		mSourceStates.add(src).size(numSpeakers);
+	}
+
+	void removeSource(SoundSource& src){
+		mSourceStates.remove(src);
 	}
 
+	void resetSource(SoundSource& src){
+		// keep the gain buffers
+		if(SourceState * state = mSourceStates.find(src)) state->computed = false;
+	}
+
+	/// Per buffer processing only touches the state of the given source,
+	/// which is created when the source is added to the scene, and does not
+	/// allocate
+    bool parallelSafe() const { return true; }
+
     /// Spread is an exponent determining the ampltude spread to nearby speakers.
     /// Values below 1.0 will widen the sound field to more speakers.
     /// Values greater than 1 will focus the sound field to fewer speakers.
     void setSpread(float _spread) { spread = _spread; }
 
+	/// Set change in a source's (unit) direction above which its gains are recomputed
+	void setTolerance(float v){ mTolerance = v; }
+
 private:
+
+	// Gains of a source and the direction and spread they were computed for.
+	// The gain buffers are sized when the source is added or the speakers
+	// compiled, so that perform() does not allocate.
+	struct SourceState{
+		SourceState(): spread(0), computed(false){}
+		Vec3f dir;
+		float spread;
+		std::vector<float> gains;
+		std::vector<float> gainsPrev;	// gains of the previous block, while ramping
+		bool computed;
+
+		void size(int numSpeakers){
+			gains.assign(numSpeakers, 0.f);
+			gainsPrev.assign(numSpeakers, 0.f);
+			computed = false;
+		}
+	};
+
+	struct SizeGains{
+		int numSpeakers;
+		void operator()(SourceState& state){ state.size(numSpeakers); }
+	};
+
 	Listener* mListener;
-	Vec3f speakerVecs[DBAP_MAX_NUM_SPEAKERS];
-	int deviceChannels[DBAP_MAX_NUM_SPEAKERS];
+	std::vector<Vec3f> speakerVecs;
+	std::vector<int> deviceChannels;
 	int numSpeakers;
     float spread;
+	float mTolerance;
+	SourceStates<SourceState> mSourceStates;
+
+	// Gain of a speaker for a source in a (unit) direction
+	float gain(const Vec3f& dir, int speaker) const {
+		float dist = (dir - speakerVecs[speaker]).mag() / 2.f; // [0, 1]
+		dist = powf(dist, spread);
+		return 1.f / (1.f + DBAP_MAX_DIST*dist);
+	}
+
+	void computeGains(SourceState& state, const Vec3f& dir){
+		for (int i = 0; i < numSpeakers; ++i) state.gains[i] = gain(dir, i);
+		state.dir = dir;
+		state.spread = spread;
+		state.computed = true;
+	}
 };
 
 
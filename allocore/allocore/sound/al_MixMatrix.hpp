@@ -0,0 +1,171 @@
+#ifndef INCLUDE_AL_MIXMATRIX_HPP
+#define INCLUDE_AL_MIXMATRIX_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Sparse matrix of ramped gains for mixing many inputs into output channels
+*/
+
+#include <string.h>
+#include <vector>
+#include "allocore/io/al_AudioIO.hpp"
+#include "allocore/system/al_Printing.hpp"
+
+namespace al{
+
+/// Sparse matrix of input to output channel gains
+
+/// Rather than each spatializer accumulating its inputs into the output
+/// channels as they are rendered, the blocks of samples to mix are added
+/// as inputs and the gains from inputs to output channels as entries.
+/// mix() then renders all entries in a single pass over tiles of frames.
+/// A tile of every output channel stays in cache while the corresponding
+/// tiles of the inputs are streamed through once, so large numbers of
+/// channels do not evict each other between sources. Each entry ramps
+/// linearly from a start to an end gain over the block.
+///
+/// Storage grows to the largest block seen and is then reused, so the
+/// matrix does not allocate in steady state.
+class MixMatrix{
+public:
+
+	MixMatrix(): mNumFrames(0), mNumInputs(0){}
+
+	/// Remove all inputs and entries to start a new block
+	void clear(){
+		mNumInputs = 0;
+		mEntries.clear();
+	}
+
+	/// Add a block of samples to be mixed; returns the index of the input
+	int addInput(const float * samples, int numFrames){
+		if(numFrames != mNumFrames){
+			clear();
+			mNumFrames = numFrames;
+		}
+		unsigned end = (mNumInputs+1) * mNumFrames;
+		if(mInputs.size() < end) mInputs.resize(end);
+		memcpy(&mInputs[mNumInputs * mNumFrames], samples, mNumFrames*sizeof(float));
+		return mNumInputs++;
+	}
+
+	/// Add gain from an input to an output channel
+	void add(int input, int channel, float gainBeg, float gainEnd){
+		if(gainBeg == 0.f && gainEnd == 0.f) return;
+		mEntries.push_back(Entry(input * mNumFrames, channel, gainBeg, (gainEnd - gainBeg) / mNumFrames));
+	}
+
+	/// Accumulate all entries into output channels and clear the matrix
+
+	/// The inputs must have as many frames as the io's buffers; otherwise,
+	/// a warning is printed and the block is dropped.
+	void mix(AudioIOData& io){
+		const int numChannels = io.channelsOut();
+		const int numFrames = mNumFrames;
+		if(mEntries.empty()){
+			clear();
+			return;
+		}
+		if(numFrames != io.framesPerBuffer()){
+			AL_WARN_ONCE("MixMatrix::mix: inputs have %d frames, but io buffers have %d; block dropped",
+				numFrames, io.framesPerBuffer());
+			clear();
+			return;
+		}
+
+		// drop entries outside of the io's channels
+		unsigned num = 0;
+		for(unsigned i=0; i<mEntries.size(); ++i){
+			const int c = mEntries[i].channel;
+			if(c >= 0 && c < numChannels) mEntries[num++] = mEntries[i];
+		}
+		mEntries.resize(num);
+
+		// full tiles have a constant length so that the compiler can unroll
+		// and vectorize them completely
+		int i0 = 0;
+		for(; i0+kTile<=numFrames; i0+=kTile) mixTile<kTile>(io, i0);
+		for(; i0<numFrames; ++i0) mixTile<1>(io, i0);
+
+		clear();
+	}
+
+	/// Get number of inputs added since last cleared
+	int numInputs() const { return mNumInputs; }
+
+	/// Get number of entries added since last cleared
+	int numEntries() const { return mEntries.size(); }
+
+private:
+
+	// Accumulate all entries into a tile of N frames of every channel
+	template <int N>
+	void mixTile(AudioIOData& io, int i0){
+		const float * inputs = &mInputs[i0];
+		float * outputs = io.outBuffer() + i0;
+		const int stride = io.framesPerBuffer();
+		for(unsigned e=0; e<mEntries.size(); ++e){
+			const Entry& entry = mEntries[e];
+			const float * in = inputs + entry.offset;
+			float * out = outputs + entry.channel * stride;
+			const float gain = entry.gain + entry.dgain * i0;
+			if(entry.dgain == 0.f){
+				for(int i=0; i<N; ++i) out[i] += in[i] * gain;
+			}
+			else{
+				for(int i=0; i<N; ++i) out[i] += in[i] * (gain + entry.dgain * float(i));
+			}
+		}
+	}
+
+	struct Entry{
+		Entry(){}
+		Entry(int o, int c, float g, float dg): offset(o), channel(c), gain(g), dgain(dg){}
+		int offset;		// offset of input's samples
+		int channel;
+		float gain;		// gain at start of block
+		float dgain;	// gain increment per frame
+	};
+
+	static const int kTile = 64;	// frames mixed together
+
+	std::vector<float> mInputs;		// blocks of samples of each input
+	std::vector<Entry> mEntries;	// entries in order added
+	int mNumFrames;
+	int mNumInputs;
+};
+
+} // al::
+#endif
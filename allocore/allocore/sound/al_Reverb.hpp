@@ -44,6 +44,7 @@
 #include <cmath>
 #include <stdlib.h>
 #include <string.h>
+#include "allocore/math/al_Vec.hpp"
 
 namespace al{
 
@@ -127,6 +128,9 @@ protected:
 /// Dattorro, J. (1997). Effect design: Part 1: Reverberator and other filters.
 /// Journal of the Audio Engineering Society, 45(9):660–684.
 /// https://ccrma.stanford.edu/~dattorro/EffectDesignPart1.pdf
+///
+/// The sample type can also be a Vec, in which case each element runs an
+/// independent reverb; see MultiReverb.
 template <class T = float>
 class Reverb{
 public:
@@ -223,6 +227,17 @@ public:
 				- mDly22.read(121)) * gain;
 	}
 
+	/// Compute wet stereo output from a block of dry mono input
+
+	/// @param[ in] in			dry input samples
+	/// @param[out] out1		wet output samples 1
+	/// @param[out] out2		wet output samples 2
+	/// @param[ in] numFrames	number of samples in each buffer
+	/// @param[ in] gain		gain of output
+	void process(const T * in, T * out1, T * out2, int numFrames, T gain = T(0.6)){
+		for(int i=0; i<numFrames; ++i) (*this)(in[i], out1[i], out2[i], gain);
+	}
+
 	/// Compute wet/dry mix stereo output from dry mono input
 
 	/// @param[in,out] inout1		the input sample and wet/dry output 1
@@ -243,12 +258,22 @@ protected:
 	public:
 		OnePole(): mO1(0), mA0(1), mB1(0){}
 		void damping(T v){ coef(v); }
-		void coef(T v){ mA0=T(1)-std::abs(v); mB1=v; }
+		void coef(T v){ mA0=T(1)-absLanes(v); mB1=v; }
 		T operator()(T i0){ return mO1 = i0*mA0 + mO1*mB1; }
 	protected:
 		T mO1, mA0, mB1;
 	};
 
+	// Absolute value of each element
+	static float absLanes(float v){ return std::abs(v); }
+	static double absLanes(double v){ return std::abs(v); }
+	template <int N, class E>
+	static Vec<N,E> absLanes(const Vec<N,E>& v){
+		Vec<N,E> r;
+		for(int i=0; i<N; ++i) r[i] = std::abs(v[i]);
+		return r;
+	}
+
 	T mDfIn1, mDfIn2, mDfDcy1, mDfDcy2, mDecay;
 
 	StaticDelayLine<  10,T> mPreDelay;
@@ -269,5 +294,44 @@ protected:
 	OnePole mOP2;
 };
 
+
+
+/// Bank of independent plate reverberators
+
+/// This runs N reverbs, e.g. one per zone or speaker group, in the elements
+/// of a Vec. Each operation of the reverb is then applied to all of them at
+/// once, which the compiler can map onto SIMD instructions, so a bank of 4 or
+/// 8 reverbs costs much less than as many separate Reverb objects. The
+/// parameters can be set for all reverbs with a scalar or per reverb with a
+/// Vec.
+template <int N, class T = float>
+class MultiReverb : public Reverb<Vec<N,T> >{
+public:
+
+	typedef Vec<N,T> Lanes;
+
+	/// Compute wet stereo outputs from blocks of dry mono inputs
+
+	/// @param[ in] ins			dry input buffers, one per reverb
+	/// @param[out] outs1		wet output buffers 1, one per reverb
+	/// @param[out] outs2		wet output buffers 2, one per reverb
+	/// @param[ in] numFrames	number of samples in each buffer
+	/// @param[ in] gain		gain of outputs
+	void process(const T * const * ins, T * const * outs1, T * const * outs2, int numFrames, T gain = T(0.6)){
+		const Lanes g(gain);
+		for(int i=0; i<numFrames; ++i){
+			Lanes in, out1, out2;
+			for(int k=0; k<N; ++k) in[k] = ins[k][i];
+			(*this)(in, out1, out2, g);
+			for(int k=0; k<N; ++k){
+				outs1[k][i] = out1[k];
+				outs2[k][i] = out2[k];
+			}
+		}
+	}
+
+	using Reverb<Lanes>::process;
+};
+
 } // al::
 #endif
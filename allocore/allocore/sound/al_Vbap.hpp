@@ -1,6 +1,7 @@
 #ifndef INCLUDE_AL_PANNING_VBAP
 #define INCLUDE_AL_PANNING_VBAP
 
+#include <algorithm>
 #include "allocore/sound/al_AudioScene.hpp"
 
 #define MAX_NUM_VBAP_TRIPLETS 512
@@ -19,7 +20,10 @@ struct SpeakerTriple{
 	int s3;
 	Vec3d s3Vec;
 	Vec3d vec[3];
-	Mat3d mat;
+	Mat3d mat;		// inverse of matrix with speaker vectors as rows
+
+	/// Get speaker index of triplet vertex k in [0, 3)
+	int speaker(int k) const { return k==0 ? s1 : (k==1 ? s2 : s3); }
 
 	void loadVectors(std::vector<Speaker>& spkrs){
 		s1Vec = spkrs[s1].vec();
@@ -35,6 +39,11 @@ struct SpeakerTriple{
 				s2Vec[0],s2Vec[1],s2Vec[2],
 				s3Vec[0],s3Vec[1],s3Vec[2]
 				);
+
+		// Gains are the source direction in the basis of the speaker vectors
+		if(s3!=-1){
+			invert(mat);
+		}
 	}
 
 
@@ -47,6 +56,13 @@ private:
 	Listener* mListener;
 	unsigned int mCachedTripletIndex;
 	bool is3D;
+
+	// Direction lookup grid; cell c holds candidate triplets
+	// mLookupTriplets[mLookupOffsets[c]] to mLookupTriplets[mLookupOffsets[c+1]]
+	int mLookupAzBins, mLookupElBins;
+	std::vector<unsigned> mLookupOffsets;
+	std::vector<unsigned short> mLookupTriplets;
+
 public:
 
 	void dump() {
@@ -54,6 +70,30 @@ public:
 		for (unsigned i = 0; i < mNumTriplets; i++) {
 			printf("Triple #%d: %d,%d,%d \n",i,mTriplets[i].s1,mTriplets[i].s2,mTriplets[i].s3);
 		}
+		if(!mLookupOffsets.empty()){
+			printf("Lookup grid: %dx%d cells, %d candidates, %d bytes\n",
+				mLookupAzBins, mLookupElBins, (int)mLookupTriplets.size(), (int)lookupMemory());
+		}
+	}
+
+	/// Set resolution of the direction-to-triplet lookup grid
+
+	/// The grid divides azimuth and elevation into equal bins and stores the
+	/// triplets overlapping each cell, so that finding the triplet of a source
+	/// takes constant expected time instead of a search over all triplets.
+	/// Passing zero bins disables the grid (the default). The grid is built
+	/// by compile(), so this must be called before the listener is compiled.
+	/// @param[in] azimuthBins		number of bins over 360 degrees of azimuth
+	/// @param[in] elevationBins	number of bins over 180 degrees of elevation
+	void setLookupResolution(int azimuthBins, int elevationBins){
+		mLookupAzBins = azimuthBins;
+		mLookupElBins = elevationBins;
+	}
+
+	/// Returns memory used by the lookup grid, in bytes
+	size_t lookupMemory() const {
+		return mLookupOffsets.size() * sizeof(mLookupOffsets[0])
+			+ mLookupTriplets.size() * sizeof(mLookupTriplets[0]);
 	}
 
 	void addTriple(SpeakerTriple& st) {
@@ -130,12 +170,22 @@ public:
 
 	}
 
-	bool isCrossing(Vec3d c, Vec3d v, SpeakerTriple trip){
-		double a1 = angle(c,trip.s1Vec)+angle(c,trip.s2Vec);
-		double a2 = angle(trip.s1Vec,trip.s2Vec);
-		double a3 = angle(c,trip.s3Vec)+angle(c,v);
-		double a4 = angle(trip.s3Vec,v);
-		return (a1==a2 && a3==a4);
+	// Whether the great circle arcs a1-a2 and b1-b2 cross each other.
+	// Arcs sharing an endpoint are not considered crossing.
+	static bool isCrossing(const Vec3d& a1, const Vec3d& a2, const Vec3d& b1, const Vec3d& b2){
+		const double eps = 0.01;
+		Vec3d c = cross(cross(a1,a2), cross(b1,b2));
+		if(c.magSqr() < 1e-12) return false; // arcs on same great circle
+
+		for(int k=0; k<2; ++k){
+			if(k) c = -c;
+			if(angle(c,a1) < eps || angle(c,a2) < eps || angle(c,b1) < eps || angle(c,b2) < eps)
+				continue;
+			bool onA = fabs(angle(a1,a2) - (angle(a1,c) + angle(c,a2))) <= eps;
+			bool onB = fabs(angle(b1,b2) - (angle(b1,c) + angle(c,b2))) <= eps;
+			if(onA && onB) return true;
+		}
+		return false;
 	}
 
 	// 3D VBAP, find triplets.
@@ -162,7 +212,7 @@ public:
 
 
 		// remove too narrow triples
-		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();++it){
+		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();){
 			SpeakerTriple trip = (*it);
 
 			Vec3d xprod = cross(trip.s1Vec,trip.s2Vec);
@@ -178,41 +228,60 @@ public:
 
 			if (ratio < MIN_VOLUME_TO_LENGTH_RATIO) {
 				//printf("v=%f, l=%f, r=%f x=(%f,%f,%f)\n",volume,length,ratio,xprod[0],xprod[1],xprod[2]);
-				triplets.erase(it);
-				--it;
+				it = triplets.erase(it);
 			}
+			else ++it;
 		}
 
 
-		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();++it){
-			SpeakerTriple trip = (*it);
-			bool remove = false;
-			for(std::list<SpeakerTriple>::iterator it2 = triplets.begin(); it2 != triplets.end();++it2){
-				SpeakerTriple trip2 = (*it2);
-				for (unsigned j = 0; j < 3; ++j) {
-					Vec3d v = trip2.vec[j];
-					Vec3d c = cross(cross(trip.s1Vec, trip.s2Vec),cross(trip.s3Vec,v));
-					if (isCrossing(c,v,trip) || isCrossing(-c,v, trip)) {
-						remove = true;
-						printf("Removing v=(%f,%f,%f) c=(%f,%f,%f)\n",v[0],v[1],v[2],c[0],c[1],c[2]);
-						break;
-					}
-				}
+		// remove crossing connections: speaker pairs are visited from the
+		// shortest to the longest and any longer connection crossing a kept
+		// one is discarded (Pulkki, 1997)
+		std::vector<char> connected(numSpeakers*numSpeakers, 0);
+		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end(); ++it){
+			for(int k=0; k<3; ++k){
+				int i = it->speaker(k), j = it->speaker((k+1)%3);
+				connected[i*numSpeakers+j] = connected[j*numSpeakers+i] = 1;
 			}
+		}
 
-			if (remove) {
-				triplets.erase(it);
-				--it;
+		std::vector<std::pair<double, std::pair<int,int> > > pairs;
+		for (unsigned i = 0; i < numSpeakers; i++){
+			for (unsigned j = i+1; j < numSpeakers; j++){
+				if(connected[i*numSpeakers+j]){
+					pairs.push_back(std::make_pair(angle(spkrs[i].vec(), spkrs[j].vec()), std::make_pair(int(i),int(j))));
+				}
+			}
+		}
+		std::sort(pairs.begin(), pairs.end());
+
+		for(unsigned p = 0; p < pairs.size(); ++p){
+			int i = pairs[p].second.first, j = pairs[p].second.second;
+			if(!connected[i*numSpeakers+j]) continue;
+			for(unsigned q = p+1; q < pairs.size(); ++q){
+				int k = pairs[q].second.first, l = pairs[q].second.second;
+				if(k==i || k==j || l==i || l==j || !connected[k*numSpeakers+l]) continue;
+				if(isCrossing(spkrs[i].vec(), spkrs[j].vec(), spkrs[k].vec(), spkrs[l].vec())){
+					connected[k*numSpeakers+l] = connected[l*numSpeakers+k] = 0;
+				}
 			}
 		}
 
-
+		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();){
+			bool remove = false;
+			for(int k=0; k<3; ++k){
+				int i = it->speaker(k), j = it->speaker((k+1)%3);
+				if(!connected[i*numSpeakers+j]) remove = true;
+			}
+			if (remove) it = triplets.erase(it);
+			else ++it;
+		}
 
 
 		// remove triangles that contain other Speakers
-		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();++it){
+		for(std::list<SpeakerTriple>::iterator it = triplets.begin(); it != triplets.end();){
 			SpeakerTriple trip = (*it);
-			Mat3d invMat = Mat3d(trip.mat).transpose();
+			bool remove = false;
 
 			for (int jj = 0; jj < numSpeakersSigned; ++jj) {
 				// check to see if the current speaker is one of the nodes of the triple
@@ -220,7 +289,7 @@ public:
 					continue;
 
 				Vec3d sVec = spkrs[jj].vec();
-				Vec3d v = sVec * invMat;
+				Vec3d v = sVec * trip.mat;
 
 				// inside if positive or negative near zero, -1e-4 is a magic number
 				bool x_inside = (v[0] >= -1e-4);
@@ -228,13 +297,15 @@ public:
 				bool z_inside = (v[2] >= -1e-4);
 
 
-				if ((x_inside) && (y_inside) && ((is3D) || (z_inside) ) ) 	{
+				if ((x_inside) && (y_inside) && ((!is3D) || (z_inside) ) ) 	{
 					//printf("Removing v=(%f,%f,%f)\n",v[0],v[1],v[2]);
-					triplets.erase(it);
-					--it;
+					remove = true;
 					break;
 				}
 			}
+
+			if (remove) it = triplets.erase(it);
+			else ++it;
 		}
 
 
@@ -247,7 +318,8 @@ public:
 
 
 	Vbap(SpeakerLayout &sl)
-	: Spatializer(sl), mCachedTripletIndex(0),is3D(true)
+	: Spatializer(sl), mNumTriplets(0), mListener(0), mCachedTripletIndex(0),is3D(true),
+		mLookupAzBins(0), mLookupElBins(0)
 	{}
 
 	void compile(Listener& listener){
@@ -261,6 +333,7 @@ public:
 			findSpeakerPairs(mSpeakers);
 		}
 
+		buildLookup();
 		dump();
 
 		if (mNumTriplets == 0 ){
@@ -271,57 +344,201 @@ public:
 	}
 
 
+	/// Per sample processing
 	void perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, int& frameIndex, float& sample){
-		unsigned currentTripletIndex = mCachedTripletIndex; // Cached source placement, so it starts searching from there.
-
-		Vec3d vec = Vec3d(relpos);
-		//printf("(%f,%f,%f)\n",vec[0],vec[1],vec[2]);
 
 		//Rotate vector according to listener-rotation
 		Quatd srcRot = this->mListener->pose().quat();
-		vec = srcRot.rotate(vec);
+		Vec3d vec = srcRot.rotate(relpos);
 
-		//Silent by default
 		Vec3d gains;
-		Vec3d gainsTemp;
+		const SpeakerTriple& triple = mTriplets[findTriplet(vec, gains, mCachedTripletIndex)];
+		gains *= sample/relpos.mag();
+
+		io.out(mSpeakers[triple.s1].deviceChannel,frameIndex) += gains[0];
+		io.out(mSpeakers[triple.s2].deviceChannel,frameIndex) += gains[1];
+		if(is3D){
+			io.out(mSpeakers[triple.s3].deviceChannel,frameIndex) += gains[2];
+		}
+	}
+
+	/// Per buffer processing
+
+	/// The triplet and its gains are computed once per block. The gains are
+	/// then interpolated from the values used in the previous block. If the
+	/// source has moved to a different triplet, the old triplet is faded out
+	/// while the new one is faded in over the block.
+	void perform(AudioIOData& io, SoundSource& src, Vec3d& relpos, const int& numFrames, float *samples){
+
+		Quatd srcRot = this->mListener->pose().quat();
+		Vec3d vec = srcRot.rotate(relpos);
+
+		// a source that was never added has no gains to ramp from
+		SourceState unadded;
+		SourceState * found = mSourceStates.find(src);
+		SourceState& state = found ? *found : unadded;
+
+		Vec3d gainsd;
+		unsigned tripletIndex = findTriplet(vec, gainsd, state.cache);
+		Vec3f gains = gainsd / relpos.mag();
+		if(!found){
+			state.triplet = tripletIndex;
+			state.gains = gains;
+		}
+
+		const unsigned dimensions = is3D?3:2;
+		const SpeakerTriple& triple = mTriplets[tripletIndex];
+		const int input = mixBegin(samples, numFrames);
+
+		if(state.triplet == int(tripletIndex)){
+			for(unsigned k=0; k<dimensions; ++k){
+				const int chan = mSpeakers[triple.speaker(k)].deviceChannel;
+				mix(io, input, chan, samples, state.gains[k], gains[k], numFrames);
+			}
+		}
+		else{
+			if(state.triplet >= 0){
+				const SpeakerTriple& prev = mTriplets[state.triplet];
+				for(unsigned k=0; k<dimensions; ++k){
+					const int chan = mSpeakers[prev.speaker(k)].deviceChannel;
+					mix(io, input, chan, samples, state.gains[k], 0.f, numFrames);
+				}
+			}
+			for(unsigned k=0; k<dimensions; ++k){
+				const int chan = mSpeakers[triple.speaker(k)].deviceChannel;
+				mix(io, input, chan, samples, 0.f, gains[k], numFrames);
+			}
+		}
+
+		state.triplet = tripletIndex;
+		state.gains = gains;
+	}
+
+	void addSource(SoundSource& src){
+		mSourceStates.add(src);
+	}
+
+	void removeSource(SoundSource& src){
+		mSourceStates.remove(src);
+	}
+
+	void resetSource(SoundSource& src){
+		mSourceStates.reset(src);
+	}
+
+	/// Per buffer processing only touches the state of the given source,
+	/// which is created when the source is added to the scene
+	bool parallelSafe() const { return true; }
+
+private:
+
+	// Panning state of a source at the end of the previous block
+	struct SourceState{
+		SourceState(): triplet(-1), cache(0), gains(0.f){}
+		int triplet;	// index of triplet, -1 if not yet panned
+		unsigned cache;	// triplet to start the next search from
+		Vec3f gains;	// gain of each speaker in the triplet
+	};
+
+	SourceStates<SourceState> mSourceStates;
+
+	// Find the triplet enclosing a (listener-relative) direction and compute
+	// its normalized gains. The search starts from the cached triplet, which
+	// is updated with the result. If no triplet encloses the direction, the
+	// gains are left at zero.
+	unsigned findTriplet(Vec3d& vec, Vec3d& gains, unsigned& cache){
+		gains.set(0.,0.,0.);
+
+		if(!mLookupOffsets.empty() && mNumTriplets){
+			// Most sources stay within the same triplet between calls
+			if(tripletGains(vec, cache, gains)) return cache;
+
+			int cell = lookupCell(vec);
+			for(unsigned k=mLookupOffsets[cell]; k<mLookupOffsets[cell+1]; ++k){
+				unsigned t = mLookupTriplets[k];
+				if(tripletGains(vec, t, gains)){
+					cache = t;
+					return t;
+				}
+			}
+			// Fall back to full search for directions the grid missed
+		}
+
+		unsigned currentTripletIndex = cache; // Cached source placement, so it starts searching from there.
 
 		// Search thru the triplets array in search of a match for the source position.
 		for (unsigned count = 0; count < mNumTriplets; ++count) {
-			gainsTemp = computeGains(vec, mTriplets[currentTripletIndex]);
-			if ((gainsTemp[0] >= 0) && (gainsTemp[1] >= 0) && (!is3D || (gainsTemp[2] >= 0)) ){
-				//printf("Gainstemp: (%f,%f,%f)\n",gainsTemp[0],gainsTemp[1],gainsTemp[2]);
-				gainsTemp.normalize();
-				gains = gainsTemp*sample/relpos.mag();
-				//printf("Found: (%d,%d,%d) \n", mTriplets[currentTripletIndex].s1, mTriplets[currentTripletIndex].s2, mTriplets[currentTripletIndex].s3);
-				break;
-			}
+			if(tripletGains(vec, currentTripletIndex, gains)) break;
 
 			++currentTripletIndex;
 			if (currentTripletIndex >= mNumTriplets){
 				currentTripletIndex = 0;
 			}
-			//printf("Index: %d\n",count);
 		}
-		//printf("Gains: (%f,%f,%f)\n",gains[0],gains[1],gains[2]);
 
-		SpeakerTriple triple = mTriplets[currentTripletIndex];
-
-		if(mCachedTripletIndex!=currentTripletIndex){
-			printf("Triple: (%d,%d,%d)\n",triple.s1,triple.s2,triple.s3);
-			printf("Gains: (%f,%f,%f)\n",gains[0],gains[1],gains[2]);
-			printf("Gains-temp: (%f,%f,%f)\n",gainsTemp[0],gainsTemp[1],gainsTemp[2]);
-		}
-
-		mCachedTripletIndex = currentTripletIndex; // Store the new index
+		cache = currentTripletIndex; // Store the new index
+		return currentTripletIndex;
+	}
 
-		io.out(triple.s1,frameIndex) += gains[0];
-		io.out(triple.s2,frameIndex) += gains[1];
-		if(is3D){
-			io.out(triple.s3,frameIndex) += gains[2];
+	// Compute normalized gains of a triplet; returns false if the direction
+	// lies outside of the triplet
+	bool tripletGains(Vec3d& vec, unsigned index, Vec3d& gains){
+		Vec3d gainsTemp = computeGains(vec, mTriplets[index]);
+		if ((gainsTemp[0] >= 0) && (gainsTemp[1] >= 0) && (!is3D || (gainsTemp[2] >= 0)) ){
+			gains = gainsTemp.normalize();
+			return true;
 		}
+		return false;
 	}
 
+	// Get lookup grid cell of a direction (in speaker coordinates)
+	int lookupCell(const Vec3d& vec) const {
+		double az = atan2(vec[0], -vec[2]);			// [-pi, pi]
+		double el = atan2(vec[1], sqrt(vec[0]*vec[0] + vec[2]*vec[2]));	// [-pi/2, pi/2]
+		int ia = int((az + M_PI) * (mLookupAzBins / (2*M_PI)));
+		int ie = int((el + M_PI/2) * (mLookupElBins / M_PI));
+		if(ia >= mLookupAzBins) ia = mLookupAzBins-1;
+		if(ie >= mLookupElBins) ie = mLookupElBins-1;
+		if(ia < 0) ia = 0;
+		if(ie < 0) ie = 0;
+		return ie * mLookupAzBins + ia;
+	}
 
+	// Build the lookup grid by testing a lattice of directions within each
+	// cell (including its borders) against all triplets. Triplets too thin to
+	// hit any lattice point are still found by the fallback search.
+	void buildLookup(){
+		mLookupOffsets.clear();
+		mLookupTriplets.clear();
+		if(!is3D || mLookupAzBins <= 0 || mLookupElBins <= 0 || !mNumTriplets) return;
+
+		const int N = 4; // lattice subdivisions per cell side
+		const double daz = 2*M_PI / mLookupAzBins;
+		const double del = M_PI / mLookupElBins;
+		std::vector<char> hit(mNumTriplets);
+
+		mLookupOffsets.reserve(mLookupAzBins*mLookupElBins + 1);
+		for(int ie=0; ie<mLookupElBins; ++ie){
+		for(int ia=0; ia<mLookupAzBins; ++ia){
+			mLookupOffsets.push_back(mLookupTriplets.size());
+			std::fill(hit.begin(), hit.end(), 0);
+
+			for(int j=0; j<=N; ++j){
+			for(int i=0; i<=N; ++i){
+				double az = -M_PI + (ia + double(i)/N) * daz;
+				double el = -M_PI/2 + (ie + double(j)/N) * del;
+				Vec3d vec(sin(az)*cos(el), sin(el), -cos(az)*cos(el));
+				Vec3d gains;
+				for(unsigned t=0; t<mNumTriplets; ++t){
+					if(!hit[t] && tripletGains(vec, t, gains)){
+						hit[t] = 1;
+						mLookupTriplets.push_back(t);
+					}
+				}
+			}}
+		}}
+		mLookupOffsets.push_back(mLookupTriplets.size());
+	}
 };
 
 
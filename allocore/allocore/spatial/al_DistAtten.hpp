@@ -44,6 +44,7 @@
 */
 
 #include <math.h>
+#include <vector>
 
 namespace al{
 
@@ -97,7 +98,7 @@ public:
 	/// it is identical to an inverse law. When the rolloff=2, it is an
 	/// inverse square law, etc.
 	T inversePower(const T& dist) const {
-		return pow(dist / near(), -rollOff());
+		return ::pow(dist / near(), -rollOff());
 	}
 
 	/// Map distance into attentuation factor using inverse law
@@ -134,6 +135,125 @@ protected:
 };
 
 
+/// Tabulated distance attenuation law
+
+/// This samples an attenuation law over a range of distances so it can be
+/// evaluated with a table lookup and linear interpolation. A single table can
+/// be shared by any number of sources using the same law. Distances below the
+/// near clip map to the first table value and distances beyond the far clip
+/// map to the last.
+template <class T = float>
+class DistAttenTable{
+public:
+
+	/// Attenuation laws
+	enum Law{
+		SIGMOID=0,		/**< 1 - tanh(pi x^2) of normalized distance x; SoundSource's default */
+		LINEAR,			/**< DistAtten::linear() */
+		INVERSE,		/**< DistAtten::inverse() */
+		INVERSE_POWER	/**< DistAtten::inversePower() */
+	};
+
+	/// @param[in] size		number of table entries
+	DistAttenTable(int size = 1024)
+	:	mTable(size+1), mNear(0), mFar(1), mAmpFar(0), mRollOff(1), mLaw(SIGMOID)
+	{	build(); }
+
+	/// Set law and its parameters and recompute table
+
+	/// @param[in] law			attenuation law
+	/// @param[in] nearClip		distance where the table starts
+	/// @param[in] clipRange	range of distances covered by the table
+	/// @param[in] ampFar		amplitude at far clip; the result is mapped to [ampFar, 1]
+	/// @param[in] rollOff		roll off of the law
+	DistAttenTable& set(Law law, T nearClip, T clipRange, T ampFar = T(0), T rollOff = T(1)){
+		mLaw = law;
+		mNear = nearClip;
+		mFar = nearClip + clipRange;
+		mAmpFar = ampFar;
+		mRollOff = rollOff;
+		return build();
+	}
+
+	/// Set law from a DistAtten function and recompute table
+
+	/// The table covers the distances between the DistAtten's near and far
+	/// clips.
+	DistAttenTable& set(const DistAtten<T>& d, typename DistAtten<T>::Func func, T ampFar = T(0)){
+		Law law = func == DistAtten<T>::LINEAR ? LINEAR : func == DistAtten<T>::INVERSE ? INVERSE : INVERSE_POWER;
+		return set(law, d.near(), d.far() - d.near(), ampFar, d.rollOff());
+	}
+
+	Law law() const { return mLaw; }
+	T nearClip() const { return mNear; }
+	T farClip() const { return mFar; }
+	T ampFar() const { return mAmpFar; }
+	T rollOff() const { return mRollOff; }
+
+	/// Get number of table entries
+	int size() const { return mTable.size()-1; }
+
+	/// Returns attenuation factor for a distance
+	T operator()(T dist) const {
+		T x = (dist - mNear) * mInvStep;
+		x = x < T(0) ? T(0) : (x > mMaxX ? mMaxX : x);
+		int i = int(x);
+		T f = x - T(i);
+		return mTable[i] + f * (mTable[i+1] - mTable[i]);
+	}
+
+	/// Compute attenuation factors for a block of distances
+
+	/// The loop is free of branches so that it can be vectorized.
+	///
+	void operator()(T * amps, const T * dists, int numDists) const {
+		const T * table = &mTable[0];
+		const T near = mNear, invStep = mInvStep, maxX = mMaxX;
+		for(int k=0; k<numDists; ++k){
+			T x = (dists[k] - near) * invStep;
+			x = x < T(0) ? T(0) : x;
+			x = x > maxX ? maxX : x;
+			int i = int(x);
+			T f = x - T(i);
+			amps[k] = table[i] + f * (table[i+1] - table[i]);
+		}
+	}
+
+	/// Returns attenuation factor computed directly from the law
+	T evaluate(T dist) const {
+		if(dist < mNear) dist = mNear;
+		if(dist > mFar) dist = mFar;
+		T amp;
+		switch(mLaw){
+		case LINEAR:		amp = (mFar - dist) / (mFar - mNear); break;
+		case INVERSE:		amp = mNear / (mNear + mRollOff * (dist - mNear)); break;
+		case INVERSE_POWER:	amp = ::pow(dist / mNear, -mRollOff); break;
+		default:{
+			T dN = (dist - mNear) / (mFar - mNear);
+			amp = T(1) - tanh(M_PI * dN*dN);
+		}
+		}
+		return mAmpFar + amp * (T(1) - mAmpFar);
+	}
+
+protected:
+	std::vector<T> mTable;	// size()+1 entries, the last repeating the far value
+	T mNear, mFar, mAmpFar, mRollOff;
+	T mInvStep;				// table entries per unit distance
+	T mMaxX;				// largest table position, just below size()
+	Law mLaw;
+
+	DistAttenTable& build(){
+		int n = size();
+		T step = (mFar - mNear) / (n-1);
+		mInvStep = step > T(0) ? T(1) / step : T(0);
+		for(int i=0; i<n; ++i) mTable[i] = evaluate(mNear + step*i);
+		mTable[n] = mTable[n-1];
+		mMaxX = T(n-1);
+		return *this;
+	}
+};
+
 /*
 Distance laws:
 
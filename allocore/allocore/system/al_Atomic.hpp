@@ -0,0 +1,226 @@
+#ifndef INCLUDE_AL_ATOMIC_HPP
+#define INCLUDE_AL_ATOMIC_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+	File description:
+	Lock-free atomic variables for sharing data between threads
+*/
+
+#include "allocore/system/al_Config.h"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+	#include <string.h>
+#endif
+
+/// Size in bytes of a cache line; data written by different threads should be
+/// at least this far apart to avoid false sharing
+#ifndef AL_CACHE_LINE_SIZE
+	#define AL_CACHE_LINE_SIZE 64
+#endif
+
+namespace al {
+
+/// Atomic integer or pointer variable
+
+/// Loads have acquire semantics and stores have release semantics, so a
+/// store by one thread publishes all of its prior writes to any thread that
+/// loads the stored value. Read-modify-write operations are sequentially
+/// consistent. The type must be an integer or pointer of 4 or 8 bytes.
+/// None of the operations block or allocate, so they are safe to use from
+/// the audio thread.
+template <class T>
+class Atomic{
+public:
+
+	/// @param[in] v	initial value
+	Atomic(T v = T()): mValue(v){}
+
+	/// Get value
+	T load() const;
+
+	/// Set value
+	void store(T v);
+
+	/// Add to value, returning the previous value (integer types only)
+	T fetchAdd(T v);
+
+	/// Set value, returning the previous value
+	T exchange(T v);
+
+	/// Set value to desired if it equals expected
+
+	/// @param[in,out] expected		expected value; set to the current value on failure
+	/// @param[in] desired			value to store
+	/// \returns whether the value was stored
+	bool compareExchange(T& expected, T desired);
+
+private:
+	volatile T mValue;
+
+	// not copyable
+	Atomic(const Atomic&);
+	Atomic& operator=(const Atomic&);
+};
+
+
+/// Hint to the processor that the calling thread is in a spin-wait loop
+inline void cpuRelax(){
+	#if defined(__i386__) || defined(__x86_64__)
+		__asm__ __volatile__("pause");
+	#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		_mm_pause();
+	#endif
+}
+
+/// Full memory fence: no load or store is reordered across it
+inline void memoryFence(){
+	#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7) || defined(__clang__))
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	#elif defined(__GNUC__)
+		__sync_synchronize();
+	#elif defined(_MSC_VER)
+		MemoryBarrier();
+	#endif
+}
+
+
+
+
+// -----------------------------------------------------------------------------
+// Inline implementation
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7) || defined(__clang__))
+
+template <class T>
+inline T Atomic<T>::load() const { return __atomic_load_n(&mValue, __ATOMIC_ACQUIRE); }
+
+template <class T>
+inline void Atomic<T>::store(T v){ __atomic_store_n(&mValue, v, __ATOMIC_RELEASE); }
+
+template <class T>
+inline T Atomic<T>::fetchAdd(T v){ return __atomic_fetch_add(&mValue, v, __ATOMIC_SEQ_CST); }
+
+template <class T>
+inline T Atomic<T>::exchange(T v){ return __atomic_exchange_n(&mValue, v, __ATOMIC_SEQ_CST); }
+
+template <class T>
+inline bool Atomic<T>::compareExchange(T& expected, T desired){
+	return __atomic_compare_exchange_n(&mValue, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#elif defined(__GNUC__)
+
+template <class T>
+inline T Atomic<T>::load() const { T v = mValue; __sync_synchronize(); return v; }
+
+template <class T>
+inline void Atomic<T>::store(T v){ __sync_synchronize(); mValue = v; }
+
+template <class T>
+inline T Atomic<T>::fetchAdd(T v){ return __sync_fetch_and_add(&mValue, v); }
+
+template <class T>
+inline T Atomic<T>::exchange(T v){
+	T prev = mValue;
+	while(!compareExchange(prev, v)){}
+	return prev;
+}
+
+template <class T>
+inline bool Atomic<T>::compareExchange(T& expected, T desired){
+	T prev = __sync_val_compare_and_swap(&mValue, expected, desired);
+	if(prev == expected) return true;
+	expected = prev;
+	return false;
+}
+
+#elif defined(_MSC_VER)
+
+// Compare-and-swap on the bit pattern of a 4 or 8 byte value
+template <int Bytes> struct AtomicCAS;
+template <> struct AtomicCAS<4>{
+	typedef long type;
+	static type cas(volatile void * p, type desired, type expected){
+		return _InterlockedCompareExchange((volatile long *)p, desired, expected);
+	}
+};
+template <> struct AtomicCAS<8>{
+	typedef __int64 type;
+	static type cas(volatile void * p, type desired, type expected){
+		return _InterlockedCompareExchange64((volatile __int64 *)p, desired, expected);
+	}
+};
+
+// Volatile accesses have acquire/release semantics with /volatile:ms (the
+// default on x86 and x64)
+template <class T>
+inline T Atomic<T>::load() const { T v = mValue; _ReadWriteBarrier(); return v; }
+
+template <class T>
+inline void Atomic<T>::store(T v){ _ReadWriteBarrier(); mValue = v; }
+
+template <class T>
+inline bool Atomic<T>::compareExchange(T& expected, T desired){
+	typedef AtomicCAS<sizeof(T)> CAS;
+	typename CAS::type e, d, p;
+	memcpy(&e, &expected, sizeof(T));
+	memcpy(&d, &desired, sizeof(T));
+	p = CAS::cas(&mValue, d, e);
+	if(p == e) return true;
+	memcpy(&expected, &p, sizeof(T));
+	return false;
+}
+
+template <class T>
+inline T Atomic<T>::fetchAdd(T v){
+	T prev = load();
+	while(!compareExchange(prev, prev + v)){}
+	return prev;
+}
+
+template <class T>
+inline T Atomic<T>::exchange(T v){
+	T prev = load();
+	while(!compareExchange(prev, v)){}
+	return prev;
+}
+
+#else
+	#error "al::Atomic is not implemented for this compiler"
+#endif
+
+} // al::
+
+#endif /* include guard */
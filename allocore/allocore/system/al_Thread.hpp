@@ -104,6 +104,14 @@ public:
 	///					makes the thread "real-time".
 	Thread& priority(int v);
 
+	/// Set processor core the thread runs on
+
+	/// @param[in] core	index of core in [0, numProcessors()), or -1 for any.
+	///					Takes effect when the thread is started. On OS X this
+	///					is only a hint to keep threads with different values on
+	///					different cores.
+	Thread& affinity(int core);
+
 
 	/// Start executing thread function
 	bool start(ThreadFunction& func);
@@ -125,6 +133,9 @@ public:
 	///
 	static void * current();
 
+	/// Give up the remainder of the calling thread's time slice
+	static void yield();
+
 	// Stuff for assignment
 	friend void swap(Thread& a, Thread& b);
 	Thread& operator= (Thread other);
@@ -137,6 +148,79 @@ protected:
 
 
 
+/// Condition variable with its own mutex
+
+/// Lets threads sleep until another thread changes some shared state. A
+/// waiting thread locks, checks the state, calls wait() while it is not yet
+/// as wanted and finally unlocks. The thread changing the state then calls
+/// signal(), which briefly takes the lock so that no waiter misses it.
+class Condition{
+public:
+
+	Condition();
+
+	~Condition();
+
+	/// Lock the mutex
+	void lock();
+
+	/// Unlock the mutex
+	void unlock();
+
+	/// Unlock, sleep until signaled, then lock again
+
+	/// The mutex must be locked. Waking up does not guarantee that the state
+	/// has changed, so the state should be checked again.
+	void wait();
+
+	/// Like wait(), but wait at most a number of seconds
+
+	/// \returns false if the time ran out
+	bool wait(double seconds);
+
+	/// Wake one or all waiting threads
+	void signal(bool all=false);
+
+private:
+	class Impl;
+	Impl * mImpl;
+
+	Condition(const Condition&);
+	Condition& operator= (const Condition&);
+};
+
+
+
+/// Counting semaphore
+
+/// wait() sleeps until the count is positive and then decrements it. post()
+/// increments the count without locking or blocking, so unlike
+/// Condition::signal() it can be called from the audio thread to wake a
+/// waiting thread.
+class Semaphore{
+public:
+
+	/// @param[in] count	initial count
+	Semaphore(unsigned count=0);
+
+	~Semaphore();
+
+	/// Increment the count, waking one waiting thread
+	void post();
+
+	/// Wait until the count is positive, then decrement it
+	void wait();
+
+private:
+	class Impl;
+	Impl * mImpl;
+
+	Semaphore(const Semaphore&);
+	Semaphore& operator= (const Semaphore&);
+};
+
+
+
 /// Multiple threads acting as a single work unit
 template <class ThreadFunction>
 class Threads{
@@ -0,0 +1,202 @@
+#ifndef INCLUDE_AL_THREAD_POOL_HPP
+#define INCLUDE_AL_THREAD_POOL_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Persistent pool of worker threads that balance load by work stealing
+*/
+
+#include <vector>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
+
+namespace al{
+
+
+/// Persistent pool of worker threads that balance load by work stealing
+
+/// Each worker has a double-ended queue of tasks. A worker runs the newest
+/// task of its own queue and, when that is empty, steals the oldest task of
+/// another worker's queue, which is usually the largest piece of work left.
+/// Tasks submitted by threads outside of the pool go to a shared queue.
+/// Threads waiting for tasks to finish run pending tasks meanwhile, so tasks
+/// may create and wait for tasks of their own. Idle workers sleep.
+///
+/// parallelFor() splits an index range in halves recursively down to a grain
+/// size, so idle workers steal large sub-ranges first:
+/// \code
+///	struct Scale{
+///		float * data;
+///		void operator()(int begin, int end){
+///			for(int i=begin; i<end; ++i) data[i] *= 2;
+///		}
+///	};
+///	ThreadPool pool;
+///	Scale scale = { data };
+///	pool.parallelFor(0, N, scale);
+/// \endcode
+///
+/// @ingroup allocore
+class ThreadPool{
+public:
+
+	class TaskGroup;
+
+	/// Unit of work run by the pool
+	struct Task{
+		Task(): mGroup(0){}
+		virtual ~Task(){}
+
+		/// Called by a pool thread to do the work
+		virtual void run() = 0;
+
+	private:
+		friend class ThreadPool;
+		friend class TaskGroup;
+		TaskGroup * mGroup;
+	};
+
+
+	/// Set of tasks that can be waited on
+	class TaskGroup{
+	public:
+		TaskGroup(ThreadPool& pool): mPool(pool), mPending(0){}
+
+		/// Waits for the tasks
+		~TaskGroup(){ wait(); }
+
+		/// Queue a task to run; it must stay valid until it has run
+		void run(Task& task);
+
+		/// Wait until all tasks have run, running pending tasks meanwhile
+		void wait();
+
+		/// Whether all tasks have run
+		bool done() const { return 0 == mPending.load(); }
+
+	private:
+		friend class ThreadPool;
+		ThreadPool& mPool;
+		Atomic<int> mPending;
+
+		TaskGroup(const TaskGroup&);
+		TaskGroup& operator=(const TaskGroup&);
+	};
+
+
+	/// @param[in] numThreads	number of worker threads; if negative, one
+	///							fewer than numProcessors(), as the thread that
+	///							waits on tasks also runs them
+	/// @param[in] pin			whether to pin workers to cores, starting
+	///							with core 1
+	ThreadPool(int numThreads = -1, bool pin = false);
+
+	/// Finishes queued tasks, then stops the workers
+	~ThreadPool();
+
+	/// Get number of worker threads
+	int size() const { return int(mWorkers.size()); }
+
+
+	/// Call func(begin, end) on sub-ranges of [begin, end) in parallel
+
+	/// @param[in] begin	first index
+	/// @param[in] end		one past last index
+	/// @param[in] func		function object with operator()(int begin, int end)
+	/// @param[in] grain	largest sub-range passed to func; if less than 1,
+	///						chosen to give about 8 sub-ranges per thread
+	template <class RangeFunc>
+	void parallelFor(int begin, int end, RangeFunc& func, int grain = 0);
+
+
+private:
+	class Impl;
+	struct Worker;
+	struct RangeBody;
+
+	// Sub-range of a parallelFor
+	struct RangeTask : public Task{
+		RangeBody * body;
+		int begin, end;
+		void run();
+	};
+
+	// Type-erased body of a parallelFor and the storage for its tasks
+	struct RangeBody{
+		RangeBody(): group(0), numTasks(0), grain(1){}
+		virtual ~RangeBody(){}
+		virtual void operator()(int begin, int end) = 0;
+		TaskGroup * group;
+		std::vector<RangeTask> tasks;
+		Atomic<int> numTasks;
+		int grain;
+	};
+
+	template <class RangeFunc>
+	struct RangeBodyT : public RangeBody{
+		RangeBodyT(RangeFunc& f): func(f){}
+		void operator()(int begin, int end){ func(begin, end); }
+		RangeFunc& func;
+	};
+
+	std::vector<Worker *> mWorkers;
+	Impl * mImpl;
+
+	void forRange(RangeBody& body, int begin, int end, int grain);
+	static void splitRange(RangeBody& body, int begin, int end);
+	void submit(Task& task);
+	bool runPending(Worker * self);
+	bool hasPending() const;
+	static void execute(Task& task);
+	static Worker * worker(const ThreadPool& pool);
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+};
+
+
+
+// Implementation --------------------------------------------------------------
+
+template <class RangeFunc>
+void ThreadPool::parallelFor(int begin, int end, RangeFunc& func, int grain){
+	if(end <= begin) return;
+	RangeBodyT<RangeFunc> body(func);
+	forRange(body, begin, end, grain);
+}
+
+} // al::
+
+#endif
@@ -154,6 +154,9 @@ public:
 	/// Set all data to zero
 	void zero();
 
+	/// Exchange format and data with another Array, without copying
+	void swap(Array& other);
+
 
 	/// Get mutable component using 1-D index
 	template <class T> T& elem(size_t ic, size_t ix){
@@ -350,6 +353,15 @@ template<> inline AlloTy Array::type<void *>(){
 	return 0;
 }
 
+inline void Array::swap(Array& other) {
+	AlloArray tmp = other;
+	static_cast<AlloArray&>(other) = *this;
+	static_cast<AlloArray&>(*this) = tmp;
+}
+
+/// Exchange format and data of two Arrays; found by argument-dependent lookup
+inline void swap(Array& a, Array& b) { a.swap(b); }
+
 inline void Array::deriveStride(AlloArrayHeader& h, size_t alignSize) {
 	allo_array_setstride(&h, alignSize);
 }
@@ -38,6 +38,10 @@
 	File description:
 	Priority queue of scheduled function calls
 
+	Messages are kept in a 4-ary min-heap ordered by time and then by order of
+	scheduling, so sched() and each message dispatched by update() cost
+	O(log n). Message holders come from a pool that grows in chunks as needed.
+
 	File author(s):
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
@@ -56,6 +60,10 @@ public:
 	typedef void * (*malloc_func)(size_t size);
 	typedef void (*free_func)(void * ptr);
 
+	/// @param[in] size		number of messages to allocate up front; the pool
+	///						grows by this many whenever it runs out
+	/// @param[in] mfunc	allocator for pool chunks, the heap and big messages
+	/// @param[in] ffunc	deallocator matching mfunc
 	MsgQueue(int size = 128, malloc_func mfunc = NULL, free_func ffunc = NULL);
 	~MsgQueue();
 
@@ -296,15 +304,37 @@ protected:
 		char * args() { return isBigMessage() ? *(char **)(mArgs) : mArgs; }
 	};
 
-	Msg * mHead;
-	Msg * mTail;
+	// heap entry; the key is stored with the message pointer so that
+	// sifting does not need to touch the messages
+	struct Entry {
+		al_sec t;
+		uint64_t order;
+		Msg * msg;
+
+		bool before(const Entry& e) const {
+			return t < e.t || (t == e.t && order < e.order);
+		}
+	};
+
+	// a block of pooled messages
+	struct Chunk {
+		Chunk * next;
+		Msg msgs[1];
+	};
+
+	Entry * mHeap;
+	Chunk * mChunks;
 	Msg * mPool;
-	int mLen, mChunkSize;
+	int mLen, mCapacity, mChunkSize;
+	uint64_t mOrder;
 	al_sec mNow;
 	malloc_func mMalloc;
 	free_func mFree;
 
 	void growPool(int size);
+	void growHeap();
+	void push(Msg * m);
+	Msg * pop();
 	void recycle(Msg * m);
 };
 
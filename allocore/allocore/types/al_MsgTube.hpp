@@ -36,12 +36,14 @@
 
 
 	File description:
-	Passing functors between a pair of threads
+	Passing functors between a pair of threads, or from many threads to one
 
 	File author(s):
 	Graham Wakefield, 2010, grrrwaaa@gmail.com
 */
 
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Printing.hpp"
 #include "allocore/system/al_Time.h"
 #include "allocore/types/al_SingleRWRingBuffer.hpp"
 #include <string.h>
@@ -93,6 +95,24 @@ public:
 
 	void executeUntil(al_sec until);
 
+	/*
+		Get the time stamp of the next message; returns false if there is none
+		(reader thread only)
+	*/
+	bool nextTime(al_sec& t);
+
+	/*
+		Execute the next message, which must exist (reader thread only)
+	*/
+	void executeNext();
+
+	/*
+		Move messages cached while the ringbuffer was full into it; returns
+		true if none are left (writer thread only)
+		Cached messages are otherwise only moved on the next send.
+	*/
+	bool flush() { return flushCache(); }
+
 	/*
 		Copies 'data', so you can safely free it after this call
 	*/
@@ -234,9 +254,7 @@ protected:
 			rb.write(data, size);
 		} else {
 			//printf("cached message\n");
-			char * cpy = new char[size];
-			memcpy(cpy, data, size);
-			cache(cpy, size);
+			cache(data, size);
 		}
 	}
 };
@@ -255,20 +273,35 @@ inline MsgTube :: MsgTube(int bits)
 }
 
 inline MsgTube :: ~MsgTube() {
-	// TODO: empty the cache
+	while (!cacheq.empty()) {
+		delete[] cacheq.front();
+		cacheq.pop();
+	}
 }
 
 inline void MsgTube :: executeUntil(al_sec until) {
+	al_sec t;
+	while (nextTime(t) && t <= until) {
+		executeNext();
+	}
+}
+
+inline bool MsgTube :: nextTime(al_sec& t) {
 	Header header;
-	while (rb.readSpace() > sizeof(header)) {
-		rb.peek((char *)&header, sizeof(header));
-		if (header.t > until) {
-			return;
-		}
-		char buf[header.size];
-		rb.read(buf, header.size);
-		(header.func)(buf);
+	if (rb.readSpace() <= sizeof(header)) {
+		return false;
 	}
+	rb.peek((char *)&header, sizeof(header));
+	t = header.t;
+	return true;
+}
+
+inline void MsgTube :: executeNext() {
+	Header header;
+	rb.peek((char *)&header, sizeof(header));
+	char buf[header.size];
+	rb.read(buf, header.size);
+	(header.func)(buf);
 }
 
 /*
@@ -298,6 +331,120 @@ inline void MsgTube :: send_data(void (*func)(al_sec t, char * data), char * dat
 }
 
 
+
+/*
+	Passes functors from many writer threads to one reader thread
+
+	Each writer thread gets its own MsgTube from producer(), so writers never
+	contend with each other and the tubes stay lock-free. executeUntil() merges
+	the tubes, executing messages in time stamp order. Messages from the same
+	writer stay in the order they were sent.
+*/
+class MultiMsgTube {
+public:
+
+	/*
+		maxProducers is the number of writer threads that may call producer();
+		each gets a ring buffer of 2^bits bytes
+	*/
+	MultiMsgTube(int maxProducers = 16, int bits = AL_MSGTUBE_DEFAULT_SIZE_BITS);
+	~MultiMsgTube();
+
+	/*
+		Get a tube for the calling writer thread to send() to
+		Call once per writer thread, as this allocates. Returns NULL once
+		maxProducers tubes have been handed out. Writers set their tube's 'now'
+		to time stamp messages.
+	*/
+	MsgTube * producer();
+
+	/*
+		Number of tubes handed out by producer()
+	*/
+	int numProducers() const;
+
+	/*
+		Execute messages from all writers stamped up to 'until' (reader thread)
+	*/
+	void executeUntil(al_sec until);
+
+protected:
+	Atomic<MsgTube *> * mTubes;
+	Atomic<int> mNumClaimed;
+	int mMaxProducers, mBits;
+
+private:
+	MultiMsgTube(const MultiMsgTube&);
+	MultiMsgTube& operator=(const MultiMsgTube&);
+};
+
+inline MultiMsgTube :: MultiMsgTube(int maxProducers, int bits)
+:	mTubes(new Atomic<MsgTube *>[maxProducers]),
+	mNumClaimed(0),
+	mMaxProducers(maxProducers),
+	mBits(bits)
+{}
+
+inline MultiMsgTube :: ~MultiMsgTube() {
+	for (int i = 0; i < mMaxProducers; ++i) {
+		delete mTubes[i].load();
+	}
+	delete[] mTubes;
+}
+
+inline MsgTube * MultiMsgTube :: producer() {
+	int i = mNumClaimed.fetchAdd(1);
+	if (i >= mMaxProducers) {
+		return NULL;
+	}
+	MsgTube * tube = new MsgTube(mBits);
+	// publish the constructed tube to the reader:
+	mTubes[i].store(tube);
+	return tube;
+}
+
+inline int MultiMsgTube :: numProducers() const {
+	int n = mNumClaimed.load();
+	return n < mMaxProducers ? n : mMaxProducers;
+}
+
+inline void MultiMsgTube :: executeUntil(al_sec until) {
+	const int n = numProducers();
+	if (n == 0) return;
+	if (n == 1) {
+		MsgTube * tube = mTubes[0].load();
+		if (tube) tube->executeUntil(until);
+		return;
+	}
+
+	// time of the next message of each tube; tubes not yet published, or
+	// with nothing due, are left out
+	MsgTube * tubes[n];
+	al_sec times[n];
+	int count = 0;
+	for (int i = 0; i < n; ++i) {
+		MsgTube * tube = mTubes[i].load();
+		if (tube && tube->nextTime(times[count]) && times[count] <= until) {
+			tubes[count++] = tube;
+		}
+	}
+
+	// execute the earliest message and refresh the time of its tube
+	while (count) {
+		int first = 0;
+		for (int i = 1; i < count; ++i) {
+			if (times[i] < times[first]) first = i;
+		}
+		tubes[first]->executeNext();
+		if (!(tubes[first]->nextTime(times[first]) && times[first] <= until)) {
+			--count;
+			tubes[first] = tubes[count];
+			times[first] = times[count];
+		}
+	}
+}
+
+
 } // al::
 
 #endif /* include guard */
@@ -0,0 +1,284 @@
+#ifndef INCLUDE_AL_OBJECT_QUEUE_HPP
+#define INCLUDE_AL_OBJECT_QUEUE_HPP
+
+/*	Allocore --
+	Multimedia / virtual environment application class library
+
+	Copyright (C) 2009. AlloSphere Research Group, Media Arts & Technology, UCSB.
+	Copyright (C) 2012. The Regents of the University of California.
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above copyright
+		notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+		Neither the name of the University of California nor the names of its
+		contributors may be used to endorse or promote products derived from
+		this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+
+	File description:
+	Bounded lock-free queue for handing objects between threads
+*/
+
+#include <algorithm>
+#include <stddef.h>
+#include "allocore/system/al_Atomic.hpp"
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_Time.h"
+
+namespace al{
+
+
+/// Bounded lock-free queue of objects
+
+/// Objects are handed over by swapping rather than copying: push() swaps
+/// the caller's object into a slot and pop() swaps it out again. The object
+/// the caller gets back in exchange is one that an earlier pop() left
+/// behind. Slots therefore act as a free-list of recycled objects, and
+/// objects that own memory (arrays, images, vectors) keep their allocation
+/// as they go around. Once the slots hold objects of the right size, the
+/// queue never allocates. Swapping is done with an unqualified call to swap,
+/// so a type's own swap is found by argument-dependent lookup, as for Array.
+///
+/// Any number of threads may push and pop concurrently. The try functions
+/// never wait. The others spin briefly and then sleep on a condition, so
+/// they should not be called from the audio thread. The try functions take
+/// the condition's lock to wake them only while some thread is asleep.
+///
+/// @ingroup allocore
+template <class T>
+class ObjectQueue{
+public:
+
+	/// @param[in] capacity		maximum number of queued objects; rounded up to a power of two
+	/// @param[in] prototype	initial value of the objects in the slots
+	explicit ObjectQueue(int capacity, const T& prototype = T());
+
+	~ObjectQueue();
+
+
+	/// Get maximum number of queued objects
+	int capacity() const { return int(mMask + 1); }
+
+	/// Get number of queued objects; only a snapshot if other threads are active
+	int size() const;
+
+	/// Get whether the queue is empty; only a snapshot if other threads are active
+	bool empty() const { return 0 == size(); }
+
+
+	/// Add an object to the back of the queue if there is room
+
+	/// @param[in,out] v	object to queue; on success it is swapped with a recycled one
+	/// \returns whether the object was queued
+	bool tryPush(T& v);
+
+	/// Remove the object at the front of the queue if there is one
+
+	/// @param[in,out] v	receives the object; its previous value is recycled
+	/// \returns whether an object was removed
+	bool tryPop(T& v);
+
+	/// Add an object to the back of the queue, waiting until there is room
+	void push(T& v){ wait<true>(v, -1); }
+
+	/// Remove the object at the front of the queue, waiting until there is one
+	void pop(T& v){ wait<false>(v, -1); }
+
+	/// Add an object to the back of the queue, waiting up to a timeout
+
+	/// \returns whether the object was queued
+	bool push(T& v, al_sec timeout);
+
+	/// Remove the object at the front of the queue, waiting up to a timeout
+
+	/// \returns whether an object was removed
+	bool pop(T& v, al_sec timeout);
+
+private:
+
+	// A slot's sequence number tells which position may use it next: a
+	// pusher at position p waits for p, a popper for p + 1.
+	struct Slot{
+		Atomic<size_t> seq;
+		T value;
+	};
+
+	Slot * mSlots;
+	size_t mMask;
+	char mPad0[AL_CACHE_LINE_SIZE];
+	Atomic<size_t> mTail;	// next position to push
+	char mPad1[AL_CACHE_LINE_SIZE];
+	Atomic<size_t> mHead;	// next position to pop
+	char mPad2[AL_CACHE_LINE_SIZE];
+	Condition mWake;		// blocked pushers and poppers sleep here
+	Atomic<int> mSleepers;	// number of threads asleep or about to be
+
+	bool enqueue(T& v);
+	bool dequeue(T& v);
+	void wakeSleepers();
+
+	// Retries an operation until it succeeds or, if timeout >= 0, time runs out
+	template <bool Push> bool wait(T& v, al_sec timeout);
+
+	ObjectQueue(const ObjectQueue&);
+	ObjectQueue& operator=(const ObjectQueue&);
+};
+
+
+
+// Implementation --------------------------------------------------------------
+
+template <class T>
+ObjectQueue<T>::ObjectQueue(int capacity, const T& prototype)
+:	mTail(0), mHead(0), mSleepers(0)
+{
+	size_t n = 1;
+	while(n < size_t(capacity)) n <<= 1;
+	mMask = n - 1;
+	mSlots = new Slot[n];
+	for(size_t i=0; i<n; ++i){
+		mSlots[i].seq.store(i);
+		mSlots[i].value = prototype;
+	}
+}
+
+template <class T>
+ObjectQueue<T>::~ObjectQueue(){
+	delete[] mSlots;
+}
+
+template <class T>
+int ObjectQueue<T>::size() const {
+	size_t head = mHead.load();
+	size_t tail = mTail.load();
+	return tail > head ? int(tail - head) : 0;
+}
+
+template <class T>
+bool ObjectQueue<T>::tryPush(T& v){
+	if(!enqueue(v)) return false;
+	wakeSleepers();
+	return true;
+}
+
+template <class T>
+bool ObjectQueue<T>::tryPop(T& v){
+	if(!dequeue(v)) return false;
+	wakeSleepers();
+	return true;
+}
+
+template <class T>
+bool ObjectQueue<T>::enqueue(T& v){
+	size_t pos = mTail.load();
+	Slot * slot;
+	for(;;){
+		slot = &mSlots[pos & mMask];
+		ptrdiff_t diff = ptrdiff_t(slot->seq.load() - pos);
+		if(0 == diff){
+			// claim the position; pos is updated if another pusher got it
+			if(mTail.compareExchange(pos, pos + 1)) break;
+		}
+		else if(diff < 0){
+			return false;	// full; slot not popped since last lap
+		}
+		else{
+			pos = mTail.load();
+		}
+	}
+	using std::swap;
+	swap(slot->value, v);
+	slot->seq.store(pos + 1);
+	return true;
+}
+
+template <class T>
+bool ObjectQueue<T>::dequeue(T& v){
+	size_t pos = mHead.load();
+	Slot * slot;
+	for(;;){
+		slot = &mSlots[pos & mMask];
+		ptrdiff_t diff = ptrdiff_t(slot->seq.load() - (pos + 1));
+		if(0 == diff){
+			if(mHead.compareExchange(pos, pos + 1)) break;
+		}
+		else if(diff < 0){
+			return false;	// empty; slot not pushed yet
+		}
+		else{
+			pos = mHead.load();
+		}
+	}
+	using std::swap;
+	swap(v, slot->value);
+	slot->seq.store(pos + mMask + 1);
+	return true;
+}
+
+template <class T>
+void ObjectQueue<T>::wakeSleepers(){
+	// Order the slot update before reading mSleepers; a sleeper counts itself
+	// before its last attempt, so one of the two sees the other.
+	memoryFence();
+	if(mSleepers.load()) mWake.signal(true);	// pushers and poppers share it
+}
+
+template <class T>
+template <bool Push>
+bool ObjectQueue<T>::wait(T& v, al_sec timeout){
+	const al_sec until = timeout >= 0 ? al_time() + timeout : 0;
+	for(int spins=0; spins<64; ++spins){
+		if(Push ? tryPush(v) : tryPop(v)) return true;
+		cpuRelax();
+	}
+	for(;;){
+		al_sec left = 0;
+		if(timeout >= 0){
+			left = until - al_time();
+			if(left <= 0) return Push ? tryPush(v) : tryPop(v);
+		}
+		mWake.lock();
+		mSleepers.fetchAdd(1);
+		// Not the try functions: their wake would take the lock we hold.
+		bool ok = Push ? enqueue(v) : dequeue(v);
+		if(!ok){
+			if(timeout >= 0)	mWake.wait(left);
+			else				mWake.wait();
+		}
+		mSleepers.fetchAdd(-1);
+		mWake.unlock();
+		if(ok){
+			wakeSleepers();	// someone may wait for the room or object we made
+			return true;
+		}
+	}
+}
+
+template <class T>
+bool ObjectQueue<T>::push(T& v, al_sec timeout){ return wait<true>(v, timeout); }
+
+template <class T>
+bool ObjectQueue<T>::pop(T& v, al_sec timeout){ return wait<false>(v, timeout); }
+
+} // al::
+
+#endif
@@ -44,6 +44,7 @@
 
 #include <cstring>
 
+#include "allocore/system/al_Atomic.hpp"
 #include "allocore/system/pstdint.h"
 
 namespace al {
@@ -53,10 +54,23 @@ namespace al {
  * a reader, one a writer. There is no locking in this ring buffer,
  * so it is ideal to pass data to and from a high priority thread
  * like an audio thread.
+ *
+ * Besides copying with read() and write(), the buffer memory can be
+ * accessed in place: acquireWrite() and acquireRead() return the free or
+ * filled space as up to two contiguous spans (two when it wraps around the
+ * end of the buffer), and commitWrite() and release() hand it over to the
+ * other thread.
  */
 class SingleRWRingBuffer {
 public:
 
+	/** A contiguous region of the buffer memory
+	*/
+	struct Span {
+		char * data;
+		size_t size;
+	};
+
     /** Allocate ringbuffer.
         Actual size rounded up to next power of 2. */
 	SingleRWRingBuffer(size_t sz=256);
@@ -88,11 +102,51 @@ public:
 	*/
 	size_t peek(char * dst, size_t sz);
 
+    /** Get up to sz bytes of space to write into (writer thread).
+		The space starts in span a and continues in span b, which is empty
+		unless the space wraps around. Returns the size of both spans.
+	*/
+	size_t acquireWrite(Span& a, Span& b, size_t sz);
+
+    /** Make sz bytes written into acquired space available to the reader.
+	*/
+	void commitWrite(size_t sz);
+
+    /** Get up to sz bytes of data to read (reader thread).
+		The data starts in span a and continues in span b, which is empty
+		unless the data wraps around. Returns the size of both spans.
+	*/
+	size_t acquireRead(Span& a, Span& b, size_t sz);
+
+    /** Give sz bytes of acquired data back to the writer.
+	*/
+	void release(size_t sz);
+
 protected:
 
 	size_t mSize, mWrap;
-	size_t mRead, mWrite;
 	char * mData;
+	char mPad0[AL_CACHE_LINE_SIZE];
+
+	// Each position is stored by its own thread with release semantics and
+	// loaded by the other with acquire semantics, so that data copied before
+	// a store is visible after the load. Each thread also keeps the last
+	// position it loaded from the other, so it only needs to load it again
+	// when that position does not leave enough room. The writer's and
+	// reader's variables are on separate cache lines.
+	Atomic<size_t> mWrite;
+	size_t mReadCache;
+	char mPad1[AL_CACHE_LINE_SIZE - 2*sizeof(size_t)];
+
+	Atomic<size_t> mRead;
+	size_t mWriteCache;
+	char mPad2[AL_CACHE_LINE_SIZE - 2*sizeof(size_t)];
+
+	void spans(Span& a, Span& b, size_t pos, size_t sz) const;
+
+private:
+	SingleRWRingBuffer(const SingleRWRingBuffer&);
+	SingleRWRingBuffer& operator=(const SingleRWRingBuffer&);
 };
 
 
@@ -109,8 +163,8 @@ inline uint32_t next_power_of_two(uint32_t v){
 inline SingleRWRingBuffer :: SingleRWRingBuffer(size_t sz)
 :	mSize(next_power_of_two(sz)),
 	mWrap(mSize-1),
-	mRead(0),
-	mWrite(0)
+	mWrite(0), mReadCache(0),
+	mRead(0), mWriteCache(0)
 {
 	mData = new char[mSize];
 }
@@ -120,76 +174,81 @@ inline SingleRWRingBuffer :: ~SingleRWRingBuffer() {
 }
 
 inline size_t SingleRWRingBuffer :: writeSpace() const {
-	const size_t r = mRead;
-	const size_t w = mWrite;
-	if (r==w) return mWrap;
-	return ((mSize + (r - w)) & mWrap) - 1;
+	// one byte is kept free to tell a full buffer from an empty one
+	return (mRead.load() - mWrite.load() - 1) & mWrap;
 }
 
 inline size_t SingleRWRingBuffer :: readSpace() const {
-	const size_t r = mRead;
-	const size_t w = mWrite;
-	return (mSize + (w - r)) & mWrap;
+	return (mWrite.load() - mRead.load()) & mWrap;
 }
 
-inline size_t SingleRWRingBuffer :: write(const char * src, size_t sz) {
-	size_t space = writeSpace();
-	sz = sz > space ? space : sz;
-	if (sz == 0) return 0;
-
-	size_t w = mWrite;
-	size_t end = w + sz;
-
-	if (end < mSize) {
-		memcpy(mData+w, src, sz);
+inline void SingleRWRingBuffer :: spans(Span& a, Span& b, size_t pos, size_t sz) const {
+	size_t split = mSize - pos;
+	a.data = mData + pos;
+	b.data = mData;
+	if (sz < split) {
+		a.size = sz;
+		b.size = 0;
 	} else {
-		size_t split = mSize-w;
-		end &= mWrap;
-		memcpy(mData+w, src, split);
-		memcpy(mData, src+split, end);
+		a.size = split;
+		b.size = sz - split;
 	}
+}
 
-	mWrite = end;
+inline size_t SingleRWRingBuffer :: acquireWrite(Span& a, Span& b, size_t sz) {
+	const size_t w = mWrite.load();
+	size_t space = (mReadCache - w - 1) & mWrap;
+	if (space < sz) {
+		mReadCache = mRead.load();
+		space = (mReadCache - w - 1) & mWrap;
+	}
+	sz = sz > space ? space : sz;
+	spans(a, b, w, sz);
 	return sz;
 }
 
-inline size_t SingleRWRingBuffer :: read(char * dst, size_t sz) {
-	size_t space = readSpace();
+inline void SingleRWRingBuffer :: commitWrite(size_t sz) {
+	mWrite.store((mWrite.load() + sz) & mWrap);
+}
+
+inline size_t SingleRWRingBuffer :: acquireRead(Span& a, Span& b, size_t sz) {
+	const size_t r = mRead.load();
+	size_t space = (mWriteCache - r) & mWrap;
+	if (space < sz) {
+		mWriteCache = mWrite.load();
+		space = (mWriteCache - r) & mWrap;
+	}
 	sz = sz > space ? space : sz;
-	if (sz == 0) return 0;
+	spans(a, b, r, sz);
+	return sz;
+}
 
-	size_t r = mRead;
-	size_t end = r + sz;
+inline void SingleRWRingBuffer :: release(size_t sz) {
+	mRead.store((mRead.load() + sz) & mWrap);
+}
 
-	if (end < mSize) {
-		memcpy(dst, mData+r, sz);
-	} else {
-		size_t split = mSize-r;
-		end &= mWrap;
-		memcpy(dst, mData+r, split);
-		memcpy(dst+split, mData, end);
-	}
+inline size_t SingleRWRingBuffer :: write(const char * src, size_t sz) {
+	Span a, b;
+	sz = acquireWrite(a, b, sz);
+	if (sz == 0) return 0;
+	memcpy(a.data, src, a.size);
+	memcpy(b.data, src + a.size, b.size);
+	commitWrite(sz);
+	return sz;
+}
 
-	mRead = end;
+inline size_t SingleRWRingBuffer :: read(char * dst, size_t sz) {
+	sz = peek(dst, sz);
+	release(sz);
 	return sz;
 }
 
 inline size_t SingleRWRingBuffer :: peek(char * dst, size_t sz) {
-	size_t space = readSpace();
-	sz = sz > space ? space : sz;
+	Span a, b;
+	sz = acquireRead(a, b, sz);
 	if (sz == 0) return 0;
-
-	size_t r = mRead;
-	size_t end = r + sz;
-
-	if (end < mSize) {
-		memcpy(dst, mData+r, sz);
-	} else {
-		size_t split = mSize-r;
-		end &= mWrap;
-		memcpy(dst, mData+r, split);
-		memcpy(dst+split, mData, end);
-	}
+	memcpy(dst, a.data, a.size);
+	memcpy(dst + a.size, b.data, b.size);
 	return sz;
 }
 
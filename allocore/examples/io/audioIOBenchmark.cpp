@@ -0,0 +1,64 @@
+/*
+Allocore Example: AudioIO Benchmark
+
+Description:
+This measures the overhead AudioIO adds to each device callback for 2, 32
+and 64 channels of input and output, with a callback that does nothing. The
+device buffers are simulated, so no audio device is needed. Three layouts of
+device buffers are compared:
+
+interleaved		samples of all channels interleaved (the default), which are
+				converted sample by sample to and from the internal buffers
+copied			separate channel buffers, which are copied whole
+direct			non-interleaved channel buffers that follow each other in
+				memory, which callbacks read and write in place
+*/
+
+#include <stdio.h>
+#include <vector>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 20000;
+
+void audioCB(AudioIOData& io){}
+
+enum Layout{ INTERLEAVED, COPIED, DIRECT };
+
+static double run(int chans, Layout layout){
+	AudioIO io(numFrames, 48000, audioCB, 0, chans, chans);
+
+	// interleaved buffers, or channel buffers spaced apart or contiguous
+	int stride = layout == COPIED ? numFrames + 16 : numFrames;
+	std::vector<float> inBuf(chans * stride, 0.1f), outBuf(chans * stride);
+	std::vector<const float *> ins(chans);
+	std::vector<float *> outs(chans);
+	for(int c=0; c<chans; ++c){
+		ins[c] = &inBuf[c * stride];
+		outs[c] = &outBuf[c * stride];
+	}
+	const void * input = layout == INTERLEAVED ? (const void *)&inBuf[0] : (const void *)&ins[0];
+	void * output = layout == INTERLEAVED ? (void *)&outBuf[0] : (void *)&outs[0];
+	bool nonInterleaved = layout != INTERLEAVED;
+
+	Timer timer;
+	timer.start();
+	for(int i=0; i<numBlocks; ++i){
+		io.processDevice(input, output, chans, chans, nonInterleaved);
+	}
+	timer.stop();
+	return timer.elapsedSec() * 1e6 / numBlocks;
+}
+
+int main(){
+	printf("%d frames/buffer, overhead per callback\n", numFrames);
+	printf("%8s %14s %14s %14s\n", "channels", "interleaved", "copied", "direct");
+	int chans[] = {2, 32, 64};
+	for(int i=0; i<3; ++i){
+		printf("%8d %11.2f us %11.2f us %11.2f us\n", chans[i],
+			run(chans[i], INTERLEAVED), run(chans[i], COPIED), run(chans[i], DIRECT));
+	}
+	return 0;
+}
@@ -0,0 +1,63 @@
+/*
+Allocore Example: Audio Profiling
+
+Description:
+This starts an audio stream with a callback function and two AudioCallback
+objects, one of which takes longer on some blocks, and prints the timing
+statistics of the blocks and callbacks every second. Slot 0 is the callback
+function and slots 1 and 2 the AudioCallback objects, in the order they were
+appended.
+*/
+
+#include <math.h>
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+void audioCB(AudioIOData& io){
+	while(io()){
+		io.out(0) = io.out(1) = 0;
+	}
+}
+
+// Sums many sines, taking more time on every 50th block
+struct Additive : public AudioCallback{
+	Additive(): phase(0), block(0){}
+	void onAudioCB(AudioIOData& io){
+		int partials = (++block % 50) ? 8 : 400;
+		while(io()){
+			float s = 0;
+			for(int k=1; k<=partials; ++k) s += sin(k * phase) / k;
+			io.out(0) += 0.05 * s;
+			phase += 220 * M_2PI / io.framesPerSecond();
+			if(phase > M_2PI) phase -= M_2PI;
+		}
+	}
+	double phase;
+	int block;
+};
+
+struct Gain : public AudioCallback{
+	void onAudioCB(AudioIOData& io){
+		while(io()){
+			io.out(1) = io.out(0) *= 0.5;
+		}
+	}
+};
+
+int main(){
+	AudioIO audioIO(128, 44100, audioCB, 0, 2);
+	Additive additive;
+	Gain gain;
+	audioIO.append(additive).append(gain);
+	audioIO.profiling(true);
+	audioIO.start();
+
+	for(int i=0; i<10; ++i){
+		al_sleep(1);
+		audioIO.profiler().print();
+		printf("\n");
+	}
+
+	audioIO.stop();
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+Allocore Example: Offline Rendering
+
+Description:
+This renders four sections of a 64 channel piece to WAV files without an
+audio device, spreading the sections over four threads, and prints how much
+faster than real time the rendering ran. Each section has its own AudioIO
+object and state, so the sections are independent and can be rendered at
+the same time.
+*/
+
+#include <math.h>
+#include <stdio.h>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+static const int numChans = 64;
+static const int numSections = 4;
+static const double sectionSec = 15;
+
+// The state of one section of the piece
+struct Section{
+	double phase[numChans];
+	double freq;
+
+	Section(): freq(0){
+		for(int c=0; c<numChans; ++c) phase[c] = 0;
+	}
+};
+
+void audioCB(AudioIOData& io){
+	Section& s = io.user<Section>();
+	for(int c=0; c<io.channelsOut(); ++c){
+		double inc = s.freq * (1 + 0.01 * c) / io.framesPerSecond();
+		double phase = s.phase[c];
+		float * out = io.outBuffer(c);
+		for(int i=0; i<io.framesPerBuffer(); ++i){
+			out[i] = 0.2 * sin(M_2PI * phase);
+			phase += inc;
+			if(phase >= 1) phase -= 1;
+		}
+		s.phase[c] = phase;
+	}
+}
+
+int main(){
+	Section sections[numSections];
+	AudioIO * ios[numSections];
+	AudioRenderer renderer(numSections);
+
+	for(int i=0; i<numSections; ++i){
+		sections[i].freq = 110 * (i + 1);
+		ios[i] = new AudioIO(256, 48000, audioCB, &sections[i], numChans, 0);
+		char path[32];
+		snprintf(path, sizeof(path), "section%d.wav", i + 1);
+		renderer.add(*ios[i], sectionSec * 48000, path);
+	}
+
+	if(!renderer.run()) printf("Some sections could not be written\n");
+
+	printf("Rendered %.0f s of %d channels on %d threads in %.2f s (%.1fx real time)\n",
+		renderer.secondsRendered(), numChans, renderer.numThreads(),
+		renderer.secondsElapsed(), renderer.realTimeFactor());
+
+	for(int i=0; i<numSections; ++i) delete ios[i];
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+Allocore Example: Ambisonic Decode Benchmark
+
+Description:
+This decodes a third order 3D Ambisonic bus to a 54 speaker dome, first
+with the per speaker loops of AmbiDecode, then with the decode weights
+frozen into a matrix, and finally with near-field compensation enabled on
+every speaker. The throughput of each mode is reported along with the
+largest difference between the outputs of the first two.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Ambisonics.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 5000;
+
+static double run(AmbiDecode& dec, const std::vector<float>& ambi, std::vector<float>& out){
+	Timer timer;
+	double sec = 0;
+	for(int b=0; b<numBlocks; ++b){
+		std::fill(out.begin(), out.end(), 0.f);
+		timer.start();
+		dec.decode(&out[0], &ambi[0], numFrames);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+	return numBlocks / sec;
+}
+
+int main(){
+	Speakers speakers;
+	int chan = 0;
+	for(int i=0; i<12; ++i) speakers.push_back(Speaker(chan++, 360./12*i, -30));
+	for(int i=0; i<24; ++i) speakers.push_back(Speaker(chan++, 360./24*i,   0));
+	for(int i=0; i<12; ++i) speakers.push_back(Speaker(chan++, 360./12*i,  30));
+	for(int i=0; i<6;  ++i) speakers.push_back(Speaker(chan++, 360./6*i,   60));
+	const int numSpeakers = speakers.size();
+
+	AmbiDecode dec(3, 3, numSpeakers);
+	dec.setSpeakers(&speakers);
+	for(int i=0; i<numSpeakers; ++i){
+		dec.setSpeaker(i, speakers[i].deviceChannel, speakers[i].azimuth, speakers[i].elevation);
+	}
+
+	std::vector<float> ambi(dec.channels() * numFrames);
+	for(unsigned i=0; i<ambi.size(); ++i) ambi[i] = float(rand()) / RAND_MAX * 2 - 1;
+
+	std::vector<float> outLoops(numSpeakers * numFrames), outFrozen(numSpeakers * numFrames);
+
+	printf("%d channels to %d speakers, %d frames/block\n", dec.channels(), numSpeakers, numFrames);
+
+	double base = run(dec, ambi, outLoops);
+	printf("loops:          %8.2f blocks/ms\n", base / 1000.);
+
+	dec.freeze();
+	double rate = run(dec, ambi, outFrozen);
+	printf("frozen:         %8.2f blocks/ms (%.1fx)\n", rate / 1000., rate/base);
+
+	double maxDiff = 0;
+	for(unsigned i=0; i<outLoops.size(); ++i){
+		double d = fabs(outLoops[i] - outFrozen[i]);
+		if(d > maxDiff) maxDiff = d;
+	}
+
+	for(int i=0; i<numSpeakers; ++i) dec.nearFieldCompensation(i, 2.5, 44100);
+	rate = run(dec, ambi, outFrozen);
+	printf("frozen + nfc:   %8.2f blocks/ms (%.1fx)\n", rate / 1000., rate/base);
+
+	printf("max difference loops/frozen: %g\n", maxDiff);
+	return 0;
+}
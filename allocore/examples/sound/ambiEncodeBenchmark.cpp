@@ -0,0 +1,92 @@
+/*
+Allocore Example: Ambisonic Encode Benchmark
+
+Description:
+This compares encoding a set of moving sources into B-format one sample at a
+time, recomputing the spherical harmonic weights for every frame, with
+AmbiEncode::encodeBatch(), which computes the weights once per block and
+interpolates them across it. Orders 1 to 3 are measured in 2D and 3D. The
+largest difference between the Ambisonic channels of both methods is also
+reported.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Ambisonics.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 200;
+static const int numSources = 64;
+
+// Direction of a source at a given frame, slowly orbiting the listener
+static Vec3f sourceDir(int s, double t){
+	double az = s*0.37 + t*0.02;
+	double el = sin(s*0.11 + t*0.005) * 0.6;
+	return Vec3f(cos(az)*cos(el), sin(az)*cos(el), sin(el));
+}
+
+int main(){
+	std::vector<float> input(numSources * numFrames);
+	std::vector<const float *> inputs(numSources);
+	for(int s=0; s<numSources; ++s){
+		for(int i=0; i<numFrames; ++i) input[s*numFrames + i] = sin(i*0.01*(s+1));
+		inputs[s] = &input[s*numFrames];
+	}
+
+	std::vector<Vec3f> dirsBeg(numSources), dirsEnd(numSources);
+
+	for(int dim=2; dim<=3; ++dim){
+	for(int order=1; order<=3; ++order){
+		AmbiEncode enc(dim, order);
+		std::vector<float> ambiFrame(enc.channels() * numFrames);
+		std::vector<float> ambiBatch(enc.channels() * numFrames);
+		Timer timer;
+
+		// Per frame weights
+		double base = 0;
+		for(int b=0; b<numBlocks; ++b){
+			std::fill(ambiFrame.begin(), ambiFrame.end(), 0.f);
+			timer.start();
+			for(int s=0; s<numSources; ++s){
+				Vec3f beg = sourceDir(s, b), end = sourceDir(s, b+1);
+				for(int i=0; i<numFrames; ++i){
+					Vec3f dir = beg + (end - beg) * (float(i) / numFrames);
+					dir.normalize();
+					enc.direction(dir[0], dir[1], dir[2]);
+					enc.encode(&ambiFrame[0], numFrames, i, inputs[s][i]);
+				}
+			}
+			timer.stop();
+			base += timer.elapsedSec();
+		}
+
+		// Block rate weights
+		double t = 0;
+		for(int b=0; b<numBlocks; ++b){
+			std::fill(ambiBatch.begin(), ambiBatch.end(), 0.f);
+			timer.start();
+			for(int s=0; s<numSources; ++s){
+				dirsBeg[s] = sourceDir(s, b);
+				dirsEnd[s] = sourceDir(s, b+1);
+			}
+			enc.encodeBatch(&ambiBatch[0], &inputs[0], numFrames, &dirsBeg[0], &dirsEnd[0], numSources);
+			timer.stop();
+			t += timer.elapsedSec();
+		}
+
+		double maxDiff = 0;
+		for(unsigned i=0; i<ambiFrame.size(); ++i){
+			double d = fabs(ambiFrame[i] - ambiBatch[i]);
+			if(d > maxDiff) maxDiff = d;
+		}
+
+		printf("%dD order %d (%2d chans): per frame %8.2f, batch %8.2f sources/ms (%.1fx), max diff %g\n",
+			dim, order, enc.channels(),
+			numSources*numBlocks / (base*1000.), numSources*numBlocks / (t*1000.), base/t, maxDiff);
+	}}
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+Allocore Example: Attenuation Benchmark
+
+Description:
+This compares computing distance attenuation with SoundSource's analytic
+curve against looking it up in a shared DistAttenTable, one distance at a
+time and over a block of distances. The largest difference between the
+analytic and tabulated gains is also reported.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "allocore/sound/al_AudioScene.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 20000;
+
+int main(){
+	SoundSource src(1, 1, 100, 0.05);
+	DistAttenTable<float> table;
+	table.set(DistAttenTable<float>::SIGMOID, src.nearClip(), src.farClip()-src.nearClip(), src.ampFar());
+
+	float dists[numFrames], amps[numFrames];
+	for(int i=0; i<numFrames; ++i) dists[i] = 0.5 + i * 0.4;
+
+	float sum = 0;
+	Timer timer;
+
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numFrames; ++i) amps[i] = src.attenuation(dists[i] + b*1e-4);
+		sum += amps[b % numFrames];
+	}
+	timer.stop();
+	double base = timer.elapsedSec();
+	printf("analytic:     %8.2f ns/distance\n", base * 1e9 / (numBlocks*numFrames));
+
+	src.attenuationTable(&table);
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numFrames; ++i) amps[i] = src.attenuation(dists[i] + b*1e-4);
+		sum += amps[b % numFrames];
+	}
+	timer.stop();
+	double t = timer.elapsedSec();
+	printf("table:        %8.2f ns/distance (%.1fx faster)\n", t * 1e9 / (numBlocks*numFrames), base/t);
+
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		dists[b % numFrames] += 1e-4;
+		src.attenuation(amps, dists, numFrames);
+		sum += amps[b % numFrames];
+	}
+	timer.stop();
+	t = timer.elapsedSec();
+	printf("table, block: %8.2f ns/distance (%.1fx faster)\n", t * 1e9 / (numBlocks*numFrames), base/t);
+
+	double maxDiff = 0;
+	for(double d=0; d<120; d+=0.01){
+		double diff = fabs(table(d) - SoundSource::attenuation(d, 1, 100, 0.05));
+		if(d <= 101 && diff > maxDiff) maxDiff = diff;
+	}
+	printf("max difference within clip range: %g\n", maxDiff);
+	printf("(checksum %g)\n", sum);
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+Allocore Example: Convolver Benchmark
+
+Description:
+This convolves one input with a synthetic 4 second room response for each
+of 8 output channels, as when auralizing a measured room over a speaker
+array, with a latency of 64 samples. The responses are first split into
+uniform partitions of 64 samples, all convolved on the audio thread, then
+into partitions growing up to 8192 samples computed on the audio thread and
+finally with the larger partitions computed on a worker thread. For each,
+the average and worst time per audio buffer spent in the AudioCallback is
+reported.
+
+In an application, the convolver is appended to the AudioIO to process the
+output of the main callback:
+
+	Convolver conv(1, 8, 64, 8192);
+	conv.impulse(0, 0, ir, irLength);
+	...
+	io.append(conv);
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Convolver.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int sampleRate = 48000;
+static const int framesPerBuffer = 256;
+static const int numOutputs = 8;
+static const int irLength = 4 * sampleRate;
+static const int numBuffers = 400;
+
+static void run(const char * name, const std::vector<std::vector<float> >& irs, int maxBlockSize, int numThreads){
+	Convolver conv(1, numOutputs, 64, maxBlockSize, numThreads);
+	for(int o=0; o<numOutputs; ++o) conv.impulse(0, o, &irs[o][0], irLength);
+	conv.dry(0);
+
+	AudioIO io(framesPerBuffer, sampleRate, 0, 0, numOutputs, 0);
+
+	Timer timer;
+	double sum = 0, worst = 0;
+	for(int b=0; b<numBuffers; ++b){
+		io.zeroOut();
+		for(int i=0; i<framesPerBuffer; ++i) io.out(0, i) = float(rand())/RAND_MAX - 0.5f;
+		timer.start();
+		conv.onAudioCB(io);
+		timer.stop();
+		double t = timer.elapsedSec();
+		sum += t;
+		if(t > worst) worst = t;
+	}
+	printf("%-22s %d stages: average %7.3f ms, worst %7.3f ms per buffer\n",
+		name, conv.numStages(), sum*1000/numBuffers, worst*1000);
+}
+
+int main(){
+	// exponentially decaying noise
+	std::vector<std::vector<float> > irs(numOutputs, std::vector<float>(irLength));
+	for(int o=0; o<numOutputs; ++o){
+		for(int i=0; i<irLength; ++i){
+			irs[o][i] = (float(rand())/RAND_MAX - 0.5f) * exp(-6.9 * i / irLength);
+		}
+	}
+
+	printf("%d outputs, %d sample responses, %d frames/buffer (%.3f ms)\n",
+		numOutputs, irLength, framesPerBuffer, 1000. * framesPerBuffer / sampleRate);
+	run("uniform", irs, 64, 0);
+	run("non-uniform", irs, 8192, 0);
+	run("non-uniform + worker", irs, 8192, 1);
+	return 0;
+}
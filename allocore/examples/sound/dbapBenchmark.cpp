@@ -0,0 +1,90 @@
+/*
+Allocore Example: DBAP Benchmark
+
+Description:
+This pans a set of sources to a dome of 300 speakers with DBAP. The gains
+recomputed for every source and block, as Dbap used to do, are compared
+with Dbap's cached gains for sources that are still, that drift by less
+than the cache tolerance and that move on every block.
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Dbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 50;
+static const int numSources = 32;
+
+// Pan a block with gains computed from scratch
+static void performUncached(AudioIOData& io, Speakers& speakers, float spread, Vec3d& relpos, const float * samples){
+	for(unsigned i=0; i<speakers.size(); ++i){
+		Vec3d vec = relpos.normalized();
+		vec -= speakers[i].vec().normalized();
+		float dist = vec.mag() / 2.f;
+		dist = powf(dist, spread);
+		float gain = 1.f / (1.f + DBAP_MAX_DIST*dist);
+
+		float * buf = io.outBuffer(speakers[i].deviceChannel);
+		for(int j=0; j<numFrames; ++j) buf[j] += gain * samples[j];
+	}
+}
+
+static Vec3d sourcePos(int s, int b, double speed){
+	double phs = s*0.7 + b*speed;
+	return Vec3d(cos(phs)*4, sin(s*0.37)*2, sin(phs)*4);
+}
+
+int main(){
+	SpeakerLayout layout;
+	int chan = 0;
+	for(int r=0; r<5; ++r){
+		for(int i=0; i<60; ++i) layout.addSpeaker(Speaker(chan++, 6.*i, -60 + 30*r));
+	}
+
+	Dbap dbap(layout);
+	AudioScene scene(numFrames);
+	scene.createListener(&dbap);
+	std::vector<SoundSource> sources(numSources);
+
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	float samples[numFrames];
+	for(int i=0; i<numFrames; ++i) samples[i] = sin(i*0.01);
+
+	const char * names[] = {"still", "drifting", "moving"};
+	const double speeds[] = {0, 1e-6, 1e-2};
+	for(int m=0; m<3; ++m){
+		Timer timer;
+		timer.start();
+		for(int b=0; b<numBlocks; ++b){
+			for(int s=0; s<numSources; ++s){
+				Vec3d relpos = sourcePos(s, b, speeds[m]);
+				performUncached(io, layout.speakers(), 5.f, relpos, samples);
+			}
+		}
+		timer.stop();
+		double base = timer.elapsedSec();
+
+		for(int s=0; s<numSources; ++s) dbap.addSource(sources[s]);
+		timer.start();
+		for(int b=0; b<numBlocks; ++b){
+			for(int s=0; s<numSources; ++s){
+				Vec3d relpos = sourcePos(s, b, speeds[m]);
+				dbap.perform(io, sources[s], relpos, numFrames, samples);
+			}
+		}
+		timer.stop();
+		double t = timer.elapsedSec();
+
+		printf("%-9s uncached %8.2f, cached %8.2f sources/ms (%.1fx)\n", names[m],
+			numSources*numBlocks / (base*1000), numSources*numBlocks / (t*1000), base/t);
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+/*
+Allocore Example: Doppler Benchmark
+
+Description:
+This measures the cost of reading a block of samples from a source's
+delay-line. The per sample reads with a fixed index, as previously done for
+every block in AudioScene, are compared with the ramped block reads of
+SoundSource::readSamples() using each interpolation type.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "allocore/sound/al_AudioScene.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 20000;
+
+int main(){
+	SoundSource src;
+	for(int i=0; i<src.delaySize(); ++i) src.writeSample(sin(i*0.01));
+
+	float out[numFrames];
+	float sum = 0;
+	Timer timer;
+
+	// Fixed index per block, per sample reads
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		double delay = 1000 + (b % 100) * 0.37;
+		for(int i=0; i<numFrames; ++i){
+			out[i] = src.readSample(delay + (numFrames-i));
+		}
+		sum += out[b % numFrames];
+	}
+	timer.stop();
+	double base = timer.elapsedSec();
+	printf("fixed index, linear: %8.2f ns/sample\n", base * 1e9 / (numBlocks*numFrames));
+
+	const char * names[] = {"linear", "cubic", "lagrange3"};
+	for(int t=0; t<3; ++t){
+		src.interpolation(SoundSource::Interpolation(t));
+		timer.start();
+		for(int b=0; b<numBlocks; ++b){
+			double delayPrev = 1000 + ((b-1) % 100) * 0.37;
+			double delay = 1000 + (b % 100) * 0.37;
+			src.readSamples(out, numFrames, delayPrev + numFrames, delay);
+			sum += out[b % numFrames];
+		}
+		timer.stop();
+		double t1 = timer.elapsedSec();
+		printf("ramped index, %-9s %8.2f ns/sample (%.2fx)\n", names[t],
+			t1 * 1e9 / (numBlocks*numFrames), t1/base);
+	}
+
+	printf("(checksum %g)\n", sum);
+	return 0;
+}
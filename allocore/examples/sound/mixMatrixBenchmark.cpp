@@ -0,0 +1,96 @@
+/*
+Allocore Example: Mix Matrix Benchmark
+
+Description:
+This renders scenes of 64, 256 and 1024 moving sources with VBAP and DBAP
+to domes of 40 and 240 speakers, first with each source mixed into the
+output channels as it is rendered, then with the sources' gains collected
+in a MixMatrix and mixed in a single pass. The throughput of AudioScene::render() is reported for both, along
+with the largest difference between their outputs.
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/sound/al_Dbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 50;
+
+// Render a scene; returns sources/ms
+template <class Panner>
+static double run(SpeakerLayout& layout, int numSources, bool matrix, std::vector<float>& out){
+	Panner spatializer(layout);
+	AudioScene scene(numFrames);
+	scene.createListener(&spatializer);
+	scene.useMixMatrix(matrix);
+	std::vector<SoundSource> sources(numSources);
+	for(int i=0; i<numSources; ++i) scene.addSource(sources[i]);
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	Timer timer;
+	double sec = 0;
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numSources; ++i){
+			double phs = double(i)/numSources * 2*M_PI + b*0.01;
+			sources[i].pose().pos(cos(phs)*4, sin(i*0.37)*2, sin(phs)*4);
+			for(int k=0; k<numFrames; ++k) sources[i].writeSample(sin(k*0.01*(i%20+1)));
+		}
+		io.zeroOut();
+		timer.start();
+		scene.render(io);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+
+	out.assign(io.outBuffer(), io.outBuffer() + io.channelsOut()*numFrames);
+	return numSources * numBlocks / (sec * 1000.);
+}
+
+static void report(const char * name, SpeakerLayout& layout, int numSources, double direct, double matrix,
+	const std::vector<float>& outDirect, const std::vector<float>& outMatrix
+){
+	double maxDiff = 0;
+	for(unsigned i=0; i<outDirect.size(); ++i){
+		double d = fabs(outDirect[i] - outMatrix[i]);
+		if(d > maxDiff) maxDiff = d;
+	}
+	printf("%s %3d speakers %4d sources: direct %8.2f, matrix %8.2f sources/ms (%.2fx), max diff %g\n",
+		name, layout.numSpeakers(), numSources, direct, matrix, matrix/direct, maxDiff);
+}
+
+int main(){
+	// a small dome and a large one with the output channels exceeding the cache
+	SpeakerLayout layouts[2];
+	const int rings[] = {8, 48};
+	for(int l=0; l<2; ++l){
+		int chan = 0;
+		for(int r=0; r<4; ++r){
+			int n = r == 1 ? rings[l]*2 : rings[l];
+			for(int i=0; i<n; ++i) layouts[l].addSpeaker(Speaker(chan++, 360./n*i, -45 + 30*r));
+		}
+	}
+
+	const int counts[] = {64, 256, 1024};
+	for(int l=0; l<2; ++l){
+		for(int c=0; c<3; ++c){
+			std::vector<float> outDirect, outMatrix;
+			double direct = run<Vbap>(layouts[l], counts[c], false, outDirect);
+			double matrix = run<Vbap>(layouts[l], counts[c], true, outMatrix);
+			report("vbap", layouts[l], counts[c], direct, matrix, outDirect, outMatrix);
+		}
+		for(int c=0; c<3; ++c){
+			std::vector<float> outDirect, outMatrix;
+			double direct = run<Dbap>(layouts[l], counts[c], false, outDirect);
+			double matrix = run<Dbap>(layouts[l], counts[c], true, outMatrix);
+			report("dbap", layouts[l], counts[c], direct, matrix, outDirect, outMatrix);
+		}
+	}
+
+	return 0;
+}
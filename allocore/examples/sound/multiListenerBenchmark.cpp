@@ -0,0 +1,81 @@
+/*
+Allocore Example: Multi-listener Benchmark
+
+Description:
+This renders a scene of moving sources for 1 to 4 listeners, each panning
+with VBAP to its own set of output channels. The delayed block of each
+source is read once and shared by all listeners at the same position, so
+adding co-located listeners (e.g., a binaural monitor at the center of a
+dome) only adds their spatialization. Listeners at different positions
+hear the sources with different doppler delays and have to read their own
+blocks. The render time per block is reported relative to a single
+listener for both cases.
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 100;
+static const int numSources = 256;
+static const int maxListeners = 4;
+
+// Render with a number of listeners; returns seconds per block
+static double run(int numListeners, bool coLocated){
+	SpeakerLayout layouts[maxListeners];
+	std::vector<Vbap *> vbaps;
+	AudioScene scene(numFrames);
+
+	for(int l=0; l<numListeners; ++l){
+		int chan = l * 24;
+		for(int i=0; i<8; ++i) layouts[l].addSpeaker(Speaker(chan++, 360./8*i, -45));
+		for(int i=0; i<8; ++i) layouts[l].addSpeaker(Speaker(chan++, 360./8*i,   0));
+		for(int i=0; i<8; ++i) layouts[l].addSpeaker(Speaker(chan++, 360./8*i,  45));
+		vbaps.push_back(new Vbap(layouts[l]));
+		Listener * listener = scene.createListener(vbaps.back());
+		if(!coLocated) listener->pose().pos(l*3, 0, 0);
+	}
+
+	std::vector<SoundSource> sources(numSources);
+	for(int i=0; i<numSources; ++i) scene.addSource(sources[i]);
+
+	AudioIO io(numFrames, 44100, 0, 0, maxListeners*24, 0);
+
+	Timer timer;
+	double sec = 0;
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numSources; ++i){
+			double phs = double(i)/numSources * 2*M_PI + b*0.01;
+			sources[i].pose().pos(cos(phs)*8, 0, sin(phs)*8);
+			for(int k=0; k<numFrames; ++k) sources[i].writeSample(sin(k*0.01*(i%20+1)));
+		}
+		io.zeroOut();
+		timer.start();
+		scene.render(io);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+
+	for(unsigned i=0; i<vbaps.size(); ++i) delete vbaps[i];
+	return sec / numBlocks;
+}
+
+int main(){
+	printf("%d sources, %d frames/block\n", numSources, numFrames);
+	const char * names[] = {"separated", "co-located"};
+	for(int c=0; c<2; ++c){
+		double base = run(1, c);
+		printf("%-10s 1 listener:  %7.3f ms/block\n", names[c], base*1000);
+		for(int n=2; n<=maxListeners; ++n){
+			double t = run(n, c);
+			printf("%-10s %d listeners: %7.3f ms/block (%.2fx)\n", names[c], n, t*1000, t/base);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+Allocore Example: Parallel Scene Benchmark
+
+Description:
+This renders an AudioScene with many moving sources through VBAP, first on a
+single thread, then with parallel rendering enabled. The throughput of both
+modes is reported, along with the largest difference between their outputs.
+
+Usage: parallelSceneBenchmark [sources] [threads]
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 200;
+
+struct Bench{
+	SpeakerLayout layout;
+	Vbap * vbap;
+	AudioScene scene;
+	std::vector<SoundSource> sources;
+	AudioIO io;
+	std::vector<float> lastOut;
+
+	Bench(int numSources)
+	:	scene(numFrames), sources(numSources)
+	{
+		int chan = 0;
+		for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,  -45));
+		for(int i=0; i<16; ++i) layout.addSpeaker(Speaker(chan++, 360./16*i,   0));
+		for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,   45));
+
+		vbap = new Vbap(layout);
+		scene.createListener(vbap);
+		for(int i=0; i<numSources; ++i) scene.addSource(sources[i]);
+
+		io.framesPerBuffer(numFrames);
+		io.channelsOut(layout.numSpeakers());
+	}
+
+	~Bench(){ delete vbap; }
+
+	// Render all blocks and return sources/ms
+	double run(){
+		int numSources = sources.size();
+		Timer timer;
+		timer.start();
+		for(int b=0; b<numBlocks; ++b){
+			for(int s=0; s<numSources; ++s){
+				double phs = double(s)/numSources * 2*M_PI + b*0.01;
+				sources[s].pose().pos(cos(phs)*4, sin(s*0.37)*2, sin(phs)*4);
+				for(int i=0; i<numFrames; ++i){
+					sources[s].writeSample(sin((b*numFrames + i) * 0.01 * (s+1)));
+				}
+			}
+			io.zeroOut();
+			scene.render(io);
+		}
+		timer.stop();
+		lastOut.assign(io.outBuffer(), io.outBuffer() + io.channelsOut()*numFrames);
+		return numSources * numBlocks / (timer.elapsedSec() * 1000.);
+	}
+};
+
+int main(int argc, char * argv[]){
+	int numSources = argc > 1 ? atoi(argv[1]) : 400;
+	int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+
+	Bench serial(numSources);
+	Bench parallel(numSources);
+	parallel.scene.useParallelRendering(numThreads);
+
+	double serialRate = serial.run();
+	double parallelRate = parallel.run();
+
+	double maxDiff = 0;
+	for(unsigned i=0; i<serial.lastOut.size(); ++i){
+		double d = fabs(serial.lastOut[i] - parallel.lastOut[i]);
+		if(d > maxDiff) maxDiff = d;
+	}
+
+	printf("%d sources, %d speakers, %d frames/block\n", numSources, serial.layout.numSpeakers(), numFrames);
+	printf("1 thread:   %10.2f sources/ms\n", serialRate);
+	printf("%d threads: %10.2f sources/ms (%.1fx)\n", numThreads, parallelRate, parallelRate/serialRate);
+	printf("max output difference: %g\n", maxDiff);
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+Allocore Example: Reverb Benchmark
+
+Description:
+This runs 8 independent plate reverbs, e.g. one per zone of a venue, first
+as separate Reverb objects processing one sample at a time, then with
+Reverb::process(), and finally as banks of 4 and 8 reverbs in a
+MultiReverb. The throughput of each method is reported along with the
+largest difference between the outputs of the banks and the separate
+reverbs.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Reverb.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 2000;
+static const int numReverbs = 8;
+
+typedef std::vector<std::vector<float> > Buffers;
+
+static double maxDiff(const Buffers& a, const Buffers& b){
+	double r = 0;
+	for(unsigned k=0; k<a.size(); ++k){
+		for(unsigned i=0; i<a[k].size(); ++i){
+			double d = fabs(a[k][i] - b[k][i]);
+			if(d > r) r = d;
+		}
+	}
+	return r;
+}
+
+// Fill inputs with a noise burst on one reverb every few blocks
+static void fillInput(Buffers& in, int b){
+	for(unsigned k=0; k<in.size(); ++k){
+		for(int i=0; i<numFrames; ++i){
+			in[k][i] = (b % 50 == int(k)) ? float(rand())/RAND_MAX - 0.5f : 0.f;
+		}
+	}
+}
+
+int main(){
+	Buffers in(numReverbs, std::vector<float>(numFrames));
+	Buffers outRef1(in), outRef2(in), out1(in), out2(in);
+	const float * ins[numReverbs];
+	float * outs1[numReverbs], * outs2[numReverbs];
+	for(int k=0; k<numReverbs; ++k){
+		ins[k] = &in[k][0];
+		outs1[k] = &out1[k][0];
+		outs2[k] = &out2[k][0];
+	}
+
+	Timer timer;
+	double sec;
+
+	// Separate reverbs, per sample
+	{
+		std::vector<Reverb<float> > reverbs(numReverbs);
+		srand(1); sec = 0;
+		for(int b=0; b<numBlocks; ++b){
+			fillInput(in, b);
+			timer.start();
+			for(int k=0; k<numReverbs; ++k){
+				for(int i=0; i<numFrames; ++i) reverbs[k](in[k][i], outRef1[k][i], outRef2[k][i]);
+			}
+			timer.stop();
+			sec += timer.elapsedSec();
+		}
+	}
+	const double base = sec;
+	printf("%d reverbs, per sample:  %8.2f ns/frame\n", numReverbs, base*1e9/(numBlocks*numFrames));
+
+	// Separate reverbs, per block
+	{
+		std::vector<Reverb<float> > reverbs(numReverbs);
+		srand(1); sec = 0;
+		for(int b=0; b<numBlocks; ++b){
+			fillInput(in, b);
+			timer.start();
+			for(int k=0; k<numReverbs; ++k) reverbs[k].process(ins[k], outs1[k], outs2[k], numFrames);
+			timer.stop();
+			sec += timer.elapsedSec();
+		}
+	}
+	printf("%d reverbs, per block:   %8.2f ns/frame (%.1fx), max diff %g\n", numReverbs,
+		sec*1e9/(numBlocks*numFrames), base/sec, maxDiff(outRef1, out1));
+
+	// Two banks of 4
+	{
+		MultiReverb<4> reverbs[2];
+		srand(1); sec = 0;
+		for(int b=0; b<numBlocks; ++b){
+			fillInput(in, b);
+			timer.start();
+			reverbs[0].process(ins  , outs1  , outs2  , numFrames);
+			reverbs[1].process(ins+4, outs1+4, outs2+4, numFrames);
+			timer.stop();
+			sec += timer.elapsedSec();
+		}
+	}
+	printf("2 x MultiReverb<4>:     %8.2f ns/frame (%.1fx), max diff %g\n",
+		sec*1e9/(numBlocks*numFrames), base/sec, maxDiff(outRef1, out1));
+
+	// One bank of 8
+	{
+		MultiReverb<8> reverbs;
+		srand(1); sec = 0;
+		for(int b=0; b<numBlocks; ++b){
+			fillInput(in, b);
+			timer.start();
+			reverbs.process(ins, outs1, outs2, numFrames);
+			timer.stop();
+			sec += timer.elapsedSec();
+		}
+	}
+	printf("1 x MultiReverb<8>:     %8.2f ns/frame (%.1fx), max diff %g\n",
+		sec*1e9/(numBlocks*numFrames), base/sec, maxDiff(outRef2, out2));
+
+	return 0;
+}
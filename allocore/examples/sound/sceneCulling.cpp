@@ -0,0 +1,74 @@
+/*
+Allocore Example: Scene Culling
+
+Description:
+This renders a large scene of sources scattered up to 300 units from the
+listener, most of them beyond their far clip of 100 units. The scene is
+rendered without culling, then with a culling threshold of -60 dB, and
+finally with sources further than 20 units demoted to a first order
+Ambisonics spatializer. The per block source counters of the scene are
+printed along with the throughput of AudioScene::render().
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/sound/al_Ambisonics.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 100;
+static const int numSources = 1000;
+
+int main(){
+	SpeakerLayout layout;
+	int chan = 0;
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,  -45));
+	for(int i=0; i<16; ++i) layout.addSpeaker(Speaker(chan++, 360./16*i,   0));
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,   45));
+
+	Vbap vbap(layout);
+	AmbisonicsSpatializer ambi(layout, 3, 1);
+	AudioScene scene(numFrames);
+	Listener * listener = scene.createListener(&vbap);
+
+	std::vector<SoundSource> sources(numSources, SoundSource(1, 1, 99, 0));
+	srand(1);
+	for(int i=0; i<numSources; ++i){
+		double dist = 2 + 298. * rand() / RAND_MAX;
+		double phs = 2*M_PI * rand() / RAND_MAX;
+		sources[i].pose().pos(cos(phs)*dist, 0, sin(phs)*dist);
+		scene.addSource(sources[i]);
+	}
+
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	const char * names[] = {"no culling", "culling", "culling + lod"};
+	for(int mode=0; mode<3; ++mode){
+		if(mode == 1) scene.cullThreshold(0.001);
+		if(mode == 2) listener->lod(&ambi, 20);
+
+		Timer timer;
+		double sec = 0;
+		for(int b=0; b<numBlocks; ++b){
+			for(int i=0; i<numSources; ++i){
+				for(int k=0; k<numFrames; ++k) sources[i].writeSample(sin(k*0.01*(i%20+1)));
+			}
+			io.zeroOut();
+			timer.start();
+			scene.render(io);
+			timer.stop();
+			sec += timer.elapsedSec();
+		}
+
+		printf("%-14s %8.2f blocks/s, %4d active, %4d culled, %4d lod\n", names[mode],
+			numBlocks / sec,
+			scene.numActiveSources(), scene.numCulledSources(), scene.numLodSources());
+	}
+
+	return 0;
+}
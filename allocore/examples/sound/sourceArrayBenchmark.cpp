@@ -0,0 +1,126 @@
+/*
+Allocore Example: Source Array Benchmark
+
+Description:
+This compares rendering an AudioScene from individually allocated
+SoundSource objects with rendering the same sources from a SoundSourceArray,
+which stores them as a structure of arrays. Scenes of 64, 256 and 1024
+moving sources are panned with VBAP. The throughput of AudioScene::render()
+is reported as the number of source blocks rendered per millisecond, along
+with the largest difference between the outputs of the two methods.
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 100;
+
+static void makeLayout(SpeakerLayout& layout){
+	int chan = 0;
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,  -45));
+	for(int i=0; i<16; ++i) layout.addSpeaker(Speaker(chan++, 360./16*i,   0));
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,   45));
+}
+
+static Vec3d sourcePos(int i, int b, int numSources){
+	double phs = double(i)/numSources * 2*M_PI + b*0.01;
+	return Vec3d(cos(phs)*4, sin(i*0.37)*2, sin(phs)*4);
+}
+
+static float sourceSample(int i, int b, int n){
+	return sin((b*numFrames + n) * 0.001 * (i+1));
+}
+
+// Render with SoundSource objects; returns sources/ms
+static double runObjects(int numSources, std::vector<float>& out){
+	SpeakerLayout layout; makeLayout(layout);
+	Vbap vbap(layout);
+	AudioScene scene(numFrames);
+	scene.createListener(&vbap);
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	// allocate sources individually, as an application typically would
+	std::vector<SoundSource *> sources(numSources);
+	for(int i=0; i<numSources; ++i){
+		sources[i] = new SoundSource;
+		scene.addSource(*sources[i]);
+	}
+
+	Timer timer;
+	double sec = 0;
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numSources; ++i){
+			sources[i]->pose().pos(sourcePos(i, b, numSources));
+			for(int n=0; n<numFrames; ++n) sources[i]->writeSample(sourceSample(i, b, n));
+		}
+		io.zeroOut();
+		timer.start();
+		scene.render(io);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+
+	out.assign(io.outBuffer(), io.outBuffer() + io.channelsOut()*numFrames);
+	for(int i=0; i<numSources; ++i) delete sources[i];
+	return numSources * numBlocks / (sec * 1000.);
+}
+
+// Render with SoundSourceArray; returns sources/ms
+static double runArray(int numSources, std::vector<float>& out){
+	SpeakerLayout layout; makeLayout(layout);
+	Vbap vbap(layout);
+	AudioScene scene(numFrames);
+	scene.createListener(&vbap);
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	SoundSourceArray sources(numSources);
+	scene.addSourceArray(sources);
+	std::vector<SoundSourceArray::Handle> handles(numSources);
+	for(int i=0; i<numSources; ++i) handles[i] = sources.add();
+
+	Timer timer;
+	double sec = 0;
+	for(int b=0; b<numBlocks; ++b){
+		for(int i=0; i<numSources; ++i){
+			sources.pos(handles[i], sourcePos(i, b, numSources));
+			for(int n=0; n<numFrames; ++n) sources.writeSample(handles[i], sourceSample(i, b, n));
+		}
+		io.zeroOut();
+		timer.start();
+		scene.render(io, sources);
+		timer.stop();
+		sec += timer.elapsedSec();
+	}
+
+	out.assign(io.outBuffer(), io.outBuffer() + io.channelsOut()*numFrames);
+	return numSources * numBlocks / (sec * 1000.);
+}
+
+int main(){
+	const int counts[] = {64, 256, 1024};
+
+	for(int c=0; c<3; ++c){
+		int numSources = counts[c];
+		std::vector<float> outObjects, outArray;
+		double rateObjects = runObjects(numSources, outObjects);
+		double rateArray = runArray(numSources, outArray);
+
+		double maxDiff = 0;
+		for(unsigned i=0; i<outObjects.size(); ++i){
+			double d = fabs(outObjects[i] - outArray[i]);
+			if(d > maxDiff) maxDiff = d;
+		}
+
+		printf("%4d sources: objects %8.2f, array %8.2f sources/ms (%.2fx), max diff %g\n",
+			numSources, rateObjects, rateArray, rateArray/rateObjects, maxDiff);
+	}
+
+	return 0;
+}
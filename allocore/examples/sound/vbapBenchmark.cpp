@@ -0,0 +1,125 @@
+/*
+Allocore Example: VBAP Benchmark
+
+Description:
+This compares the cost of the per-sample and per-buffer VBAP rendering paths.
+A number of sources circle around a three-ring speaker layout and are panned
+for a fixed number of blocks with each path. The throughput is reported as
+the number of source blocks rendered per millisecond.
+
+A second test has sources jump to random directions every block, defeating
+the cached triplet, and compares the triplet search with the direction lookup
+grid enabled by Vbap::setLookupResolution().
+
+No audio device is started; the AudioIO object only provides the buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "allocore/sound/al_Vbap.hpp"
+#include "allocore/system/al_Time.hpp"
+using namespace al;
+
+static const int numFrames = 256;
+static const int numBlocks = 200;
+
+// Position of source i at block b; sources slowly orbit the listener
+static Vec3d sourcePos(int i, int b, int numSources){
+	double phs = double(i)/numSources * 2*M_PI + b*0.01;
+	double el = sin(i*0.37 + b*0.003) * 0.8;
+	return Vec3d(cos(phs)*cos(el), sin(el), sin(phs)*cos(el)) * 4.;
+}
+
+// Random direction in the upper part of the sphere covered by the layout
+static Vec3d randomPos(){
+	double phs = rand() * (2*M_PI / RAND_MAX);
+	double el = (rand() * (2. / RAND_MAX) - 1.) * 0.8;
+	return Vec3d(cos(phs)*cos(el), sin(el), sin(phs)*cos(el)) * 4.;
+}
+
+// Render blocks with sources at random directions; returns sources/ms
+static double renderRandom(Vbap& vbap, AudioIO& io, std::vector<SoundSource>& sources, float * samples){
+	int numSources = sources.size();
+	std::vector<Vec3d> pos(numSources * numBlocks);
+	srand(1);
+	for(unsigned i=0; i<pos.size(); ++i) pos[i] = randomPos();
+
+	Timer timer;
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		io.zeroOut();
+		for(int s=0; s<numSources; ++s){
+			vbap.perform(io, sources[s], pos[b*numSources + s], numFrames, samples);
+		}
+	}
+	timer.stop();
+	return numSources * numBlocks / (timer.elapsedSec() * 1000.);
+}
+
+int main(int argc, char * argv[]){
+	int numSources = argc > 1 ? atoi(argv[1]) : 150;
+
+	// Rings of 8, 16 and 8 speakers below, at, and above the horizon
+	SpeakerLayout layout;
+	int chan = 0;
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,  -45));
+	for(int i=0; i<16; ++i) layout.addSpeaker(Speaker(chan++, 360./16*i,   0));
+	for(int i=0; i<8;  ++i) layout.addSpeaker(Speaker(chan++, 360./8*i,   45));
+
+	Vbap vbap(layout);
+	AudioScene scene(numFrames);
+	scene.createListener(&vbap);
+
+	AudioIO io(numFrames, 44100, 0, 0, layout.numSpeakers(), 0);
+
+	std::vector<SoundSource> sources(numSources);
+	std::vector<float> samples(numFrames);
+	for(int i=0; i<numFrames; ++i) samples[i] = sin(i*0.1);
+
+	Timer timer;
+
+	// Per-sample path
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		io.zeroOut();
+		for(int s=0; s<numSources; ++s){
+			Vec3d relpos = sourcePos(s, b, numSources);
+			for(int i=0; i<numFrames; ++i){
+				vbap.perform(io, sources[s], relpos, numFrames, i, samples[i]);
+			}
+		}
+	}
+	timer.stop();
+	double perSample = numSources * numBlocks / (timer.elapsedSec() * 1000.);
+
+	// Per-buffer path
+	timer.start();
+	for(int b=0; b<numBlocks; ++b){
+		io.zeroOut();
+		for(int s=0; s<numSources; ++s){
+			Vec3d relpos = sourcePos(s, b, numSources);
+			vbap.perform(io, sources[s], relpos, numFrames, &samples[0]);
+		}
+	}
+	timer.stop();
+	double perBuffer = numSources * numBlocks / (timer.elapsedSec() * 1000.);
+
+	// Random jumps, with and without lookup grid
+	Vbap vbapGrid(layout);
+	vbapGrid.setLookupResolution(72, 36);
+	AudioScene sceneGrid(numFrames);
+	sceneGrid.createListener(&vbapGrid);
+
+	double randSearch = renderRandom(vbap, io, sources, &samples[0]);
+	double randGrid = renderRandom(vbapGrid, io, sources, &samples[0]);
+
+	printf("%d sources, %d speakers, %d frames/block\n", numSources, layout.numSpeakers(), numFrames);
+	printf("per-sample: %10.2f sources/ms\n", perSample);
+	printf("per-buffer: %10.2f sources/ms (%.1fx)\n", perBuffer, perBuffer/perSample);
+	printf("random jumps, search: %10.2f sources/ms\n", randSearch);
+	printf("random jumps, grid:   %10.2f sources/ms (%.1fx, %d bytes)\n",
+		randGrid, randGrid/randSearch, (int)vbapGrid.lookupMemory());
+
+	return 0;
+}
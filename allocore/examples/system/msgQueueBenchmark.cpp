@@ -0,0 +1,60 @@
+/*
+Allocore Example: MsgQueue Benchmark
+
+Description:
+This schedules events at pseudo-random times, so out of order, and then
+dispatches them all, printing the time per event. For comparison, the same
+events are inserted into a sorted linked list walked from its head, which is
+how MsgQueue scheduled messages before it used a heap. The list is only timed
+up to 10^4 events as each insert is O(n).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+static int dispatched = 0;
+void event(al_sec t, int id){ ++dispatched; }
+
+// time of the i-th event, in the next 100 seconds
+static al_sec eventTime(int i){
+	return (unsigned(i) * 2654435761u % 1000000u) * 1e-4;
+}
+
+static double timeQueue(int n){
+	MsgQueue q;
+	Timer timer;
+	timer.start();
+	for(int i=0; i<n; ++i) q.send(eventTime(i), event, i);
+	q.update(100);
+	timer.stop();
+	return timer.elapsedSec();
+}
+
+static double timeList(int n){
+	std::list<al_sec> l;
+	Timer timer;
+	timer.start();
+	for(int i=0; i<n; ++i){
+		al_sec t = eventTime(i);
+		std::list<al_sec>::iterator it = l.begin();
+		while(it != l.end() && *it <= t) ++it;
+		l.insert(it, t);
+	}
+	while(!l.empty()){ event(l.front(), 0); l.pop_front(); }
+	timer.stop();
+	return timer.elapsedSec();
+}
+
+int main(){
+	printf("%8s %16s %16s\n", "events", "MsgQueue", "sorted list");
+	for(int n=1000; n<=1000000; n*=10){
+		printf("%8d %13.3f us", n, timeQueue(n) * 1e6 / n);
+		if(n <= 10000)	printf(" %13.3f us\n", timeList(n) * 1e6 / n);
+		else			printf(" %16s\n", "-");
+	}
+	return 0;
+}
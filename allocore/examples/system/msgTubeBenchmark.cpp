@@ -0,0 +1,92 @@
+/*
+Allocore Example: MsgTube Benchmark
+
+Description:
+This measures how many messages per second 1, 4 and 8 writer threads can pass
+to one reader thread. A MultiMsgTube, where each writer has its own tube, is
+compared to a single MsgTube that the writers take turns at behind a lock.
+The reader executes messages as they arrive, as an audio thread would.
+*/
+
+#include <stdio.h>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+static const int numMsgs = 200000;	// per writer
+
+static Atomic<int> received;
+void recv(al_sec t, int writer, int seq){ received.fetchAdd(1); }
+
+struct Writer{
+	MultiMsgTube * multi;
+	MsgTube * single;
+	Atomic<int> * lock;
+	int id;
+};
+
+// Sends messages through this writer's own tube
+void * sendMulti(void * user){
+	Writer& w = *(Writer *)user;
+	MsgTube * tube = w.multi->producer();
+	for(int i=0; i<numMsgs; ++i){
+		tube->now = i;
+		tube->send(recv, w.id, i);
+	}
+	while(!tube->flush()) al_sleep(0.0001);
+	return NULL;
+}
+
+// Sends messages through the shared tube, holding the lock
+void * sendSingle(void * user){
+	Writer& w = *(Writer *)user;
+	for(int i=0; i<numMsgs; ++i){
+		while(w.lock->exchange(1)) cpuRelax();
+		w.single->now = i;
+		w.single->send(recv, w.id, i);
+		w.lock->store(0);
+	}
+	bool flushed = false;
+	while(!flushed){
+		while(w.lock->exchange(1)) cpuRelax();
+		flushed = w.single->flush();
+		w.lock->store(0);
+		if(!flushed) al_sleep(0.0001);
+	}
+	return NULL;
+}
+
+static double run(int numWriters, bool multi){
+	MultiMsgTube multiTube(numWriters);
+	MsgTube singleTube;
+	Atomic<int> lock;
+	std::vector<Writer> writers(numWriters);
+	std::vector<Thread> threads(numWriters);
+	received.store(0);
+
+	Timer timer;
+	timer.start();
+	for(int i=0; i<numWriters; ++i){
+		Writer w = { &multiTube, &singleTube, &lock, i };
+		writers[i] = w;
+		threads[i].start(multi ? sendMulti : sendSingle, &writers[i]);
+	}
+	while(received.load() < numWriters * numMsgs){
+		if(multi)	multiTube.executeUntil(numMsgs);
+		else		singleTube.executeUntil(numMsgs);
+		al_sleep(0.0001);
+	}
+	for(int i=0; i<numWriters; ++i) threads[i].join();
+	timer.stop();
+	return numWriters * numMsgs / timer.elapsedSec();
+}
+
+int main(){
+	printf("%8s %20s %20s\n", "writers", "MultiMsgTube", "locked MsgTube");
+	int writers[] = {1, 4, 8};
+	for(int i=0; i<3; ++i){
+		printf("%8d %14.2f Mmsg/s %14.2f Mmsg/s\n", writers[i],
+			run(writers[i], true) * 1e-6, run(writers[i], false) * 1e-6);
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+Allocore Example: SingleRWRingBuffer Benchmark
+
+Description:
+This streams blocks of 64 floats from a writer thread to a reader thread
+through a SingleRWRingBuffer and prints the throughput. The blocks are either
+copied in and out with write() and read(), or generated and summed in place
+with acquireWrite()/commitWrite() and acquireRead()/release(). The threads
+should run on separate cores for the numbers to be meaningful.
+*/
+
+#include <stdio.h>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+typedef SingleRWRingBuffer::Span Span;
+
+static const int blockSize = 64 * sizeof(float);
+static const int numBlocks = 1 << 20;		// 256 MB
+
+// Waits for the other thread, spinning briefly before sleeping
+static void wait(int& spins){
+	if(++spins < 1000) cpuRelax();
+	else al_sleep(0.00001);
+}
+
+struct Stream{
+	SingleRWRingBuffer rb;
+	bool inPlace;
+	float sum;
+	Stream(bool inPlace_): rb(1 << 16), inPlace(inPlace_), sum(0){}
+};
+
+static void fill(float * dst, int n, int block){
+	for(int i=0; i<n; ++i) dst[i] = block + i;
+}
+
+static float total(const float * src, int n){
+	float s = 0;
+	for(int i=0; i<n; ++i) s += src[i];
+	return s;
+}
+
+void * writer(void * user){
+	Stream& s = *(Stream *)user;
+	float block[64];
+	Span a, b;
+	for(int k=0; k<numBlocks; ++k){
+		int spins = 0;
+		if(s.inPlace){
+			// blocks evenly divide the buffer, so never wrap
+			while(s.rb.acquireWrite(a, b, blockSize) < blockSize) wait(spins);
+			fill((float *)a.data, 64, k);
+			s.rb.commitWrite(blockSize);
+		}
+		else{
+			fill(block, 64, k);
+			while(s.rb.writeSpace() < blockSize) wait(spins);
+			s.rb.write((const char *)block, blockSize);
+		}
+	}
+	return NULL;
+}
+
+static double run(bool inPlace){
+	Stream s(inPlace);
+	float block[64];
+	Span a, b;
+	Timer timer;
+	timer.start();
+	Thread t(writer, &s);
+	for(int k=0; k<numBlocks; ++k){
+		int spins = 0;
+		if(inPlace){
+			while(s.rb.acquireRead(a, b, blockSize) < blockSize) wait(spins);
+			s.sum += total((const float *)a.data, 64);
+			s.rb.release(blockSize);
+		}
+		else{
+			while(s.rb.readSpace() < blockSize) wait(spins);
+			s.rb.read((char *)block, blockSize);
+			s.sum += total(block, 64);
+		}
+	}
+	t.join();
+	timer.stop();
+	return double(numBlocks) * blockSize / timer.elapsedSec();
+}
+
+int main(){
+	printf("copied:   %7.0f MB/s\n", run(false) * 1e-6);
+	printf("in place: %7.0f MB/s\n", run(true) * 1e-6);
+	return 0;
+}
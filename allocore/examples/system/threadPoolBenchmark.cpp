@@ -0,0 +1,84 @@
+/*
+Allocore Example: ThreadPool Benchmark
+
+Description:
+This times many small parallel steps over an array whose elements take
+uneven amounts of work, the later ones more than the earlier ones. Each step
+is run either by Threads<>, which starts new threads every step and gives each
+an equal sub-interval, or by ThreadPool::parallelFor(), whose persistent
+workers steal sub-ranges from each other. Both use one thread per core.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#include "allocore/al_Allocore.hpp"
+using namespace al;
+
+static const int N = 20000;
+static const int numSteps = 200;
+
+// work for element i grows with i
+static float compute(int i){
+	float s = 0;
+	int n = 1 + i / 200;
+	for(int k=1; k<=n; ++k) s += sinf(i * 0.001f * k) / k;
+	return s;
+}
+
+struct Interval : public ThreadFunction{
+	float * data;
+	int ival[2];
+	void operator()(){
+		for(int i=ival[0]; i<ival[1]; ++i) data[i] = compute(i);
+	}
+};
+
+struct Range{
+	float * data;
+	void operator()(int begin, int end){
+		for(int i=begin; i<end; ++i) data[i] = compute(i);
+	}
+};
+
+static double runThreads(float * data, int numThreads){
+	Timer timer;
+	timer.start();
+	for(int s=0; s<numSteps; ++s){
+		Threads<Interval> threads(numThreads);
+		for(int i=0; i<numThreads; ++i){
+			threads.getInterval(threads.function(i).ival, i, N);
+			threads.function(i).data = data;
+		}
+		threads.start();
+	}
+	timer.stop();
+	return timer.elapsedSec() * 1e3 / numSteps;
+}
+
+static double runPool(float * data, ThreadPool& pool, int grain){
+	Range range = { data };
+	Timer timer;
+	timer.start();
+	for(int s=0; s<numSteps; ++s){
+		pool.parallelFor(0, N, range, grain);
+	}
+	timer.stop();
+	return timer.elapsedSec() * 1e3 / numSteps;
+}
+
+int main(){
+	int cores = numProcessors();
+	std::vector<float> data(N);
+
+	// the calling thread works too, so the pool needs one thread less
+	ThreadPool pool(cores - 1, true);
+
+	printf("%d cores, %d elements, time per step\n", cores, N);
+	printf("Threads<>:                %8.3f ms\n", runThreads(&data[0], cores));
+	printf("ThreadPool, default grain:%8.3f ms\n", runPool(&data[0], pool, 0));
+	printf("ThreadPool, grain 64:     %8.3f ms\n", runPool(&data[0], pool, 64));
+	printf("ThreadPool, grain 4096:   %8.3f ms\n", runPool(&data[0], pool, 4096));
+	return 0;
+}
@@ -3,10 +3,14 @@ find_package(Portaudio QUIET)
 
 set(PORTAUDIO_HEADERS
     allocore/io/al_AudioIO.hpp
+    allocore/io/al_AudioProfiler.hpp
+    allocore/io/al_AudioRenderer.hpp
     allocore/sound/al_Ambisonics.hpp
     allocore/sound/al_AudioScene.hpp
+    allocore/sound/al_Convolver.hpp
     allocore/sound/al_Crossover.hpp
     allocore/sound/al_Dbap.hpp
+    allocore/sound/al_MixMatrix.hpp
     allocore/sound/al_Reverb.hpp
     allocore/sound/al_Speaker.hpp
     allocore/sound/al_Vbap.hpp
@@ -34,6 +38,8 @@ endif()
 
 list(APPEND ALLOCORE_SRC
       src/io/al_AudioIO.cpp
+      src/io/al_AudioProfiler.cpp
+      src/io/al_AudioRenderer.cpp
       src/sound/al_Ambisonics.cpp
 )
 
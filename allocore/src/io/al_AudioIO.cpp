@@ -155,7 +155,13 @@ void AudioDevice::printAll(){
 
 //==============================================================================
 struct AudioIOData::Impl{
-	Impl(): mStream(0), mErrNum(0), mIsOpen(false), mIsRunning(false){}
+	Impl(): mStream(0), mErrNum(0), mIsOpen(false), mIsRunning(false), mFramesProcessed(0){
+		mInParams.device = mOutParams.device = paNoDevice;
+		mInParams.channelCount = mOutParams.channelCount = 0;
+		mInParams.sampleFormat = mOutParams.sampleFormat = paFloat32;
+		mInParams.suggestedLatency = mOutParams.suggestedLatency = 0;
+		mInParams.hostApiSpecificStreamInfo = mOutParams.hostApiSpecificStreamInfo = NULL;
+	}
 
 	bool error() const { return mErrNum != paNoError; }
 
@@ -200,6 +206,7 @@ struct AudioIOData::Impl{
 	mutable PaError mErrNum;			// Most recent error number
 	bool mIsOpen;						// An audio device is open
 	bool mIsRunning;					// An audio stream is running
+	double mFramesProcessed;			// Frames processed with processBuffer()
 };
 
 AudioIOData::AudioIOData(void * userData)
@@ -217,6 +224,7 @@ AudioIOData::~AudioIOData(){
 	deleteBuf(mBufT);
 }
 
+void AudioIOData::zeroIn(){ zero(mBufI, channelsIn() * framesPerBuffer()); }
 void AudioIOData::zeroBus(){ zero(mBufB, framesPerBuffer() * mNumB); }
 void AudioIOData::zeroOut(){ zero(mBufO, channelsOut() * framesPerBuffer()); }
 
@@ -227,7 +235,10 @@ int AudioIOData::channelsInDevice() const { return (int)mImpl->mInParams.channel
 int AudioIOData::channelsOutDevice() const { return (int)mImpl->mOutParams.channelCount; }
 
 double AudioIOData::framesPerSecond() const { return mFramesPerSecond; }
-double AudioIOData::time() const { return Pa_GetStreamTime(mImpl->mStream); }
+double AudioIOData::time() const {
+	if(mImpl->mIsRunning) return Pa_GetStreamTime(mImpl->mStream);
+	return mImpl->mFramesProcessed / framesPerSecond();
+}
 double AudioIOData::time(int frame) const { return (double)frame / framesPerSecond() + time(); }
 int AudioIOData::framesPerBuffer() const { return mFramesPerBuffer; }
 double AudioIOData::secondsPerBuffer() const { return (double)framesPerBuffer() / framesPerSecond(); }
@@ -247,7 +258,7 @@ AudioIO::AudioIO(
 :	AudioIOData(userData),
 	callback(callbackA),
 	mInDevice(AudioDevice::defaultInput()), mOutDevice(AudioDevice::defaultOutput()),
-	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true)
+	mZeroNANs(true), mClipOut(true), mAutoZeroOut(true), mProfiling(false), mNonInterleaved(false)
 {
 	init();
 	this->framesPerBuffer(framesPerBuf);
@@ -265,8 +276,9 @@ AudioIO::~AudioIO(){
 void AudioIO::init(){
 
 	// Choose default devices for now...
-	deviceIn(AudioDevice::defaultInput());
-	deviceOut(AudioDevice::defaultOutput());
+	// (there are none on headless machines, where streams can only be rendered offline)
+	if(mInDevice.valid()) deviceIn(mInDevice);
+	if(mOutDevice.valid()) deviceOut(mOutDevice);
 
 //	inDevice(defaultInDevice());
 //	outDevice(defaultOutDevice());
@@ -312,7 +324,7 @@ void AudioIO::deviceIn(const AudioDevice& v){
 		mImpl->inDevice(v.id());
 		const PaDeviceInfo * dInfo = Pa_GetDeviceInfo(mImpl->mInParams.device);
 		if(dInfo) mImpl->mInParams.suggestedLatency = dInfo->defaultLowInputLatency; // for RT
-		mImpl->mInParams.sampleFormat = paFloat32;// | paNonInterleaved;
+		mImpl->mInParams.sampleFormat = paFloat32;	// paNonInterleaved is added on open()
 		//mInParams.sampleFormat = paInt16;
 		mImpl->mInParams.hostApiSpecificStreamInfo = NULL;
 	}
@@ -327,7 +339,7 @@ void AudioIO::deviceOut(const AudioDevice& v){
 		mImpl->outDevice(v.id());
 		const PaDeviceInfo * dInfo = Pa_GetDeviceInfo(mImpl->mOutParams.device);
 		if(dInfo) mImpl->mOutParams.suggestedLatency = dInfo->defaultLowOutputLatency; // for RT
-		mImpl->mOutParams.sampleFormat = paFloat32;// | paNonInterleaved;
+		mImpl->mOutParams.sampleFormat = paFloat32;	// paNonInterleaved is added on open()
 		mImpl->mOutParams.hostApiSpecificStreamInfo = NULL;
 	}
 	else{
@@ -367,18 +379,14 @@ void AudioIO::channels(int num, bool forOutput){
 		return;
 	}
 
-	const PaDeviceInfo * info = Pa_GetDeviceInfo(params->device);
-	if(0 == info){
-		if(forOutput)	warn("attempt to set number of channels on invalid output device", "AudioIO");
-		else			warn("attempt to set number of channels on invalid input device", "AudioIO");
-		return;	// this particular device is not open, so return
+	// compute number of channels to give PortAudio; without a device, all
+	// channels are virtual
+	const PaDeviceInfo * info = paNoDevice == params->device ? 0 : Pa_GetDeviceInfo(params->device);
+	int maxChans = 0;
+	if(info){
+		maxChans = (int)(forOutput ? info->maxOutputChannels : info->maxInputChannels);
 	}
 
-
-	// compute number of channels to give PortAudio
-	int maxChans =
-		(int)(forOutput ? info->maxOutputChannels : info->maxInputChannels);
-
 	// -1 means open all channels
 	if(num == -1){
 		num = maxChans;
@@ -412,16 +420,27 @@ bool AudioIO::open(){
 		if((paNoDevice ==  inParams->device) || (0 ==  inParams->channelCount)) inParams  = 0;
 		if((paNoDevice == outParams->device) || (0 == outParams->channelCount)) outParams = 0;
 
-		i.mErrNum = Pa_OpenStream(
-			&i.mStream,			// PortAudioStream **
-			inParams,			// PaStreamParameters * in
-			outParams,			// PaStreamParameters * out
-			mFramesPerSecond,	// frames/sec (double)
-			mFramesPerBuffer,	// frames/buffer (unsigned long)
-            paNoFlag,			// paNoFlag, paClipOff, paDitherOff
-			paCallback,			// static callback function (PaStreamCallback *)
-			this
-		);
+		for(int attempt=0; attempt<2; ++attempt){
+			PaSampleFormat format = paFloat32;
+			if(mNonInterleaved) format |= paNonInterleaved;
+			i.mInParams.sampleFormat = i.mOutParams.sampleFormat = format;
+
+			i.mErrNum = Pa_OpenStream(
+				&i.mStream,			// PortAudioStream **
+				inParams,			// PaStreamParameters * in
+				outParams,			// PaStreamParameters * out
+				mFramesPerSecond,	// frames/sec (double)
+				mFramesPerBuffer,	// frames/buffer (unsigned long)
+				paNoFlag,			// paNoFlag, paClipOff, paDitherOff
+				paCallback,			// static callback function (PaStreamCallback *)
+				this
+			);
+
+			// fall back to interleaved buffers if the host API needs them
+			if(paNoError == i.mErrNum || !mNonInterleaved) break;
+			warn("non-interleaved buffers not supported, using interleaved buffers", "AudioIO");
+			mNonInterleaved = false;
+		}
 
 		i.mIsOpen = paNoError == i.mErrNum;
 	}
@@ -441,65 +460,136 @@ int paCallback(
 ){
 	AudioIO& io = *(AudioIO *)userData;
 
-	const float * paI = (const float *)input;
-	float * paO = (float *)output;
+	if(io.profiling() && (statusFlags & (paInputOverflow | paOutputUnderflow))){
+		io.profiler().xrun();
+	}
+
+	io.processDevice(input, output, io.channelsInDevice(), io.channelsOutDevice(), io.nonInterleaved());
+
+	return 0;
+}
+
+
+// Returns whether channel buffers follow each other in memory, as the
+// channels of AudioIOData buffers do
+static bool contiguous(const float * const * bufs, int numChannels, int numFrames){
+	for(int c=1; c<numChannels; ++c){
+		if(bufs[c] != bufs[0] + c*numFrames) return false;
+	}
+	return true;
+}
+
+void AudioIO::processDevice(const void * input, void * output, int inChans, int outChans, bool nonInterleavedBufs){
+
+	const int frames = framesPerBuffer();
+
+	if(!nonInterleavedBufs){
+		deinterleave(mBufI, (const float *)input, frames, inChans);
+		processBuffer();
+		interleave((float *)output, mBufO, frames, outChans);
+		return;
+	}
+
+	const float * const * ins = (const float * const *)input;
+	float * const * outs = (float * const *)output;
+	float * bufI = mBufI;
+	float * bufO = mBufO;
+
+	// Use the device buffers in place if they can stand for all the channels,
+	// otherwise copy them whole
+	if(inChans > 0){
+		if(inChans == channelsIn() && contiguous(ins, inChans, frames)){
+			mBufI = const_cast<float *>(ins[0]);
+		}
+		else{
+			for(int c=0; c<inChans; ++c) memcpy(mBufI + c*frames, ins[c], frames*sizeof(float));
+		}
+	}
+
+	bool direct = outChans > 0 && outChans == channelsOut() && contiguous(outs, outChans, frames);
+	if(direct) mBufO = outs[0];
 
-	bool bDeinterleave = true;
+	processBuffer();
 
-	if(bDeinterleave){
-		deinterleave(const_cast<float *>(&io.in(0,0)),  paI, io.framesPerBuffer(), io.channelsInDevice() );
-		//deinterleave(&io.out(0,0), paO, io.framesPerBuffer(), io.channelsOutDevice());
+	if(!direct){
+		for(int c=0; c<outChans; ++c) memcpy(outs[c], mBufO + c*frames, frames*sizeof(float));
 	}
 
-	if(io.autoZeroOut()) io.zeroOut();
+	mBufI = bufI;
+	mBufO = bufO;
+}
+
+
+void AudioIO::processBuffer(){
+
+	if(mProfiling) mProfiler.beginBlock(secondsPerBuffer());
 
+	if(autoZeroOut()) zeroOut();
 
-	io.processAudio();	// call callback
 
+	processAudio();	// call callback
+
+
+	// Offline streams have no device channels, so all output channels are
+	// treated as if they went to the DAC
+	int chans = mImpl->mIsRunning ? channelsOutDevice() : channelsOut();
 
 	// apply smoothly-ramped gain to all output channels
-	if(io.usingGain()){
+	if(usingGain()){
 
-		float dgain = (io.mGain-io.mGainPrev) / io.framesPerBuffer();
+		float dgain = (mGain-mGainPrev) / framesPerBuffer();
 
-		for(int j=0; j<io.channelsOutDevice(); ++j){
-			float * out = io.outBuffer(j);
-			float gain = io.mGainPrev;
+		for(int j=0; j<chans; ++j){
+			float * out = outBuffer(j);
+			float gain = mGainPrev;
 
-			for(int i=0; i<io.framesPerBuffer(); ++i){
+			for(int i=0; i<framesPerBuffer(); ++i){
 				out[i] *= gain;
 				gain += dgain;
 			}
 		}
 
-		io.mGainPrev = io.mGain;
-	}
-
-	// kill pesky nans so we don't hurt anyone's ears
-	if(io.zeroNANs()){
-		for(int i=0; i<io.framesPerBuffer()*io.channelsOutDevice(); ++i){
-			float& s = (&io.out(0,0))[i];
-			//if(isnan(s)) s = 0.f;
-			if(s != s) s = 0.f; // portable isnan; only nans do not equal themselves
+		mGainPrev = mGain;
+	}
+
+	// kill pesky nans so we don't hurt anyone's ears, and clip; samples are
+	// processed 8 at a time without branches so that the loops vectorize
+	if(zeroNANs() || clipOut()){
+		const bool nans = zeroNANs(), clip = clipOut();
+		const int numSamples = framesPerBuffer()*chans;
+		int i = 0;
+		for(; i+8 <= numSamples; i+=8){
+			float * s = mBufO + i;
+			// portable isnan; only nans do not equal themselves
+			if(nans) for(int k=0; k<8; ++k) s[k] = s[k] != s[k] ? 0.f : s[k];
+			if(clip) for(int k=0; k<8; ++k){
+				float v = s[k] < -1.f ? -1.f : s[k];
+				s[k] = v > 1.f ? 1.f : v;
+			}
 		}
-	}
-
-	if(io.clipOut()){
-		for(int i=0; i<io.framesPerBuffer()*io.channelsOutDevice(); ++i){
-			float& s = (&io.out(0,0))[i];
-			if		(s<-1.f) s =-1.f;
-			else if	(s> 1.f) s = 1.f;
+		for(; i<numSamples; ++i){
+			float& s = mBufO[i];
+			if(nans && s != s) s = 0.f;
+			if(clip){
+				if		(s<-1.f) s =-1.f;
+				else if	(s> 1.f) s = 1.f;
+			}
 		}
 	}
 
-	if(bDeinterleave){
-		interleave(paO, &io.out(0,0), io.framesPerBuffer(), io.channelsOutDevice());
-	}
+	mImpl->mFramesProcessed += framesPerBuffer();
 
-	return 0;
+	if(mProfiling) mProfiler.endBlock();
 }
 
 
+void AudioIO::nonInterleaved(bool v){
+	if(v != mNonInterleaved){
+		mNonInterleaved = v;
+		reopen();
+	}
+}
+
 void AudioIO::reopen(){
 	if(mImpl->mIsRunning)  { close(); start(); }
 	else if(mImpl->mIsOpen){ close(); open(); }
@@ -521,7 +611,9 @@ void AudioIO::resizeBuffer(bool forOutput){
 
 void AudioIO::framesPerSecond(double v){	//printf("AudioIO::fps(%f)\n", v);
 	if(AudioIOData::framesPerSecond() != v){
-		if(!supportsFPS(v)) v = mOutDevice.defaultSampleRate();
+		// without device channels, any rate can be rendered offline
+		bool hasDevice = channelsInDevice() > 0 || channelsOutDevice() > 0;
+		if(hasDevice && !supportsFPS(v)) v = mOutDevice.defaultSampleRate();
 		mFramesPerSecond = v;
 		reopen();
 	}
@@ -581,6 +673,28 @@ void AudioIO::print(){
 
 //void AudioIO::processAudio(){ frame(0); if(callback) callback(*this); }
 void AudioIO::processAudio(){
+	if(mProfiling){
+		// each callback ends where the next one starts, so one clock read
+		// times each callback
+		long long t0 = AudioProfiler::now();
+		frame(0);
+		if(callback){
+			callback(*this);
+			long long t1 = AudioProfiler::now();
+			mProfiler.record(0, t1 - t0);
+			t0 = t1;
+		}
+
+		for(unsigned i=0; i<mAudioCallbacks.size(); ++i){
+			frame(0);
+			mAudioCallbacks[i]->onAudioCB(*this);
+			long long t1 = AudioProfiler::now();
+			mProfiler.record(i+1, t1 - t0);
+			t0 = t1;
+		}
+		return;
+	}
+
 	frame(0);
 	if(callback) callback(*this);
 
@@ -0,0 +1,149 @@
+#include <math.h>
+
+#include "allocore/io/al_AudioProfiler.hpp"
+
+#if defined(AL_WINDOWS)
+	#include <windows.h>
+#elif defined(AL_OSX)
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+namespace al{
+
+long long AudioProfiler::now(){
+#if defined(AL_WINDOWS)
+	static LARGE_INTEGER freq = { 0 };
+	if(0 == freq.QuadPart) QueryPerformanceFrequency(&freq);
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return (long long)(t.QuadPart * (1e9 / freq.QuadPart));
+#elif defined(AL_OSX)
+	static mach_timebase_info_data_t base = { 0, 0 };
+	if(0 == base.denom) mach_timebase_info(&base);
+	return (long long)(mach_absolute_time() * base.numer / base.denom);
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+#endif
+}
+
+double AudioProfiler::binTime(int bin){
+	return pow(2., bin * 0.5) * 1e-6;
+}
+
+double AudioProfiler::Stats::percentileSec(double fraction) const {
+	int target = (int)ceil(fraction * count);
+	int sum = 0;
+	for(int i=0; i<NUM_BINS-1; ++i){
+		sum += bins[i];
+		if(sum >= target){
+			double t = binTime(i+1);
+			return t < maxSec ? t : maxSec;
+		}
+	}
+	return maxSec;
+}
+
+
+AudioProfiler::AudioProfiler()
+:	mBlockStart(0), mPrevBlockStart(0), mDeadline(0)
+{
+	for(int i=0; i<NUM_SLOTS; ++i) clear(mSlots[i]);
+	clear(mBlock);
+}
+
+void AudioProfiler::clear(Counters& c){
+	c.count.store(0);
+	c.maxNsec.store(0);
+	c.sumNsec.store(0);
+	for(int i=0; i<NUM_BINS; ++i) c.bins[i].store(0);
+}
+
+// Only the audio thread writes, so read-modify-writes need not be atomic
+void AudioProfiler::add(Counters& c, long long nsec){
+	if(nsec < 0) nsec = 0;
+	int bin = 0;
+	if(nsec >= 1000){
+		int e;
+		double m = frexp(nsec * 1e-3, &e);	// microseconds = m 2^e, m in [0.5, 1)
+		bin = 2*(e-1) + (m >= M_SQRT1_2 ? 1 : 0);
+		if(bin >= NUM_BINS) bin = NUM_BINS-1;
+	}
+	c.bins[bin].store(c.bins[bin].load() + 1);
+	c.sumNsec.store(c.sumNsec.load() + nsec);
+	if(nsec > c.maxNsec.load()) c.maxNsec.store(nsec < 0x7FFFFFFF ? (int)nsec : 0x7FFFFFFF);
+	c.count.store(c.count.load() + 1);
+}
+
+AudioProfiler::Stats AudioProfiler::get(const Counters& c){
+	Stats s;
+	s.count = c.count.load();
+	s.meanSec = s.count ? c.sumNsec.load() * 1e-9 / s.count : 0;
+	s.maxSec = c.maxNsec.load() * 1e-9;
+	for(int i=0; i<NUM_BINS; ++i) s.bins[i] = c.bins[i].load();
+	return s;
+}
+
+void AudioProfiler::beginBlock(double deadlineSec){
+	if(mResetRequest.load()){
+		for(int i=0; i<NUM_SLOTS; ++i) clear(mSlots[i]);
+		clear(mBlock);
+		mNumSlots.store(0);
+		mDeadlineMisses.store(0);
+		mXruns.store(0);
+		mMaxInterval.store(0);
+		mMaxLoad.store(0);
+		mPrevBlockStart = 0;
+		mResetRequest.store(0);
+	}
+	mDeadline = (long long)(deadlineSec * 1e9);
+	mBlockStart = now();
+	if(mPrevBlockStart){
+		long long interval = mBlockStart - mPrevBlockStart;
+		if(interval > mMaxInterval.load()){
+			mMaxInterval.store(interval < 0x7FFFFFFF ? (int)interval : 0x7FFFFFFF);
+		}
+	}
+	mPrevBlockStart = mBlockStart;
+}
+
+void AudioProfiler::record(int slot, long long nsec){
+	if(slot >= NUM_SLOTS) slot = NUM_SLOTS-1;
+	if(slot >= mNumSlots.load()) mNumSlots.store(slot+1);
+	add(mSlots[slot], nsec);
+}
+
+void AudioProfiler::endBlock(){
+	long long nsec = now() - mBlockStart;
+	add(mBlock, nsec);
+	if(mDeadline > 0){
+		if(nsec > mDeadline) mDeadlineMisses.store(mDeadlineMisses.load() + 1);
+		int load = (int)(1e6 * nsec / mDeadline);
+		if(load > mMaxLoad.load()) mMaxLoad.store(load);
+	}
+}
+
+AudioProfiler::Stats AudioProfiler::stats(int slot) const { return get(mSlots[slot]); }
+AudioProfiler::Stats AudioProfiler::blockStats() const { return get(mBlock); }
+
+static void printStats(FILE * fp, const char * name, const AudioProfiler::Stats& s){
+	fprintf(fp, "%-10s %10d %10.1f %10.1f %10.1f\n", name, s.count,
+		s.meanSec * 1e6, s.percentileSec(0.99) * 1e6, s.maxSec * 1e6);
+}
+
+void AudioProfiler::print(FILE * fp) const {
+	fprintf(fp, "blocks: %d, deadline misses: %d, xruns: %d, max load: %.0f%%, max interval: %.1f ms\n",
+		blocks(), deadlineMisses(), xruns(), maxLoad() * 100, maxIntervalSec() * 1e3);
+	fprintf(fp, "%-10s %10s %10s %10s %10s\n", "", "count", "mean us", "p99 us", "max us");
+	printStats(fp, "block", blockStats());
+	for(int i=0; i<numSlots(); ++i){
+		char name[16];
+		snprintf(name, sizeof(name), "slot %d", i);
+		printStats(fp, name, stats(i));
+	}
+}
+
+} // al::
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocore/io/al_AudioRenderer.hpp"
+#include "allocore/system/al_Thread.hpp"
+#include "allocore/system/al_Time.hpp"
+
+namespace al{
+
+static void warn(const char * msg, const std::string& path){
+	fprintf(stderr, "AudioRenderer warning: %s %s\n", msg, path.c_str());
+}
+
+static bool bigEndian(){
+	int one = 1;
+	return 0 == *(char *)&one;
+}
+
+// Writes unsigned integers to a byte buffer, least significant byte first
+static unsigned char * putLE(unsigned char * dst, unsigned long long v, int bytes){
+	for(int i=0; i<bytes; ++i){
+		*dst++ = (unsigned char)(v >> (8*i));
+	}
+	return dst;
+}
+
+static unsigned char * putID(unsigned char * dst, const char * id){
+	memcpy(dst, id, 4);
+	return dst + 4;
+}
+
+// Writes the header of a 32-bit float WAV file. Files with more than 4 GB of
+// samples are written as RF64 (EBU Tech 3306), as WAV sizes are 32-bit.
+static bool writeWAVHeader(FILE * fp, int numChans, double fps, long long numFrames){
+	unsigned long long dataBytes = (unsigned long long)numFrames * numChans * 4;
+	bool rf64 = dataBytes > 0xFFFFFFFFULL - 128;
+
+	unsigned char header[128];
+	unsigned char * p = header;
+	unsigned long long riffBytes = 4 + 26 + 12 + 8 + dataBytes + (rf64 ? 36 : 0);
+
+	p = putID(p, rf64 ? "RF64" : "RIFF");
+	p = putLE(p, rf64 ? 0xFFFFFFFFULL : riffBytes, 4);
+	p = putID(p, "WAVE");
+	if(rf64){
+		p = putID(p, "ds64");
+		p = putLE(p, 28, 4);
+		p = putLE(p, riffBytes, 8);
+		p = putLE(p, dataBytes, 8);
+		p = putLE(p, numFrames, 8);
+		p = putLE(p, 0, 4);				// table length
+	}
+	p = putID(p, "fmt ");
+	p = putLE(p, 18, 4);
+	p = putLE(p, 3, 2);					// WAVE_FORMAT_IEEE_FLOAT
+	p = putLE(p, numChans, 2);
+	p = putLE(p, (unsigned long long)(fps + 0.5), 4);
+	p = putLE(p, (unsigned long long)(fps + 0.5) * numChans * 4, 4);
+	p = putLE(p, numChans * 4, 2);		// block align
+	p = putLE(p, 32, 2);				// bits/sample
+	p = putLE(p, 0, 2);					// extension size
+	p = putID(p, "fact");
+	p = putLE(p, 4, 4);
+	p = putLE(p, rf64 ? 0xFFFFFFFFULL : numFrames, 4);
+	p = putID(p, "data");
+	p = putLE(p, rf64 ? 0xFFFFFFFFULL : dataBytes, 4);
+
+	return fwrite(header, p - header, 1, fp) == 1;
+}
+
+
+AudioRenderer::AudioRenderer(int numThreadsA)
+:	mSecondsRendered(0), mSecondsElapsed(0)
+{
+	numThreads(numThreadsA);
+}
+
+AudioRenderer::~AudioRenderer(){}
+
+AudioRenderer& AudioRenderer::add(AudioIO& io, int numFrames, float * dst){
+	Job job = { &io, numFrames, dst, "", false };
+	mJobs.push_back(job);
+	return *this;
+}
+
+AudioRenderer& AudioRenderer::add(AudioIO& io, int numFrames, const std::string& path){
+	Job job = { &io, numFrames, 0, path, false };
+	mJobs.push_back(job);
+	return *this;
+}
+
+AudioRenderer& AudioRenderer::clear(){
+	mJobs.clear();
+	return *this;
+}
+
+double AudioRenderer::realTimeFactor() const {
+	return mSecondsElapsed > 0 ? mSecondsRendered / mSecondsElapsed : 0;
+}
+
+bool AudioRenderer::render(Job& job){
+	AudioIO& io = *job.io;
+	const int framesPerBuf = io.framesPerBuffer();
+	const int chans = io.channelsOut();
+
+	FILE * fp = 0;
+	std::vector<float> interleaved;
+	if(0 == job.dst){
+		fp = fopen(job.path.c_str(), "wb");
+		if(0 == fp){
+			warn("could not open", job.path);
+			return false;
+		}
+		if(!writeWAVHeader(fp, chans, io.framesPerSecond(), job.numFrames)){
+			warn("could not write", job.path);
+			fclose(fp);
+			return false;
+		}
+		interleaved.resize(framesPerBuf * chans);
+	}
+	bool swap = bigEndian();
+	bool ok = true;
+
+	io.zeroIn();
+
+	for(int frame=0; frame < job.numFrames && ok; frame += framesPerBuf){
+		int n = job.numFrames - frame;
+		if(n > framesPerBuf) n = framesPerBuf;
+
+		io.processBuffer();
+
+		if(job.dst){
+			for(int c=0; c<chans; ++c){
+				memcpy(job.dst + c*job.numFrames + frame, io.outBuffer(c), n*sizeof(float));
+			}
+		}
+		else{
+			for(int c=0; c<chans; ++c){
+				const float * src = io.outBuffer(c);
+				float * dst = &interleaved[c];
+				for(int i=0; i<n; ++i){
+					dst[i*chans] = src[i];
+				}
+			}
+			if(swap){
+				unsigned char * b = (unsigned char *)&interleaved[0];
+				for(int i=0; i<n*chans*4; i+=4){
+					unsigned char t;
+					t = b[i]; b[i] = b[i+3]; b[i+3] = t;
+					t = b[i+1]; b[i+1] = b[i+2]; b[i+2] = t;
+				}
+			}
+			if(n*chans > 0 && fwrite(&interleaved[0], sizeof(float)*chans, n, fp) != (size_t)n){
+				warn("could not write", job.path);
+				ok = false;
+			}
+		}
+	}
+
+	if(fp && 0 != fclose(fp)) ok = false;
+	return ok;
+}
+
+void * AudioRenderer::worker(void * user){
+	AudioRenderer& r = *static_cast<AudioRenderer *>(user);
+	int i;
+	while((i = r.mNextJob.fetchAdd(1)) < r.numJobs()){
+		r.mJobs[i].ok = render(r.mJobs[i]);
+	}
+	return 0;
+}
+
+bool AudioRenderer::run(){
+	Timer timer;
+	timer.start();
+
+	mNextJob.store(0);
+	int threads = numThreads() < numJobs() ? numThreads() : numJobs();
+	if(threads <= 1){
+		worker(this);
+	}
+	else{
+		std::vector<Thread> workers(threads - 1);
+		for(unsigned t=0; t<workers.size(); ++t){
+			workers[t].start(worker, this);
+		}
+		worker(this);
+		for(unsigned t=0; t<workers.size(); ++t){
+			workers[t].join();
+		}
+	}
+
+	timer.stop();
+	mSecondsElapsed = timer.elapsedSec();
+
+	bool ok = true;
+	mSecondsRendered = 0;
+	for(unsigned i=0; i<mJobs.size(); ++i){
+		ok &= mJobs[i].ok;
+		mSecondsRendered += mJobs[i].numFrames / mJobs[i].io->framesPerSecond();
+	}
+	return ok;
+}
+
+} // al::
@@ -192,7 +192,7 @@ float AmbiDecode::flavorWeights[4][5][5] = {
 
 AmbiDecode::AmbiDecode(int dim, int order, int numSpeakers, int flav)
 	: AmbiBase(dim, order),
-	mNumSpeakers(0), mDecodeMatrix(0)
+	mNumSpeakers(0), mDecodeMatrix(0), mSpeakers(0), mFrozenStride(0), mFrozen(false), mNFCSectionsPerRow(0)
 {
 	resizeArrays(channels(), numSpeakers);
 	flavor(flav);
@@ -205,6 +205,11 @@ AmbiDecode::~AmbiDecode(){
 
 void AmbiDecode::decode(float * dec, const float * ambi, int numDecFrames) const {
 
+	if(mFrozen){
+		decodeFrozen(dec, ambi, numDecFrames);
+		return;
+	}
+
 	// iterate speakers
 	for(int s=0; s<numSpeakers(); ++s){
 		// skip zero-amp speakers:
@@ -221,6 +226,174 @@ void AmbiDecode::decode(float * dec, const float * ambi, int numDecFrames) const
 	}
 }
 
+void AmbiDecode::decodeFrozen(float * dec, const float * ambi, int numDecFrames) const {
+
+	const int chans = channels();
+	const int rows = mFrozenSpeakers.size();
+	const int nfcOrder = order() < kMaxNFCOrder ? order() : kMaxNFCOrder;
+
+	// iterate groups of speakers
+	for(int r=0; r<rows; r+=kLanes){
+		const float * w0 = &mFrozenMatrix[(r  )*mFrozenStride];
+		const float * w1 = &mFrozenMatrix[(r+1)*mFrozenStride];
+		const float * w2 = &mFrozenMatrix[(r+2)*mFrozenStride];
+		const float * w3 = &mFrozenMatrix[(r+3)*mFrozenStride];
+
+		// orders are decoded separately only if a speaker is compensated
+		bool nfc = false;
+		for(int k=0; k<kLanes && r+k<rows && nfcOrder>0; ++k){
+			if(mNFCCutoffs[mFrozenSpeakers[r+k]] != 0.f) nfc = true;
+		}
+		const int numAcc = nfc ? nfcOrder : 1;
+
+		// iterate tiles of frames
+		for(int i0=0; i0<numDecFrames; i0+=kTile){
+			const int n = numDecFrames-i0 < kTile ? numDecFrames-i0 : kTile;
+			float acc[kMaxNFCOrder][kLanes][kTile];
+			memset(acc, 0, numAcc * sizeof(acc[0]));
+
+			// directional channels, into the accumulators of their orders
+			for(int c=1; c<chans; ++c){
+				const float * in = ambi + c * numDecFrames + i0;
+				const int o = mChannelOrders[c] < numAcc ? mChannelOrders[c] : numAcc;
+				float (* a)[kTile] = acc[o-1];
+				const float g0 = w0[c], g1 = w1[c], g2 = w2[c], g3 = w3[c];
+				for(int i=0; i<n; ++i){
+					const float x = in[i];
+					a[0][i] += x * g0;
+					a[1][i] += x * g1;
+					a[2][i] += x * g2;
+					a[3][i] += x * g3;
+				}
+			}
+
+			// omni channel and output, skipping padded rows
+			const float * in = ambi + i0;
+			for(int k=0; k<kLanes && r+k<rows; ++k){
+				const int spk = mFrozenSpeakers[r+k];
+				float * a = acc[0][k];
+
+				if(nfc){
+					if(mNFCCutoffs[spk] != 0.f){
+						// filter each order by its sections
+						const NFCSection * sec = &mNFCSections[(r+k)*mNFCSectionsPerRow];
+						float * state = &mNFCStates[(r+k)*mNFCSectionsPerRow*2];
+						for(int o=1; o<=numAcc; ++o){
+							float * ao = acc[o-1][k];
+							for(int j=0; j<(o+1)/2; ++j, ++sec, state+=2){
+								const NFCSection& f = *sec;
+								float s1 = state[0], s2 = state[1];
+								for(int i=0; i<n; ++i){
+									const float x = ao[i];
+									const float y = f.b0 * x + s1;
+									s1 = f.b1 * x - f.a1 * y + s2;
+									s2 = f.b2 * x - f.a2 * y;
+									ao[i] = y;
+								}
+								state[0] = s1; state[1] = s2;
+							}
+						}
+					}
+					for(int o=1; o<numAcc; ++o){
+						const float * ao = acc[o][k];
+						for(int i=0; i<n; ++i) a[i] += ao[i];
+					}
+				}
+
+				float * out = dec + (*mSpeakers)[spk].deviceChannel * numDecFrames + i0;
+				const float g = mFrozenMatrix[(r+k)*mFrozenStride];
+				for(int i=0; i<n; ++i) out[i] += a[i] + in[i] * g;
+			}
+		}
+	}
+}
+
+// Factors of the analog near-field filter denominators of orders 1 to 3,
+// the reverse Bessel polynomials in s/w: s + p w if q is 0, otherwise
+// s^2 + p w s + q w^2. The numerator of order m is s^m.
+static const struct { int order; double p, q; } nfcFactors[] = {
+	{1, 1., 0.},
+	{2, 3., 3.},
+	{3, 2.32218535, 0.}, {3, 3.67781465, 6.45943347}
+};
+
+void AmbiDecode::freeze(bool v){
+	mFrozen = v;
+	if(!v || !mSpeakers) return;
+
+	mFrozenSpeakers.clear();
+	for(int s=0; s<numSpeakers() && s<int(mSpeakers->size()); ++s){
+		if((*mSpeakers)[s].gain != 0.) mFrozenSpeakers.push_back(s);
+	}
+
+	const int rows = mFrozenSpeakers.size();
+	const int paddedRows = (rows + kLanes-1) / kLanes * kLanes;
+	mFrozenStride = (channels() + kLanes-1) / kLanes * kLanes;
+	mFrozenMatrix.assign(paddedRows * mFrozenStride, 0.f);
+
+	for(int r=0; r<rows; ++r){
+		for(int c=0; c<channels(); ++c){
+			mFrozenMatrix[r*mFrozenStride + c] = decodeWeight(mFrozenSpeakers[r], c);
+		}
+	}
+
+	// order of each channel, in the layout of updateChanWeights()
+	mChannelOrders.assign(channels(), 0);
+	int c = 1;
+	for(int m=1; m<=order(); ++m){
+		mChannelOrders[c++] = m;
+		mChannelOrders[c++] = m;
+	}
+	if(3 == mDim){
+		for(int m=1; m<=order(); ++m){
+			for(int j=0; j<2*m-1; ++j) mChannelOrders[c++] = m;
+		}
+	}
+
+	// near-field filter sections of each row
+	mNFCSectionsPerRow = 0;
+	for(unsigned i=0; i<sizeof(nfcFactors)/sizeof(nfcFactors[0]); ++i){
+		if(nfcFactors[i].order <= order()) ++mNFCSectionsPerRow;
+	}
+	mNFCSections.resize(rows * mNFCSectionsPerRow);
+	mNFCStates.assign(rows * mNFCSectionsPerRow * 2, 0.f);
+	for(int r=0; r<rows; ++r) updateNFCSections(r);
+}
+
+// Digitize the near-field filters of a row by matching poles and zeros,
+// normalized to unity gain at the Nyquist frequency
+void AmbiDecode::updateNFCSections(int row){
+	const double w = mNFCCutoffs[mFrozenSpeakers[row]];
+	NFCSection * sec = &mNFCSections[row * mNFCSectionsPerRow];
+	for(int i=0; i<mNFCSectionsPerRow; ++i){
+		const double p = nfcFactors[i].p, q = nfcFactors[i].q;
+		NFCSection& f = sec[i];
+		if(q == 0.){
+			const double pole = exp(-p * w);
+			const double g = (1. + pole) * 0.5;
+			f.b0 = g; f.b1 = -g; f.b2 = 0.f;
+			f.a1 = -pole; f.a2 = 0.f;
+		}
+		else{
+			const double radius = exp(-0.5 * p * w);
+			const double theta = sqrt(q - 0.25 * p * p) * w;
+			const double a1 = -2. * radius * cos(theta), a2 = radius * radius;
+			const double g = (1. - a1 + a2) * 0.25;
+			f.b0 = g; f.b1 = -2. * g; f.b2 = g;
+			f.a1 = a1; f.a2 = a2;
+		}
+	}
+}
+
+void AmbiDecode::nearFieldCompensation(int index, float distance, double sampleRate){
+	if(index < 0 || index >= int(mNFCCutoffs.size())) return;
+	mNFCCutoffs[index] = distance > 0.f ? 343. / (distance * sampleRate) : 0.f;
+	if(mFrozen){
+		for(unsigned r=0; r<mFrozenSpeakers.size(); ++r){
+			if(mFrozenSpeakers[r] == index) updateNFCSections(r);
+		}
+	}
+}
 
 void AmbiDecode::flavor(int type){
 	if(type < 4){
@@ -228,6 +401,7 @@ void AmbiDecode::flavor(int type){
 		const int No = sizeof(mWOrder)/sizeof(mWOrder[0]);
 		for(int i=0; i<No; ++i) mWOrder[i] = flavorWeights[flavor()][i][order()];
 		updateChanWeights();
+		if(mFrozen) freeze();
 	}
 }
 
@@ -252,6 +426,8 @@ void AmbiDecode::setSpeakerRadians(int index, int deviceChannel, float az, float
 	for (int i=0; i<channels(); i++) {
 		mDecodeMatrix[index * channels() + i] *= amp;
 	}
+
+	if(mFrozen) freeze();
 }
 
 void AmbiDecode::setSpeaker(int index, int deviceChannel, float az, float el, float amp){
@@ -318,6 +494,8 @@ void AmbiDecode::resizeArrays(int numChannels, int numSpeakers){
 	}
 
 	mChannels = numChannels;
+	mNFCCutoffs.resize(numSpeakers, 0.f);
+	if(mFrozen) freeze();
 }
 
 void AmbiDecode::onChannelsChange(){
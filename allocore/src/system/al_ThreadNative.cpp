@@ -7,6 +7,16 @@
 	#define USE_THREADEX
 #else
 	#define USE_PTHREAD
+	#include <errno.h>
+	#include <sched.h>
+	#include <sys/time.h>
+#endif
+
+#ifdef AL_OSX
+	#include <mach/mach.h>
+	#include <mach/thread_policy.h>
+#elif defined(USE_PTHREAD)
+	#include <semaphore.h>
 #endif
 
 namespace al {
@@ -20,7 +30,7 @@ namespace al {
 
 struct Thread::Impl{
 	Impl()
-	:	mHandle(0)
+	:	mHandle(0), mAffinity(-1)
 	{ //printf("Thread::Impl(): %p\n", this);
 		pthread_attr_init(&mAttr);
 
@@ -36,7 +46,23 @@ struct Thread::Impl{
 	bool start(ThreadFunction& func){
 		if(mHandle) return false;
 		//return 0 == pthread_create(&mHandle, NULL, cThreadFunc, &func);
-		return 0 == pthread_create(&mHandle, &mAttr, cThreadFunc, &func);
+		if(0 != pthread_create(&mHandle, &mAttr, cThreadFunc, &func)) return false;
+		if(mAffinity >= 0) setAffinity();
+		return true;
+	}
+
+	void setAffinity(){
+		#if defined(AL_LINUX)
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(mAffinity, &cpus);
+			pthread_setaffinity_np(mHandle, sizeof(cpus), &cpus);
+		#elif defined(AL_OSX)
+			// threads with different tags are put on different cores
+			thread_affinity_policy_data_t policy = { mAffinity + 1 };
+			thread_policy_set(pthread_mach_thread_np(mHandle), THREAD_AFFINITY_POLICY,
+				(thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+		#endif
 	}
 
 	bool join(){
@@ -75,6 +101,7 @@ struct Thread::Impl{
 
 	pthread_t mHandle;
 	pthread_attr_t mAttr;
+	int mAffinity;
 
 	static void * cThreadFunc(void * user){
 		ThreadFunction& tfunc = *((ThreadFunction*)user);
@@ -91,6 +118,76 @@ void * Thread::current(){
 	return (void*)(&r);
 }
 
+void Thread::yield(){
+	sched_yield();
+}
+
+
+class Condition::Impl{
+public:
+	Impl(){
+		pthread_mutex_init(&mMutex, NULL);
+		pthread_cond_init(&mCond, NULL);
+	}
+
+	~Impl(){
+		pthread_cond_destroy(&mCond);
+		pthread_mutex_destroy(&mMutex);
+	}
+
+	void lock(){ pthread_mutex_lock(&mMutex); }
+	void unlock(){ pthread_mutex_unlock(&mMutex); }
+	void wait(){ pthread_cond_wait(&mCond, &mMutex); }
+
+	bool wait(double seconds){
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		double t = now.tv_sec + now.tv_usec * 1e-6 + seconds;
+		struct timespec until;
+		until.tv_sec = time_t(t);
+		until.tv_nsec = long((t - until.tv_sec) * 1e9);
+		return pthread_cond_timedwait(&mCond, &mMutex, &until) != ETIMEDOUT;
+	}
+
+	void signal(bool all){
+		if(all)	pthread_cond_broadcast(&mCond);
+		else	pthread_cond_signal(&mCond);
+	}
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mCond;
+};
+
+
+#ifdef AL_OSX
+// OS X does not implement unnamed POSIX semaphores
+class Semaphore::Impl{
+public:
+	Impl(unsigned count){
+		semaphore_create(mach_task_self(), &mSem, SYNC_POLICY_FIFO, count);
+	}
+
+	~Impl(){ semaphore_destroy(mach_task_self(), mSem); }
+
+	void post(){ semaphore_signal(mSem); }
+	void wait(){ while(semaphore_wait(mSem) == KERN_ABORTED){} }
+
+	semaphore_t mSem;
+};
+
+#else
+class Semaphore::Impl{
+public:
+	Impl(unsigned count){ sem_init(&mSem, 0, count); }
+	~Impl(){ sem_destroy(&mSem); }
+
+	void post(){ sem_post(&mSem); }
+	void wait(){ while(sem_wait(&mSem) != 0 && errno == EINTR){} }
+
+	sem_t mSem;
+};
+#endif
+
 
 #elif defined(USE_THREADEX)
 
@@ -103,13 +200,16 @@ void * Thread::current(){
 //#define THREAD_FUNCTION(name) unsigned _stdcall * name(void * user)
 
 struct Thread::Impl{
-	Impl(): mHandle(0){}
+	Impl(): mHandle(0), mAffinity(-1){}
 
 	bool start(ThreadFunction& func){
 		if(mHandle) return false;
 		unsigned thread_id;
 		mHandle = _beginthreadex(NULL, 0, cThreadFunc, &func, 0, &thread_id);
-		if(mHandle) return true;
+		if(mHandle){
+			if(mAffinity >= 0) SetThreadAffinityMask((HANDLE)mHandle, DWORD_PTR(1) << mAffinity);
+			return true;
+		}
 		return false;
 	}
 
@@ -136,6 +236,7 @@ struct Thread::Impl{
 //	}
 
 	unsigned long mHandle;
+	int mAffinity;
 //	ThreadFunction mRoutine;
 
 	static unsigned _stdcall cThreadFunc(void * user){
@@ -145,6 +246,49 @@ struct Thread::Impl{
 	}
 };
 
+void Thread::yield(){
+	SwitchToThread();
+}
+
+
+class Condition::Impl{
+public:
+	Impl(){
+		InitializeCriticalSection(&mMutex);
+		InitializeConditionVariable(&mCond);
+	}
+
+	~Impl(){ DeleteCriticalSection(&mMutex); }
+
+	void lock(){ EnterCriticalSection(&mMutex); }
+	void unlock(){ LeaveCriticalSection(&mMutex); }
+	void wait(){ SleepConditionVariableCS(&mCond, &mMutex, INFINITE); }
+
+	bool wait(double seconds){
+		return SleepConditionVariableCS(&mCond, &mMutex, DWORD(seconds * 1000. + 0.5)) != 0;
+	}
+
+	void signal(bool all){
+		if(all)	WakeAllConditionVariable(&mCond);
+		else	WakeConditionVariable(&mCond);
+	}
+
+	CRITICAL_SECTION mMutex;
+	CONDITION_VARIABLE mCond;
+};
+
+
+class Semaphore::Impl{
+public:
+	Impl(unsigned count){ mSem = CreateSemaphore(NULL, count, 0x7fffffff, NULL); }
+	~Impl(){ CloseHandle(mSem); }
+
+	void post(){ ReleaseSemaphore(mSem, 1, NULL); }
+	void wait(){ WaitForSingleObject(mSem, INFINITE); }
+
+	HANDLE mSem;
+};
+
 #endif
 
 
@@ -209,6 +353,11 @@ Thread& Thread::priority(int v){
 	return *this;
 }
 
+Thread& Thread::affinity(int core){
+	mImpl->mAffinity = core;
+	return *this;
+}
+
 bool Thread::start(ThreadFunction& func){
 	return mImpl->start(func);
 }
@@ -217,4 +366,32 @@ bool Thread::join(){
 	return mImpl->join();
 }
 
+
+Condition::Condition(): mImpl(new Impl){}
+
+Condition::~Condition(){ delete mImpl; }
+
+void Condition::lock(){ mImpl->lock(); }
+
+void Condition::unlock(){ mImpl->unlock(); }
+
+void Condition::wait(){ mImpl->wait(); }
+
+bool Condition::wait(double seconds){ return mImpl->wait(seconds); }
+
+void Condition::signal(bool all){
+	mImpl->lock();
+	mImpl->signal(all);
+	mImpl->unlock();
+}
+
+
+Semaphore::Semaphore(unsigned count): mImpl(new Impl(count)){}
+
+Semaphore::~Semaphore(){ delete mImpl; }
+
+void Semaphore::post(){ mImpl->post(); }
+
+void Semaphore::wait(){ mImpl->wait(); }
+
 } // al::
@@ -0,0 +1,272 @@
+#include "allocore/system/al_Config.h"
+#include "allocore/system/al_Info.hpp"
+#include "allocore/system/al_ThreadPool.hpp"
+#include "allocore/types/al_ObjectQueue.hpp"
+
+#ifdef AL_WINDOWS
+	#define AL_THREAD_LOCAL __declspec(thread)
+#else
+	#define AL_THREAD_LOCAL __thread
+#endif
+
+namespace al{
+
+// Worker of the calling thread, if it is one
+static AL_THREAD_LOCAL void * tlsWorker = 0;
+
+
+// Chase-Lev work-stealing deque of fixed capacity. The owner pushes and pops
+// at the bottom, thieves steal from the top.
+class TaskDeque{
+public:
+	typedef ThreadPool::Task Task;
+	enum{ CAPACITY = 1024, MASK = CAPACITY-1 };
+
+	TaskDeque(): mTop(0), mBottom(0){}
+
+	// Owner only; returns false if full
+	bool push(Task * task){
+		size_t b = mBottom.load();
+		size_t t = mTop.load();
+		if(b - t >= CAPACITY) return false;
+		mTasks[b & MASK].store(task);
+		mBottom.store(b + 1);
+		return true;
+	}
+
+	// Owner only; takes the newest task
+	Task * pop(){
+		size_t b = mBottom.load() - 1;
+		mBottom.store(b);
+		memoryFence();
+		size_t t = mTop.load();
+		ptrdiff_t n = ptrdiff_t(b - t);
+		if(n < 0){
+			mBottom.store(b + 1);
+			return 0;
+		}
+		Task * task = mTasks[b & MASK].load();
+		if(n > 0) return task;
+		// last task; a thief may be taking it too
+		if(!mTop.compareExchange(t, t + 1)) task = 0;
+		mBottom.store(b + 1);
+		return task;
+	}
+
+	// Any thread; takes the oldest task
+	Task * steal(){
+		size_t t = mTop.load();
+		memoryFence();
+		size_t b = mBottom.load();
+		if(ptrdiff_t(b - t) <= 0) return 0;
+		Task * task = mTasks[t & MASK].load();
+		if(!mTop.compareExchange(t, t + 1)) return 0;
+		return task;
+	}
+
+	bool empty() const {
+		return ptrdiff_t(mBottom.load() - mTop.load()) <= 0;
+	}
+
+private:
+	Atomic<size_t> mTop;
+	char mPad0[AL_CACHE_LINE_SIZE];
+	Atomic<size_t> mBottom;
+	char mPad1[AL_CACHE_LINE_SIZE];
+	Atomic<Task *> mTasks[CAPACITY];
+};
+
+
+// Shared queue and the sleeping of idle workers
+class ThreadPool::Impl{
+public:
+	ObjectQueue<Task *> shared;
+	Condition idle;
+	Atomic<int> sleeping;
+	Atomic<int> stop;
+
+	Impl(): shared(1024), sleeping(0), stop(0){}
+};
+
+
+struct ThreadPool::Worker : public ThreadFunction{
+	ThreadPool& pool;
+	TaskDeque tasks;
+	Thread thread;
+	int index;
+	unsigned victim;
+
+	Worker(ThreadPool& p, int i): pool(p), index(i), victim(i){}
+
+	void operator()(){
+		tlsWorker = this;
+		Impl& impl = *pool.mImpl;
+		int spins = 0;
+		for(;;){
+			if(pool.runPending(this)){
+				spins = 0;
+				continue;
+			}
+			if(impl.stop.load()) break;
+			if(++spins < 256){
+				cpuRelax();
+				continue;
+			}
+			// Announce sleeping before the last check for tasks; submit()
+			// checks for sleepers after queueing, so one of them sees the other.
+			impl.idle.lock();
+			impl.sleeping.fetchAdd(1);
+			if(!pool.hasPending() && !impl.stop.load()) impl.idle.wait();
+			impl.sleeping.fetchAdd(-1);
+			impl.idle.unlock();
+			spins = 0;
+		}
+		tlsWorker = 0;
+	}
+};
+
+
+ThreadPool::ThreadPool(int numThreads, bool pin)
+:	mImpl(new Impl)
+{
+	int cores = numProcessors();
+	if(numThreads < 0) numThreads = cores - 1;
+	for(int i=0; i<numThreads; ++i){
+		mWorkers.push_back(new Worker(*this, i));
+	}
+	for(int i=0; i<numThreads; ++i){
+		Thread& thread = mWorkers[i]->thread;
+		if(pin && cores > 1) thread.affinity((i + 1) % cores);
+		thread.start(*mWorkers[i]);
+	}
+}
+
+ThreadPool::~ThreadPool(){
+	// run what is left on this thread, as workers may already be asleep
+	while(runPending(0)){}
+	mImpl->stop.store(1);
+	mImpl->idle.signal(true);
+	// join all before deleting any, as workers steal from each other
+	for(unsigned i=0; i<mWorkers.size(); ++i) mWorkers[i]->thread.join();
+	for(unsigned i=0; i<mWorkers.size(); ++i) delete mWorkers[i];
+	delete mImpl;
+}
+
+ThreadPool::Worker * ThreadPool::worker(const ThreadPool& pool){
+	Worker * w = (Worker *)tlsWorker;
+	return w && &w->pool == &pool ? w : 0;
+}
+
+void ThreadPool::execute(Task& task){
+	TaskGroup * group = task.mGroup;
+	task.run();
+	// the group may be gone once this reaches zero
+	group->mPending.fetchAdd(-1);
+}
+
+void ThreadPool::submit(Task& task){
+	Worker * self = worker(*this);
+	bool queued;
+	if(self){
+		queued = self->tasks.push(&task);
+	}
+	else{
+		Task * ptr = &task;
+		queued = mImpl->shared.tryPush(ptr);
+	}
+	if(!queued){
+		execute(task);
+		return;
+	}
+	memoryFence();
+	if(mImpl->sleeping.load()) mImpl->idle.signal();
+}
+
+bool ThreadPool::runPending(Worker * self){
+	Task * task = 0;
+	if(self) task = self->tasks.pop();
+	if(!task) mImpl->shared.tryPop(task);
+	if(!task){
+		int n = size();
+		unsigned start = self ? ++self->victim : 0;
+		for(int i=0; i<n && !task; ++i){
+			Worker * w = mWorkers[(start + i) % n];
+			if(w != self) task = w->tasks.steal();
+		}
+	}
+	if(task){
+		execute(*task);
+		return true;
+	}
+	return false;
+}
+
+bool ThreadPool::hasPending() const {
+	if(!mImpl->shared.empty()) return true;
+	for(unsigned i=0; i<mWorkers.size(); ++i){
+		if(!mWorkers[i]->tasks.empty()) return true;
+	}
+	return false;
+}
+
+
+void ThreadPool::TaskGroup::run(Task& task){
+	task.mGroup = this;
+	mPending.fetchAdd(1);
+	mPool.submit(task);
+}
+
+void ThreadPool::TaskGroup::wait(){
+	Worker * self = worker(mPool);
+	int spins = 0;
+	while(mPending.load()){
+		if(mPool.runPending(self)){
+			spins = 0;
+		}
+		else if(++spins < 256){
+			cpuRelax();
+		}
+		else{
+			Thread::yield();
+		}
+	}
+}
+
+
+void ThreadPool::RangeTask::run(){
+	splitRange(*body, begin, end);
+}
+
+void ThreadPool::splitRange(RangeBody& body, int begin, int end){
+	// queue the upper halves, which idle workers steal first, and run the rest
+	while(end - begin > body.grain){
+		int mid = begin + (end - begin) / 2;
+		RangeTask& task = body.tasks[body.numTasks.fetchAdd(1)];
+		task.body = &body;
+		task.begin = mid;
+		task.end = end;
+		body.group->run(task);
+		end = mid;
+	}
+	body(begin, end);
+}
+
+void ThreadPool::forRange(RangeBody& body, int begin, int end, int grain){
+	int n = end - begin;
+	if(grain < 1) grain = n / (8 * (size() + 1));
+	if(grain < 1) grain = 1;
+	if(n <= grain || 0 == size()){
+		body(begin, end);
+		return;
+	}
+	// halving leaves sub-ranges of more than grain/2, so there are at most
+	// 2n/grain of them, each but the first from a task
+	body.tasks.resize(2 * (n / grain) + 2);
+	body.grain = grain;
+	TaskGroup group(*this);
+	body.group = &group;
+	splitRange(body, begin, end);
+	group.wait();
+}
+
+} // al::
@@ -8,56 +8,101 @@
 namespace al{
 
 MsgQueue :: MsgQueue(int size, malloc_func mfunc, free_func ffunc)
-:	mHead(NULL), mTail(NULL), mPool(NULL),
-	mLen(0), mNow(0),
+:	mHeap(NULL), mChunks(NULL), mPool(NULL),
+	mLen(0), mCapacity(0), mChunkSize(size > 0 ? size : 1), mOrder(0), mNow(0),
 	mMalloc(mfunc ? mfunc : malloc), mFree(ffunc ? ffunc : free)
 {
-	growPool(size);
+	growPool(mChunkSize);
+	mHeap = (Entry *)mMalloc(sizeof(Entry) * mChunkSize);
+	mCapacity = mChunkSize;
 }
 
 MsgQueue :: ~MsgQueue() {
-	Msg * m;
-	while (mHead) {
-		m = mHead->next;
-		recycle(mHead);
-		mHead = m;
+	for (int i = 0; i < mLen; ++i) {
+		recycle(mHeap[i].msg);
 	}
-	while (mPool) {
-		m = mPool->next;
-		mFree(mPool);
-		mPool = m;
+	while (mChunks) {
+		Chunk * c = mChunks->next;
+		mFree(mChunks);
+		mChunks = c;
 	}
+	mFree(mHeap);
 }
 
+/* add a chunk of messages to the pool */
 void MsgQueue :: growPool(int size) {
-	assert(!mPool); // LJP
-	mPool = (Msg *)mMalloc(sizeof(Msg));
-	Msg * m = mPool;
-	while (size--) {
-		m->next = (Msg *)mMalloc(sizeof(Msg));
-		m = m->next;
+	Chunk * c = (Chunk *)mMalloc(sizeof(Chunk) + sizeof(Msg) * (size - 1));
+	c->next = mChunks;
+	mChunks = c;
+	for (int i = 0; i < size; ++i) {
+		Msg * m = c->msgs + i;
+		m->next = mPool;
+		mPool = m;
 	}
-	m->next = NULL;
+}
+
+/* double the capacity of the heap */
+void MsgQueue :: growHeap() {
+	Entry * heap = (Entry *)mMalloc(sizeof(Entry) * mCapacity * 2);
+	memcpy(heap, mHeap, sizeof(Entry) * mLen);
+	mFree(mHeap);
+	mHeap = heap;
+	mCapacity *= 2;
 }
 
 /* push a message back into the pool */
 void MsgQueue :: recycle(Msg * m) {
-	assert(mLen); // LJP
 	m->next = mPool;
 	mPool = m;
 	if (m->isBigMessage()) {
 		char * args = *(char **)(m->mArgs);
 		mFree(args);
 	}
-	mLen--;
+}
+
+/* insert a message into the heap */
+void MsgQueue :: push(Msg * m) {
+	if (mLen == mCapacity) growHeap();
+	Entry e = { m->t, mOrder++, m };
+	// sift up
+	int i = mLen++;
+	while (i > 0) {
+		int parent = (i - 1) / 4;
+		if (!e.before(mHeap[parent])) break;
+		mHeap[i] = mHeap[parent];
+		i = parent;
+	}
+	mHeap[i] = e;
+}
+
+/* remove the earliest message from the heap */
+MsgQueue::Msg * MsgQueue :: pop() {
+	Msg * top = mHeap[0].msg;
+	Entry last = mHeap[--mLen];
+	// sift down
+	int i = 0;
+	for (;;) {
+		int child = 4 * i + 1;
+		if (child >= mLen) break;
+		int end = child + 4 < mLen ? child + 4 : mLen;
+		int least = child;
+		for (int c = child + 1; c < end; ++c) {
+			if (mHeap[c].before(mHeap[least])) least = c;
+		}
+		if (!mHeap[least].before(last)) break;
+		mHeap[i] = mHeap[least];
+		i = least;
+	}
+	mHeap[i] = last;
+	return top;
 }
 
 /* schedule a new message */
 void MsgQueue :: sched(al_sec at, msg_func func, char * data, size_t size) {
-	assert(mPool);
 	// get a message-holder from the pool:
+	if (!mPool) growPool(mChunkSize);
 	Msg * m = mPool;
-	mPool= m->next;
+	mPool = m->next;
 
 	// prepare Msg:
 	m->next = NULL;
@@ -73,79 +118,29 @@ void MsgQueue :: sched(al_sec at, msg_func func, char * data, size_t size) {
 		memcpy(m->mArgs, data, size);
 	}
 
-	// insert into queue
-
-	// empty queue? set as new head and tail:
-	if (mHead == NULL) {
-		mHead = m;
-		mTail = m;
-		mLen = 1;
-		return;
-	}
-
-	// prepend case? insert as new head:
-	if (at < mHead->t) {
-		m->next = mHead;
-		mHead = m;
-		mLen++;
-		return;
-	}
-
-	// append case? add as new tail:
-	if (at >= mTail->t) {
-		mTail->next = m;
-		mTail = m;
-		mLen++;
-		return;
-	}
-
-	// else: insert somewhere between head and tail:
-	Msg * p = mHead;
-	Msg * n = p->next;
-	// compare with <= so that events with same timestamp will be in order of insertion
-	while (n && n->t <= at) {
-		p = n;
-		n = n->next;
-	}
-	m->next = n;
-	p->next = m;
-	mLen++;
+	push(m);
 }
 
 void MsgQueue :: update(al_sec until, bool defer) {
-	Msg * m = mHead;
-	while (m && m->t <= until) {
-		mHead = m->next;
-
-//		if (defer && m->retry > 0.) {
-//			m->msg.t = x->now + m->retry;
-//			al_pq_sched_msg(x, m);
-//		} else {
-
-		// only call if it has data associated:
-		//if (m->args) {
-			mNow = AL_MAX(mNow, m->t);
-			(m->func)(mNow, m->args());
-		//}
-
+	while (mLen && mHeap[0].t <= until) {
+		// remove before calling, so the message may schedule others:
+		Msg * m = pop();
+		mNow = AL_MAX(mNow, m->t);
+		(m->func)(mNow, m->args());
 		recycle(m);
-		m = mHead;
 	}
 	mNow = until;
 }
 
 void MsgQueue :: clear() {
 	// recycle everything:
-	Msg * m = mHead;
-	while (m) {
-		mHead = m->next;
-		recycle(m);
-		m = mHead;
+	for (int i = 0; i < mLen; ++i) {
+		recycle(mHeap[i].msg);
 	}
+	mLen = 0;
 	// reset clock:
 	mNow = 0;
-	mHead = NULL;
-	mTail = NULL;
+	mOrder = 0;
 }
 
 } // al::
@@ -24,11 +24,14 @@ int main (int argc, char * const argv[]) {
 	RUNTEST(MathSpherical);
 	RUNTEST(Types);
 	RUNTEST(TypesConversion);
+	RUNTEST(Sound);
 	RUNTEST(Spatial);
 	RUNTEST(System);
 	RUNTEST(ProtocolOSC);
 	RUNTEST(ProtocolSerialize);
 
+	RUNTEST(IOAudioProfiler);
+	RUNTEST(IOAudioRenderer);
 	RUNTEST(IOSocket);
 	RUNTEST(File);
 	RUNTEST(Thread);
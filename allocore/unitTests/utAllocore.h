@@ -17,6 +17,8 @@
 using namespace al;
 
 int utIOAudioIO();
+int utIOAudioProfiler();
+int utIOAudioRenderer();
 int utIOSocket();
 int utIOWindowGL();
 int utMath();
@@ -25,6 +27,7 @@ int utGraphicsDraw();
 int utGraphicsMesh();
 int utProtocolOSC();
 int utProtocolSerialize();
+int utSound();
 int utSpatial();
 int utSystem();
 int utTypes();
@@ -0,0 +1,70 @@
+#include "utAllocore.h"
+
+struct SlowCallback : public AudioCallback{
+	SlowCallback(int us): nsec(us * 1000LL){}
+	void onAudioCB(AudioIOData& io){
+		long long end = AudioProfiler::now() + nsec;
+		while(AudioProfiler::now() < end){}
+	}
+	long long nsec;
+};
+
+static void silentCB(AudioIOData& io){}
+
+int utIOAudioProfiler(){
+
+	// Histogram binning and statistics
+	{
+		AudioProfiler p;
+		p.beginBlock(0.001);
+		p.record(0, 500);		// below 1 us: bin 0
+		p.record(0, 3000);		// 3 us: [2.83, 4) us, bin 3
+		p.record(2, 100000);	// 100 us: [90.5, 128) us, bin 13
+		p.endBlock();
+
+		assert(1 == p.blocks());
+		assert(3 == p.numSlots());
+		AudioProfiler::Stats s = p.stats(0);
+		assert(2 == s.count);
+		assert(1 == s.bins[0] && 1 == s.bins[3]);
+		assert(fabs(s.meanSec - 1.75e-6) < 1e-12);
+		assert(fabs(s.maxSec - 3e-6) < 1e-12);
+		assert(fabs(s.percentileSec(0.5) - AudioProfiler::binTime(1)) < 1e-12);
+		assert(fabs(s.percentileSec(1.0) - 3e-6) < 1e-12);
+		assert(0 == p.stats(1).count);
+		assert(1 == p.stats(2).bins[13]);
+
+		p.reset();
+		assert(1 == p.blocks());	// takes effect at the next block
+		p.beginBlock(0.001);
+		p.endBlock();
+		assert(1 == p.blocks());
+		assert(0 == p.numSlots());
+		assert(0 == p.stats(0).count);
+	}
+
+	// Deadline misses of a stream processed without a device
+	{
+		AudioIO io(64, 44100, silentCB, 0, 2, 0);
+		SlowCallback fast(10), slow(2000);	// deadline is 1.45 ms
+		io.append(fast).append(slow);
+		io.profiling(true);
+		for(int i=0; i<5; ++i) io.processBuffer();
+
+		const AudioProfiler& p = io.profiler();
+		assert(5 == p.blocks());
+		assert(5 == p.deadlineMisses());
+		assert(p.maxLoad() > 1);
+		assert(3 == p.numSlots());
+		assert(5 == p.stats(0).count && 5 == p.stats(1).count && 5 == p.stats(2).count);
+		assert(p.stats(1).maxSec < p.stats(2).meanSec);
+		assert(p.stats(2).meanSec >= 2e-3);
+		assert(p.blockStats().meanSec >= p.stats(2).meanSec);
+
+		io.profiling(false);
+		io.processBuffer();
+		assert(5 == p.blocks());
+	}
+
+	return 0;
+}
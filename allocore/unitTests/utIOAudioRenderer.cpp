@@ -0,0 +1,100 @@
+#include "utAllocore.h"
+
+// Writes a ramp of the frame count to channel 0 and its negative to channel 1
+static void rampCB(AudioIOData& io){
+	int& count = io.user<int>();
+	while(io()){
+		float v = count++ * 0.001f;
+		io.out(0) = v;
+		io.out(1) =-v;
+	}
+}
+
+int utIOAudioRenderer(){
+
+	const int frames = 1000;
+
+	// Memory rendering, with a partial last buffer
+	{
+		int count = 0;
+		AudioIO io(64, 48000, rampCB, &count, 2, 0);
+		io.clipOut(false);
+		std::vector<float> buf(2 * frames);
+		AudioRenderer r;
+		r.add(io, frames, &buf[0]);
+		assert(r.run());
+		for(int i=0; i<frames; ++i){
+			assert(buf[i] == i * 0.001f);
+			assert(buf[frames + i] ==-i * 0.001f);
+		}
+		assert(1024 == count);
+		assert(fabs(io.time() - 1024/48000.) < 1e-9);
+		assert(r.secondsRendered() == frames/48000.);
+	}
+
+	// Clipping applies to all output channels
+	{
+		int count = 500;
+		AudioIO io(64, 48000, rampCB, &count, 2, 0);
+		std::vector<float> buf(2 * frames);
+		AudioRenderer r;
+		r.add(io, frames, &buf[0]);
+		assert(r.run());
+		assert(1.f == buf[frames-1]);
+		assert(-1.f == buf[2*frames-1]);
+	}
+
+	// Independent jobs spread over threads
+	{
+		const int N = 4;
+		int counts[N];
+		AudioIO * ios[N];
+		std::vector<float> bufs[N];
+		AudioRenderer r(N);
+		for(int j=0; j<N; ++j){
+			counts[j] = j * 100;
+			ios[j] = new AudioIO(128, 44100, rampCB, &counts[j], 2, 0);
+			ios[j]->clipOut(false);
+			bufs[j].resize(2 * frames);
+			r.add(*ios[j], frames, &bufs[j][0]);
+		}
+		assert(r.run());
+		assert(r.secondsRendered() == N * (frames/44100.));
+		for(int j=0; j<N; ++j){
+			for(int i=0; i<frames; ++i){
+				assert(bufs[j][i] == (j*100 + i) * 0.001f);
+			}
+			delete ios[j];
+		}
+	}
+
+	// WAV file
+	{
+		int count = 0;
+		AudioIO io(64, 48000, rampCB, &count, 2, 0);
+		io.clipOut(false);
+		const char * path = "utIOAudioRenderer.wav";
+		AudioRenderer r;
+		r.add(io, frames, path);
+		assert(r.run());
+
+		FILE * fp = fopen(path, "rb");
+		assert(fp);
+		unsigned char header[58];
+		assert(1 == fread(header, sizeof(header), 1, fp));
+		assert(0 == memcmp(header, "RIFF", 4));
+		assert(0 == memcmp(header + 8, "WAVE", 4));
+		assert(3 == header[20] && 2 == header[22]);			// float, stereo
+		assert(0 == memcmp(header + 50, "data", 4));
+		int dataBytes = header[54] | header[55]<<8 | header[56]<<16 | header[57]<<24;
+		assert(frames * 2 * 4 == dataBytes);
+		float frame[2];
+		fseek(fp, 10 * sizeof(frame), SEEK_CUR);
+		assert(1 == fread(frame, sizeof(frame), 1, fp));
+		assert(frame[0] == 10 * 0.001f && frame[1] ==-10 * 0.001f);
+		fclose(fp);
+		remove(path);
+	}
+
+	return 0;
+}
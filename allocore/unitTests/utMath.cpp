@@ -801,6 +801,32 @@ int utMath(){
 	}
 
 
+	// RFFT
+	{
+		const int N = 64;
+		RFFT<double> fft(N);
+		assert(fft.numBins() == N/2+1);
+
+		double x[N], re[N/2+1], im[N/2+1], y[N];
+		for(int i=0; i<N; ++i) x[i] = sin(i*0.3) + (i%5)*0.1;
+
+		// compare against DFT
+		fft.forward(re, im, x);
+		for(int k=0; k<=N/2; ++k){
+			double dr=0, di=0;
+			for(int i=0; i<N; ++i){
+				dr += x[i]*cos(-2*M_PI*k*i/N);
+				di += x[i]*sin(-2*M_PI*k*i/N);
+			}
+			assert(eq(re[k], dr, 1e-9));
+			assert(eq(im[k], di, 1e-9));
+		}
+
+		// round trip scales by size
+		fft.inverse(y, re, im);
+		for(int i=0; i<N; ++i) assert(eq(y[i]/N, x[i], 1e-12));
+	}
+
 	// Random
 	{
 		using namespace al::rnd;
@@ -0,0 +1,431 @@
+#include "utAllocore.h"
+#include <map>
+
+int utSound(){
+
+	// SoundSourceArray handles
+	{
+		SoundSourceArray sources(4, 16);
+		typedef SoundSourceArray::Handle Handle;
+
+		Handle a = sources.add();
+		Handle b = sources.add();
+		assert(sources.valid(a) && sources.valid(b));
+		assert(2 == sources.size());
+
+		sources.pos(b, Vec3d(1,2,3));
+		sources.remove(a);
+		assert(!sources.valid(a));
+		assert(sources.valid(b));
+		assert(1 == sources.size());
+		assert(sources.pos(b) == Vec3d(1,2,3));
+
+		// removing a stale handle does nothing
+		sources.remove(a);
+		assert(1 == sources.size());
+
+		// reusing one slot more often than the generation bits can count
+		Handle prev = sources.add();
+		for(int i=0; i<10000; ++i){
+			sources.remove(prev);
+			assert(!sources.valid(prev));
+			Handle h = sources.add();
+			assert(h != SoundSourceArray::invalidHandle());
+			assert(sources.valid(h));
+			assert(h != prev);
+			prev = h;
+		}
+		assert(2 == sources.size());
+		sources.remove(prev);
+		assert(1 == sources.size());
+	}
+
+	// SourceStates, checked against a std::map
+	{
+		std::vector<SoundSource> srcs(300, SoundSource(1, 1, 100, 0, 1));
+		SourceStates<int> states;
+		std::map<const SoundSource *, int> ref;
+		unsigned rnd = 1;
+		for(int i=0; i<20000; ++i){
+			rnd = rnd * 1664525 + 1013904223;
+			SoundSource& s = srcs[(rnd >> 8) % srcs.size()];
+			if((rnd >> 28) & 1){
+				states.add(s) = i;
+				ref[&s] = i;
+			}
+			else{
+				states.remove(s);
+				ref.erase(&s);
+			}
+		}
+		assert(int(ref.size()) == states.size());
+		for(unsigned i=0; i<srcs.size(); ++i){
+			int * state = states.find(srcs[i]);
+			std::map<const SoundSource *, int>::iterator it = ref.find(&srcs[i]);
+			assert((state != 0) == (it != ref.end()));
+			if(state) assert(*state == it->second);
+		}
+		states.clear();
+		assert(0 == states.size() && !states.find(srcs[0]));
+	}
+
+	// A source added to a used slot of a SoundSourceArray starts without the
+	// state of the slot's previous source
+	{
+		const int N = 64;
+		SpeakerLayout layout;
+		for(int i=0; i<4; ++i) layout.addSpeaker(Speaker(i, 90*i, 0));
+		layout.addSpeaker(Speaker(4, 0, 90));
+		layout.addSpeaker(Speaker(5, 0, -90));
+
+		std::vector<float> outs[2];
+		for(int run=0; run<2; ++run){
+			Vbap vbap(layout);
+			AudioScene scene(N);
+			scene.createListener(&vbap);
+			SoundSourceArray sources(1, 256);
+			scene.addSourceArray(sources);
+			AudioIO io(N, 44100, 0, 0, layout.numSpeakers(), 0);
+
+			SoundSourceArray::Handle h = sources.add();
+			if(run == 0){ // pan a first source elsewhere, then reuse its slot
+				sources.pos(h, Vec3d(-2, 1, 0));
+				sources.enableDoppler(h, false);
+				for(int i=0; i<N; ++i) sources.writeSample(h, 1);
+				io.zeroOut();
+				scene.render(io, sources);
+				sources.remove(h);
+				h = sources.add();
+			}
+			sources.pos(h, Vec3d(1, 2, 0.5));
+			sources.enableDoppler(h, false);
+			for(int i=0; i<N; ++i) sources.writeSample(h, 1);
+			io.zeroOut();
+			scene.render(io, sources);
+			outs[run].assign(io.outBuffer(), io.outBuffer() + io.channelsOut()*N);
+		}
+		assert(outs[0] == outs[1]);
+	}
+
+	// Vbap per buffer processing, against per sample processing for a still
+	// source, and continuity of its gains as a source crosses triplets
+	{
+		const int N = 64;
+		SpeakerLayout layout;
+		for(int i=0; i<4; ++i) layout.addSpeaker(Speaker(i, 90*i, 0));
+		layout.addSpeaker(Speaker(4, 0, 90));
+		layout.addSpeaker(Speaker(5, 0, -90));
+
+		std::vector<float> outs[2];
+		for(int run=0; run<2; ++run){
+			Vbap vbap(layout);
+			AudioScene scene(N);
+			scene.createListener(&vbap);
+			scene.usePerSampleProcessing(run == 1);
+			SoundSource src;
+			src.enableDoppler(false);
+			scene.addSource(src);
+			src.pose().pos(1, 1.5, -0.5);
+			AudioIO io(N, 44100, 0, 0, layout.numSpeakers(), 0);
+			for(int b=0; b<8; ++b){
+				for(int i=0; i<N; ++i) src.writeSample(sin(0.1*(b*N + i)));
+				io.zeroOut();
+				scene.render(io);
+				// skip blocks ramping from the initial state
+				if(b >= 4) outs[run].insert(outs[run].end(), io.outBuffer(), io.outBuffer() + io.channelsOut()*N);
+			}
+		}
+		double maxDiff = 0, peak = 0;
+		for(unsigned i=0; i<outs[0].size(); ++i){
+			maxDiff = std::max(maxDiff, fabs(double(outs[0][i]) - outs[1][i]));
+			peak = std::max(peak, fabs(double(outs[1][i])));
+		}
+		assert(peak > 0.1);
+		assert(maxDiff < 1e-5);
+
+		// With a constant input, each output channel follows the gain of its
+		// speaker, which should ramp without jumping when the triplet changes.
+		Vbap vbap(layout);
+		AudioScene scene(N);
+		scene.createListener(&vbap);
+		SoundSource src;
+		src.enableDoppler(false);
+		scene.addSource(src);
+		AudioIO io(N, 44100, 0, 0, layout.numSpeakers(), 0);
+		std::vector<float> prev(layout.numSpeakers(), 0.f);
+		double maxStep = 0;
+		for(int b=0; b<24; ++b){
+			double az = b < 4 ? 0 : (b-4) * 20 * M_PI/180;	// crosses a triplet every 90 degrees
+			src.pose().pos(2*sin(az), 0.3, -2*cos(az));
+			for(int i=0; i<N; ++i) src.writeSample(1);
+			io.zeroOut();
+			scene.render(io);
+			for(int c=0; c<io.channelsOut(); ++c){
+				const float * out = io.outBuffer(c);
+				for(int i=0; i<N; ++i){
+					if(b >= 4) maxStep = std::max(maxStep, fabs(double(out[i]) - prev[c]));
+					prev[c] = out[i];
+				}
+			}
+		}
+		assert(maxStep > 0);
+		assert(maxStep < 0.02);
+	}
+
+	// Vbap triplets found through the direction lookup grid, against a
+	// search of all triplets, for many directions
+	{
+		const int N = 4;
+		SpeakerLayout layout;
+		int chan = 0;
+		for(int i=0; i<8; ++i) layout.addSpeaker(Speaker(chan++, 45*i, 0));
+		for(int i=0; i<6; ++i) layout.addSpeaker(Speaker(chan++, 60*i + 30, 40));
+		for(int i=0; i<4; ++i) layout.addSpeaker(Speaker(chan++, 90*i + 20, -35));
+		layout.addSpeaker(Speaker(chan++, 0, 90));
+
+		Vbap full(layout), fine(layout), coarse(layout);
+		fine.setLookupResolution(36, 18);
+		coarse.setLookupResolution(5, 3);
+		AudioScene scene(N);
+		scene.createListener(&full);
+		scene.createListener(&fine);
+		scene.createListener(&coarse);
+		assert(0 == full.lookupMemory() && fine.lookupMemory() && coarse.lookupMemory());
+
+		Vbap * vbaps[] = {&full, &fine, &coarse};
+		AudioIO io(N, 44100, 0, 0, layout.numSpeakers(), 0);
+		SoundSource src;	// not added, so gains are not ramped
+		unsigned rnd = 1;
+		double maxDiff = 0;
+		for(int d=0; d<36*19 + 20000; ++d){
+			Vec3d dir;
+			if(d < 36*19){	// on the borders of the fine grid's cells
+				double az = (d%36) * 10 * M_PI/180, el = ((d/36) * 10 - 90) * M_PI/180;
+				dir.set(sin(az)*cos(el), sin(el), -cos(az)*cos(el));
+			}
+			else{
+				for(int k=0; k<3; ++k){
+					rnd = rnd * 1664525 + 1013904223;
+					dir[k] = float(rnd >> 8) / (1<<23) - 1.;
+				}
+				if(dir.mag() < 0.1) continue;
+			}
+
+			float ref[32];
+			for(int v=0; v<3; ++v){
+				float samples[N] = {1, 1, 1, 1};
+				Vec3d relpos = dir;
+				io.zeroOut();
+				vbaps[v]->perform(io, src, relpos, N, samples);
+				for(int c=0; c<io.channelsOut(); ++c){
+					const float g = io.out(c, N-1);
+					if(v == 0)	ref[c] = g;
+					else		maxDiff = std::max(maxDiff, fabs(double(g) - ref[c]));
+				}
+			}
+		}
+		assert(maxDiff < 1e-6);
+	}
+
+	// Vbap and Dbap give the same output mixing through a MixMatrix as
+	// mixing directly, also with buffers not a multiple of its tile size
+	{
+		SpeakerLayout layout;
+		for(int i=0; i<4; ++i) layout.addSpeaker(Speaker(i, 90*i, 0));
+		layout.addSpeaker(Speaker(4, 0, 90));
+		layout.addSpeaker(Speaker(5, 0, -90));
+
+		const int sizes[] = {64, 100};
+		for(int s=0; s<2; ++s){
+			for(int type=0; type<2; ++type){
+				const int N = sizes[s];
+				std::vector<float> outs[2];
+				for(int run=0; run<2; ++run){
+					Vbap vbap(layout);
+					Dbap dbap(layout);
+					AudioScene scene(N);
+					if(type == 0)	scene.createListener(&vbap);
+					else			scene.createListener(&dbap);
+					scene.useMixMatrix(run == 1);
+					SoundSource srcs[3];
+					for(int j=0; j<3; ++j){
+						srcs[j].enableDoppler(false);
+						scene.addSource(srcs[j]);
+					}
+					AudioIO io(N, 44100, 0, 0, layout.numSpeakers(), 0);
+
+					// move the sources so that gains ramp over each block
+					for(int b=0; b<4; ++b){
+						for(int j=0; j<3; ++j){
+							double a = 0.4*b + 2*j;
+							srcs[j].pose().pos(2*cos(a), 2*sin(a), 0.5*j);
+							for(int i=0; i<N; ++i) srcs[j].writeSample(sin(0.05*(j+1)*(b*N + i)));
+						}
+						io.zeroOut();
+						scene.render(io);
+						outs[run].insert(outs[run].end(), io.outBuffer(), io.outBuffer() + io.channelsOut()*N);
+					}
+				}
+				double maxDiff = 0, peak = 0;
+				for(unsigned i=0; i<outs[0].size(); ++i){
+					maxDiff = std::max(maxDiff, fabs(double(outs[0][i]) - outs[1][i]));
+					peak = std::max(peak, fabs(double(outs[0][i])));
+				}
+				assert(peak > 0.1);
+				assert(maxDiff < 1e-5);
+			}
+		}
+	}
+
+	// MultiReverb lanes, against separate Reverbs with the same parameters,
+	// and block processing, against processing one sample at a time
+	{
+		const int N = 4, numFrames = 3000;
+		const float decays[N] = {0.5f, 0.7f, 0.85f, 0.95f};
+		const float dampings[N] = {0.1f, 0.3f, 0.5f, -0.2f};
+		const float bandwidths[N] = {0.9995f, 0.9f, 0.7f, 0.5f};
+
+		MultiReverb<N> multi, multiBlock;
+		Reverb<float> scalars[N], scalarsBlock[N];
+		MultiReverb<N>::Lanes decay, damping, bandwidth;
+		for(int k=0; k<N; ++k){
+			decay[k] = decays[k];
+			damping[k] = dampings[k];
+			bandwidth[k] = bandwidths[k];
+			scalars[k].decay(decays[k]).damping(dampings[k]).bandwidth(bandwidths[k]).diffusionIn1(0.7f);
+			scalarsBlock[k] = scalars[k];
+		}
+		multi.decay(decay).damping(damping).bandwidth(bandwidth).diffusionIn1(MultiReverb<N>::Lanes(0.7f));
+		multiBlock = multi;
+
+		// an impulse into each reverb at a different time
+		std::vector<float> in[N], outBlock1[N], outBlock2[N], outMultiBlock1[N], outMultiBlock2[N];
+		const float * ins[N];
+		float * outs1[N], * outs2[N];
+		for(int k=0; k<N; ++k){
+			in[k].assign(numFrames, 0.f);
+			in[k][100*k] = 1.f;
+			outBlock1[k].resize(numFrames);
+			outBlock2[k].resize(numFrames);
+			outMultiBlock1[k].resize(numFrames);
+			outMultiBlock2[k].resize(numFrames);
+			ins[k] = &in[k][0];
+			outs1[k] = &outMultiBlock1[k][0];
+			outs2[k] = &outMultiBlock2[k][0];
+			scalarsBlock[k].process(ins[k], &outBlock1[k][0], &outBlock2[k][0], numFrames, 0.5f);
+		}
+		multiBlock.process(ins, outs1, outs2, numFrames, 0.5f);
+
+		double maxDiff = 0, peak = 0;
+		for(int i=0; i<numFrames; ++i){
+			MultiReverb<N>::Lanes x, y1, y2;
+			for(int k=0; k<N; ++k) x[k] = in[k][i];
+			multi(x, y1, y2, MultiReverb<N>::Lanes(0.5f));
+			for(int k=0; k<N; ++k){
+				float s1, s2;
+				scalars[k](in[k][i], s1, s2, 0.5f);
+				const float ref[] = {s1, s2};
+				const float got[] = {y1[k], y2[k], outBlock1[k][i], outBlock2[k][i], outMultiBlock1[k][i], outMultiBlock2[k][i]};
+				for(int j=0; j<6; ++j) maxDiff = std::max(maxDiff, fabs(double(got[j]) - ref[j&1]));
+				peak = std::max(peak, fabs(double(s1)));
+			}
+		}
+		assert(peak > 0.01);
+		assert(maxDiff <= 1e-6 * peak);
+	}
+
+	// AmbiDecode near-field compensation of each order, against the
+	// analog filters at 80 Hz for a speaker at 1 m
+	{
+		const double fs = 48000, f = 80;
+		const double analog[] = {1, 0.8260, 0.4796, 0.1661};
+		const int chanOfOrder[] = {0, 1, 3, 5};		// W, X, U, P
+		for(int m=0; m<=3; ++m){
+			Speakers spk;
+			spk.push_back(Speaker(0));
+			AmbiDecode dec(3, 3, 1);
+			dec.setSpeakers(&spk);
+			dec.setSpeaker(0, 0, 0);
+			dec.freeze();
+			dec.nearFieldCompensation(0, 1, fs);
+
+			const int N = 256, c = chanOfOrder[m];
+			const float w = dec.decodeWeight(0, c);
+			std::vector<float> enc(dec.channels() * N), out(N);
+			double peak = 0;
+			for(int b=0; b<400; ++b){
+				for(int i=0; i<N; ++i) enc[c*N + i] = sin(2*M_PI*f*(b*N + i)/fs);
+				std::fill(out.begin(), out.end(), 0.f);
+				dec.decode(&out[0], &enc[0], N);
+				if(b >= 300) for(int i=0; i<N; ++i) peak = std::max(peak, fabs(double(out[i])/w));
+			}
+			assert(fabs(peak - analog[m]) < 0.002);
+		}
+	}
+
+	// Convolver, against direct convolution delayed by the block size
+	{
+		const int numIns = 2, numOuts = 2, N = 6000, L = 1500;
+		std::vector<float> x[numIns], h[numIns][numOuts];
+		unsigned rnd = 1;
+		for(int c=0; c<numIns; ++c){
+			x[c].resize(N);
+			for(int i=0; i<N; ++i){
+				rnd = rnd * 1664525 + 1013904223;
+				x[c][i] = float(rnd >> 8) / (1<<24) - 0.5f;
+			}
+			for(int o=0; o<numOuts; ++o){
+				h[c][o].resize(L - 300*(c+o));	// unequal lengths
+				for(unsigned i=0; i<h[c][o].size(); ++i){
+					rnd = rnd * 1664525 + 1013904223;
+					h[c][o][i] = (float(rnd >> 8) / (1<<24) - 0.5f) * exp(-4.*i/L);
+				}
+			}
+		}
+
+		// blockSize, maxBlockSize, numThreads, frames per process() call
+		const int setups[][4] = {
+			{32,   32, 0, 32},		// uniform
+			{16, 1024, 0, 64},		// non-uniform
+			{16, 1024, 1, 64},		// non-uniform on a worker thread
+			{16, 1024, 1, 37},		// buffers not a multiple of the block size
+			{64,  256, 0, 1000}		// buffers larger than the block size
+		};
+		for(unsigned s=0; s<sizeof(setups)/sizeof(setups[0]); ++s){
+			const int B = setups[s][0];
+			Convolver conv(numIns, numOuts, B, setups[s][1], setups[s][2]);
+			for(int c=0; c<numIns; ++c){
+				for(int o=0; o<numOuts; ++o) conv.impulse(c, o, &h[c][o][0], h[c][o].size());
+			}
+			assert((conv.numStages() == 1) == (setups[s][0] == setups[s][1]));
+
+			std::vector<float> y[numOuts];
+			for(int o=0; o<numOuts; ++o) y[o].resize(N);
+			for(int i=0; i<N; i+=setups[s][3]){
+				const int n = std::min(setups[s][3], N-i);
+				const float * ins[numIns];
+				float * outs[numOuts];
+				for(int c=0; c<numIns; ++c) ins[c] = &x[c][i];
+				for(int o=0; o<numOuts; ++o) outs[o] = &y[o][i];
+				conv.process(ins, outs, n);
+			}
+
+			double maxErr = 0, peak = 0;
+			for(int o=0; o<numOuts; ++o){
+				for(int i=0; i<N; ++i){
+					double ref = 0;
+					for(int c=0; c<numIns; ++c){
+						const std::vector<float>& hc = h[c][o];
+						for(int k=0; k<int(hc.size()) && k<=i-B; ++k) ref += double(x[c][i-B-k]) * hc[k];
+					}
+					maxErr = std::max(maxErr, fabs(y[o][i] - ref));
+					peak = std::max(peak, fabs(ref));
+				}
+			}
+			//printf("Convolver setup %d: relative error %g\n", s, maxErr/peak);
+			assert(maxErr < 1e-6 * peak);
+		}
+	}
+
+	return 0;
+}
@@ -17,5 +17,28 @@ int utSpatial(){
 		a.step(0.5);	assert(a.vec() == Vec3d(2.5,0,0));
 	}
 
+	{
+		DistAttenTable<float> t(1024);
+		t.set(DistAttenTable<float>::SIGMOID, 1, 100, 0.1);
+		assert(t(0) == 1);
+		assert(t(1) == 1);
+		assert(fabs(t(1000) - t.evaluate(101)) < 1e-6);
+
+		float dists[64], amps[64];
+		for(int i=0; i<64; ++i) dists[i] = i * 2.3f - 4;
+		t(amps, dists, 64);
+		for(int i=0; i<64; ++i){
+			assert(amps[i] == t(dists[i]));
+			assert(fabs(amps[i] - t.evaluate(dists[i])) < 1e-4);
+		}
+
+		DistAtten<float> d(1, 20, 1);
+		t.set(d, DistAtten<float>::INVERSE);
+		for(int i=0; i<20; ++i){
+			float dist = 1 + i*0.9f;
+			assert(fabs(t(dist) - d.inverse(dist)) < 1e-4);
+		}
+	}
+
 	return 0;
 }
@@ -1,4 +1,5 @@
 #include "utAllocore.h"
+#include "allocore/types/al_MsgTube.hpp"
 
 void * threadFunc(void * user){
 	*(int *)user = 1; return NULL;
@@ -12,6 +13,151 @@ struct MyThreadFunc : public ThreadFunction{
 	int& x;
 };
 
+// Two threads taking turns incrementing a count, sleeping on a Condition
+namespace{
+	const int condTurns = 1000;
+	Condition condition;
+	Atomic<int> condCount;
+
+	// Waits for the count to become odd, then makes it even
+	void * condPartner(void * user){
+		for(int i=0; i<condTurns; ++i){
+			condition.lock();
+			while(!(condCount.load() & 1)) condition.wait();
+			condition.unlock();
+			condCount.fetchAdd(1);
+			condition.signal();
+		}
+		return NULL;
+	}
+}
+
+// Two threads taking turns, each waking the other through a Semaphore
+namespace{
+	const int semTurns = 1000;
+	Semaphore semPing, semPong;
+	int semCount = 0;
+
+	void * semPartner(void * user){
+		for(int i=0; i<semTurns; ++i){
+			semPing.wait();
+			++semCount;
+			semPong.post();
+		}
+		return NULL;
+	}
+}
+
+// Stress test of MultiMsgTube: writers send numbered messages that the
+// reader checks arrive complete and in order per writer
+namespace{
+	const int tubeWriters = 4;
+	const int tubeMsgs = 20000;
+	int tubeNext[tubeWriters];
+	al_sec tubeLastTime;
+	bool tubeInOrder = true;
+	Atomic<int> tubeWriterIDs;
+
+	void tubeRecv(al_sec t, int writer, int seq){
+		if(seq != tubeNext[writer] || t < tubeLastTime) tubeInOrder = false;
+		tubeNext[writer] = seq + 1;
+		tubeLastTime = t;
+	}
+
+	void * tubeWriter(void * user){
+		MsgTube * tube = ((MultiMsgTube *)user)->producer();
+		int writer = tubeWriterIDs.fetchAdd(1);
+		for(int i=0; i<tubeMsgs; ++i){
+			tube->now = i;
+			tube->send(tubeRecv, writer, i);
+		}
+		while(!tube->flush()) al_sleep(0.001);
+		return NULL;
+	}
+}
+
+// Stress test of ObjectQueue: writers push numbered items that readers
+// check arrive complete and in order per writer
+namespace{
+	const int queueWriters = 2, queueReaders = 2;
+	const int queueItems = 20000;
+	struct QueueItem{ int writer, seq; std::vector<int> payload; };
+	ObjectQueue<QueueItem> objectQueue(64);
+	Atomic<int> queueWriterIDs, queuePopped, queueErrors;
+
+	void * queueWriter(void * user){
+		int writer = queueWriterIDs.fetchAdd(1);
+		QueueItem item;
+		for(int i=0; i<queueItems; ++i){
+			item.writer = writer;
+			item.seq = i;
+			item.payload.assign(16, i);
+			objectQueue.push(item);
+		}
+		return NULL;
+	}
+
+	void * queueReader(void * user){
+		int next[queueWriters] = {0};
+		QueueItem item;
+		while(queuePopped.load() < queueWriters * queueItems){
+			if(!objectQueue.pop(item, 0.01)) continue;
+			queuePopped.fetchAdd(1);
+			if(item.seq < next[item.writer] || item.payload.size() != 16 || item.payload[15] != item.seq){
+				queueErrors.fetchAdd(1);
+			}
+			next[item.writer] = item.seq + 1;
+		}
+		return NULL;
+	}
+}
+
+// ThreadPool bodies
+namespace{
+	// Adds one to each element of a range
+	struct Increment{
+		int * data;
+		void operator()(int begin, int end){
+			for(int i=begin; i<end; ++i) ++data[i];
+		}
+	};
+
+	// Runs a parallelFor over each row of a range of rows
+	struct Rows{
+		ThreadPool * pool;
+		int * data;
+		int cols;
+		void operator()(int begin, int end){
+			for(int r=begin; r<end; ++r){
+				Increment inc = { data + r*cols };
+				pool->parallelFor(0, cols, inc, 7);
+			}
+		}
+	};
+
+	// Sums [begin, end) by splitting into nested tasks
+	struct SumTask : public ThreadPool::Task{
+		SumTask(ThreadPool * p, int b, int e): pool(p), begin(b), end(e), sum(0){}
+		ThreadPool * pool;
+		int begin, end;
+		long long sum;
+		void run(){
+			if(end - begin <= 100){
+				sum = 0;
+				for(int i=begin; i<end; ++i) sum += i;
+				return;
+			}
+			int mid = (begin + end) / 2;
+			SumTask lo(pool, begin, mid), hi(pool, mid, end);
+			ThreadPool::TaskGroup group(*pool);
+			group.run(lo);
+			group.run(hi);
+			group.wait();
+			sum = lo.sum + hi.sum;
+		}
+	};
+}
+
 int utThread() {
 
 	//UT_PRINTF("system: thread\n");
@@ -54,5 +200,98 @@ int utThread() {
 		assert(1 == x);
 	}
 
+	// Condition
+	{
+		Thread t(condPartner, 0);
+		for(int i=0; i<condTurns; ++i){
+			condCount.fetchAdd(1);
+			condition.signal();
+			condition.lock();
+			while(condCount.load() & 1) condition.wait();
+			condition.unlock();
+		}
+		t.join();
+		assert(2*condTurns == condCount.load());
+	}
+
+	// Semaphore
+	{
+		Thread t(semPartner, 0);
+		for(int i=0; i<semTurns; ++i){
+			++semCount;
+			semPing.post();
+			semPong.wait();
+		}
+		t.join();
+		assert(2*semTurns == semCount);
+	}
+
+	// Multiple writers to one reader
+	{
+		MultiMsgTube tube(tubeWriters, 12);	// small rings, so writers overflow
+		Thread writers[tubeWriters];
+		for(int i=0; i<tubeWriters; ++i) writers[i].start(tubeWriter, &tube);
+
+		// execute as messages arrive, each call in time order
+		int received = 0;
+		while(received < tubeWriters * tubeMsgs){
+			tubeLastTime = -1;
+			tube.executeUntil(tubeMsgs);
+			received = 0;
+			for(int i=0; i<tubeWriters; ++i) received += tubeNext[i];
+			assert(tubeInOrder);
+			al_sleep(0.001);
+		}
+		for(int i=0; i<tubeWriters; ++i) writers[i].join();
+		assert(tube.numProducers() == tubeWriters);
+		assert(NULL == tube.producer());
+	}
+
+	// Multiple writers and readers of an ObjectQueue
+	{
+		Thread writers[queueWriters], readers[queueReaders];
+		for(int i=0; i<queueReaders; ++i) readers[i].start(queueReader, NULL);
+		for(int i=0; i<queueWriters; ++i) writers[i].start(queueWriter, NULL);
+		for(int i=0; i<queueWriters; ++i) writers[i].join();
+		for(int i=0; i<queueReaders; ++i) readers[i].join();
+		assert(queuePopped.load() == queueWriters * queueItems);
+		assert(queueErrors.load() == 0);
+		assert(objectQueue.empty());
+		QueueItem item;
+		assert(!objectQueue.pop(item, 0.001));	// times out while asleep
+	}
+
+	// ThreadPool
+	{
+		ThreadPool pool(3);
+		assert(pool.size() == 3);
+
+		const int N = 10007;
+		std::vector<int> data(N, 0);
+		Increment inc = { &data[0] };
+		int grains[] = {0, 1, 3, 100, N, 2*N};
+		for(int g=0; g<6; ++g){
+			pool.parallelFor(0, N, inc, grains[g]);
+			pool.parallelFor(0, 1, inc, grains[g]);
+			pool.parallelFor(5, 5, inc, grains[g]);
+		}
+		assert(data[0] == 12);
+		for(int i=1; i<N; ++i) assert(data[i] == 6);
+
+		// nested parallel loops
+		const int rows = 64, cols = 100;
+		std::vector<int> grid(rows * cols, 0);
+		Rows body = { &pool, &grid[0], cols };
+		pool.parallelFor(0, rows, body, 1);
+		for(int i=0; i<rows*cols; ++i) assert(grid[i] == 1);
+
+		// nested tasks
+		SumTask sum(&pool, 0, 100000);
+		ThreadPool::TaskGroup group(pool);
+		group.run(sum);
+		group.wait();
+		assert(sum.sum == 100000LL * 99999 / 2);
+	}
+
 	return 0;
 }
@@ -2,6 +2,23 @@
 
 typedef double data_t;
 
+// Records the times and ids of messages dispatched by a MsgQueue
+struct MsgLog{
+	std::vector<al_sec> times;
+	std::vector<int> ids;
+	void add(al_sec t, int id){ times.push_back(t); ids.push_back(id); }
+};
+
+struct BigArgs{ char bytes[256]; };
+
+static MsgQueue * msgQueue;
+static void logMsg(al_sec t, MsgLog * log, int id){ log->add(t, id); }
+static void logBig(al_sec t, MsgLog * log, BigArgs b){ log->add(t, b.bytes[255]); }
+static void logAndResend(al_sec t, MsgLog * log, int id){
+	log->add(t, id);
+	if(id < 3) msgQueue->send(t + 1., logAndResend, log, id + 1);
+}
+
 int utTypes(){
 
 
@@ -286,6 +303,118 @@ int utTypes(){
 		assert(a.read(3) == 2);
 	}
 
+	// SingleRWRingBuffer
+	{
+		SingleRWRingBuffer rb(16);
+		SingleRWRingBuffer::Span a, b;
+		char src[16], dst[16];
+		for(int i=0; i<16; ++i) src[i] = i;
+
+		assert(rb.writeSpace() == 15);
+		assert(rb.write(src, 10) == 10);
+		assert(rb.readSpace() == 10 && rb.writeSpace() == 5);
+		assert(rb.read(dst, 6) == 6);
+		assert(dst[5] == 5);
+
+		// free space wraps around the end
+		assert(rb.acquireWrite(a, b, 100) == 11);
+		assert(a.size == 6 && b.size == 5);
+		for(unsigned i=0; i<a.size; ++i) a.data[i] = 10 + i;
+		for(unsigned i=0; i<b.size; ++i) b.data[i] = 16 + i;
+		rb.commitWrite(8);
+		assert(rb.readSpace() == 12);
+
+		// data wraps around the end
+		assert(rb.acquireRead(a, b, 100) == 12);
+		assert(a.size == 10 && b.size == 2);
+		assert(a.data[0] == 6 && a.data[9] == 15 && b.data[1] == 17);
+		rb.release(4);
+		assert(rb.peek(dst, 3) == 3 && dst[0] == 10);
+		assert(rb.read(dst, 16) == 8 && dst[7] == 17);
+		assert(rb.readSpace() == 0 && rb.writeSpace() == 15);
+		assert(rb.acquireRead(a, b, 1) == 0);
+	}
+
+	// ObjectQueue
+	{	// objects are swapped through, not copied
+		ObjectQueue<std::vector<int> > q(3);
+		assert(q.capacity() == 4 && q.empty());
+
+		std::vector<int> v(100, 7), w;
+		const int * data = &v[0];
+		assert(q.tryPush(v));
+		assert(v.empty());				// a recycled slot value
+		assert(q.size() == 1);
+		assert(q.tryPop(w));
+		assert(w.size() == 100 && &w[0] == data);
+		assert(!q.tryPop(w));
+		assert(!q.pop(w, 0.001));
+		assert(w.size() == 100);
+
+		for(int i=0; i<4; ++i){ v.assign(1, i); assert(q.tryPush(v)); }
+		assert(!q.tryPush(v));
+		assert(!q.push(v, 0.001));
+		q.pop(w);
+		assert(w[0] == 0);
+		v.assign(1, 4);
+		q.push(v);
+		for(int i=1; i<5; ++i){ assert(q.tryPop(w) && w[0] == i); }
+	}
+
+	{	// slots start as copies of the prototype; Arrays are swapped
+		Array proto(3, AlloUInt8Ty, 4, 4);
+		ObjectQueue<Array> q(2, proto);
+		Array a(3, AlloUInt8Ty, 4, 4);
+		const char * data = a.data.ptr;
+		assert(q.tryPush(a));
+		assert(a.isFormat(proto) && a.data.ptr != data);
+		Array b;
+		assert(q.tryPop(b));
+		assert(b.data.ptr == data && b.isFormat(proto));
+	}
+
+	// MsgQueue
+	{	// dispatch in time order, with ties in order of scheduling
+		MsgQueue q(4);	// small pool, so that it must grow
+		MsgLog log;
+		const int N = 1000;
+		for(int i=0; i<N; ++i){
+			q.send((i * 7919) % 100, logMsg, &log, i);
+		}
+		assert(q.len() == N);
+		q.update(49.5);
+		assert(q.now() == 49.5);
+		assert(q.len() == N/2);
+		q.update(100);
+		assert(q.len() == 0);
+		assert(log.times.size() == (unsigned)N);
+		for(int i=1; i<N; ++i){
+			assert(log.times[i-1] <= log.times[i]);
+			if(log.times[i-1] == log.times[i]) assert(log.ids[i-1] < log.ids[i]);
+		}
+	}
+
+	{	// messages scheduled from callbacks, big messages and clear()
+		MsgQueue q(2);
+		MsgLog log;
+		msgQueue = &q;
+		q.send(0.5, logAndResend, &log, 0);
+		BigArgs b; b.bytes[255] = 9;
+		q.send(1.5, logBig, &log, b);
+		q.update(10);
+		assert(log.ids.size() == 5);
+		assert(log.ids[0] == 0 && log.ids[1] == 9 && log.ids[2] == 1);
+		assert(log.ids[3] == 2 && log.ids[4] == 3);
+		assert(log.times[4] == 3.5);
+
+		q.send(20, logBig, &log, b);
+		q.send(20, logMsg, &log, 0);
+		q.clear();
+		assert(q.len() == 0 && q.now() == 0);
+		q.update(100);
+		assert(log.ids.size() == 5);
+	}
+
 	return 0;
 }
 
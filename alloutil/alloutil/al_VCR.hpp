@@ -46,6 +46,7 @@
 #include <stdio.h>
 #include "allocore/io/al_AudioIO.hpp"
 #include "allocore/types/al_Array.hpp"
+#include "allocore/types/al_ObjectQueue.hpp"
 #include "Gamma/SoundFile.h"
 
 namespace al {
@@ -105,8 +106,9 @@ protected:
 	double mSR;
 
 	// image settings:
-	std::vector<Array> mImageRing;
-	unsigned mImageReadIndex, mImageWriteIndex;
+	// frames are swapped through the queue, so they keep their memory
+	ObjectQueue<Array> mImages;
+	Array mImageIn, mImageOut;
 	unsigned mImageFrame, mImageCount;
 
 	Thread audioThread, imageThread;
@@ -126,15 +128,13 @@ inline VCR::VCR(int channels, double sampleRate, int bufferSize, double sleep)
 	mAudioReadIndex(0),
 	mAudioWriteIndex(0),
 
-	mImageReadIndex(0),
-	mImageWriteIndex(0),
+	mImages(32),
 	mImageFrame(0),
 	mImageCount(0)
 
 {
 	mPath = "/";
 	mAudioRing.resize(mAudioFrames*mAudioChans);
-	mImageRing.resize(32);
 
 	mActive = 1;
 	audioThread.start(audioThreadFunc, this);
@@ -285,43 +285,28 @@ inline void VCR::writeToOpenSoundFile(gam::SoundFile& sf) {
 
 inline void VCR::image(Array& arr) {
 	if (mAudio) {
-		unsigned w = mImageWriteIndex;
-		unsigned next = w + 1;
-		if (next >= mImageRing.size()) next = 0;
-
-		if (next != mImageReadIndex) {
-			Array& dst = mImageRing[w];
-
-			// copy format & pixels:
-			dst = arr;
-
-			mImageWriteIndex = next;
-			//printf("imaged w %d r %d\n", w, mImageReadIndex);
+		// copy into a recycled frame, reallocating only if the format changed:
+		mImageIn = arr;
+		if (mImages.tryPush(mImageIn)) {
 			mImageFrame++;
 		} else {
-			printf("image overflow w %d r %d\n", mImageWriteIndex, mImageReadIndex);
+			printf("image overflow\n");
 		}
 	}
 }
 
 inline void VCR::writeImages(Image& image) {
-	unsigned r = mImageReadIndex;
-	unsigned w = mImageWriteIndex;
-	if (r == w) {
+	if (mImages.empty()) {
 		al_sleep(mSleep * 0.1);
 		return;
 	}
 	char path[1024];
-	while (w != r) {
+	while (mImages.tryPop(mImageOut)) {
 		sprintf(path, "%simage_%04d.jpg", mPath.c_str(), mImageCount++);
-		Array& src = mImageRing[r];
+		Array& src = mImageOut;
 
-		//printf("save (w %d r %d) %s %p %d %d\n", w, r, path, src.data.ptr, (int)src.width(), (int)src.height());
+		//printf("save %s %p %d %d\n", path, src.data.ptr, (int)src.width(), (int)src.height());
 		image.write<uint8_t>(std::string(path), (uint8_t *)src.data.ptr, (int)src.width(), (int)src.height(), Image::RGB);
-
-		r = r + 1;
-		if (r >= mImageRing.size()) r = 0;
-		mImageReadIndex = r;
 	}
 }
 